@@ -1,6 +1,82 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "HorizonsTC.h"
+#include "TCLog.h"
+#include "TCStats.h"
+#include "TCMemory.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE(FDefaultGameModuleImpl, HorizonsTC, "HorizonsTC");
+#if WITH_GAMEPLAY_DEBUGGER
+#include "GameplayDebugger.h"
+#include "Character/TCGameplayDebuggerCategory.h"
+#endif
+
+DEFINE_LOG_CATEGORY(LogHorizonsTC);
+
+DEFINE_STAT(STAT_TC_FootIKQueries);
+DEFINE_STAT(STAT_TC_MantleQueries);
+DEFINE_STAT(STAT_TC_CameraQueries);
+DEFINE_STAT(STAT_TC_LandPredictionQueries);
+DEFINE_STAT(STAT_TC_RagdollQueries);
+DEFINE_STAT(STAT_TC_WeaponAimQueries);
+
+CSV_DEFINE_CATEGORY_MODULE(HORIZONSTC_API, HorizonsTC, true);
+
+#if CPUPROFILERTRACE_ENABLED
+UE_TRACE_CHANNEL_DEFINE(HorizonsTCChannel);
+#endif
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+// Full stats show up under "stat LLMFULL", summary stats under "stat LLM"
+DECLARE_LLM_MEMORY_STAT(TEXT("TC Weapons"), STAT_TC_WeaponsLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("TC Projectiles"), STAT_TC_ProjectilesLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("TC Quests"), STAT_TC_QuestsLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("TC Animation"), STAT_TC_AnimationLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("TC UI"), STAT_TC_UILLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("HorizonsTC"), STAT_TC_SummaryLLM, STATGROUP_LLM);
+#endif
+
+void TCMemory::RegisterLLMTags()
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	FLowLevelMemTracker& Tracker = FLowLevelMemTracker::Get();
+	const FName SummaryStat = GET_STATFNAME(STAT_TC_SummaryLLM);
+
+	Tracker.RegisterProjectTag((int32)ETCLLMTag::Weapons, TEXT("TC_Weapons"), GET_STATFNAME(STAT_TC_WeaponsLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)ETCLLMTag::Projectiles, TEXT("TC_Projectiles"), GET_STATFNAME(STAT_TC_ProjectilesLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)ETCLLMTag::Quests, TEXT("TC_Quests"), GET_STATFNAME(STAT_TC_QuestsLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)ETCLLMTag::Animation, TEXT("TC_Animation"), GET_STATFNAME(STAT_TC_AnimationLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)ETCLLMTag::UI, TEXT("TC_UI"), GET_STATFNAME(STAT_TC_UILLM), SummaryStat);
+#endif
+}
+
+class FHorizonsTCModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		TCMemory::RegisterLLMTags();
+
+#if WITH_GAMEPLAY_DEBUGGER
+		IGameplayDebugger& GameplayDebugger = IGameplayDebugger::Get();
+		GameplayDebugger.RegisterCategory(TEXT("TCLocomotion"),
+			IGameplayDebugger::FOnGetCategory::CreateStatic(&FTCGameplayDebuggerCategory::MakeInstance),
+			EGameplayDebuggerCategoryState::EnabledInGameAndSimulate, 5);
+		GameplayDebugger.NotifyCategoriesChanged();
+#endif
+	}
+
+	virtual void ShutdownModule() override
+	{
+#if WITH_GAMEPLAY_DEBUGGER
+		if (IGameplayDebugger::IsAvailable())
+		{
+			IGameplayDebugger& GameplayDebugger = IGameplayDebugger::Get();
+			GameplayDebugger.UnregisterCategory(TEXT("TCLocomotion"));
+			GameplayDebugger.NotifyCategoriesChanged();
+		}
+#endif
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE(FHorizonsTCModule, HorizonsTC, "HorizonsTC");
@@ -12,6 +12,9 @@ UObjectiveComponent::UObjectiveComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
 
+	// For the server RPCs. Progress itself reaches the client through the quest manager's records.
+	SetIsReplicatedByDefault(true);
+
 	tempobj = -1;
 	tempopt = -1;
 }
@@ -42,7 +45,7 @@ void UObjectiveComponent::ChangeCurrentQuest(int32 QuestID)
 		// If we successfully update quest and aren't currently tracking it...
 		if (PC && PC->SetCurrentQuest(QuestID))
 		{
-			UpdateObjectiveProgress(QuestID);
+			UpdateObjectiveProgress(GetQuestManager(), QuestID);
 		}
 	}
 }
@@ -59,14 +62,19 @@ int32 UObjectiveComponent::GetCurrentQuest() const
 
 bool UObjectiveComponent::BeginQuest(int32 QuestID, bool MakeActive)
 {
-	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOwner());
+	if (!GetOwner()->HasAuthority())
+	{
+		return false;
+	}
 
-	if (PC)
+	AQuestManager* QuestManager = GetQuestManager();
+
+	if (QuestManager)
 	{
-		bool success = (PC->GetQuestManager()->BeginQuest(QuestID, MakeActive));
+		bool success = QuestManager->BeginQuest(QuestID, MakeActive);
 
-		UpdateObjectiveProgress(QuestID);
-		UpdateOptionalObjectiveProgress(QuestID);
+		UpdateObjectiveProgress(QuestManager, QuestID);
+		UpdateOptionalObjectiveProgress(QuestManager, QuestID);
 
 		return success;
 	}
@@ -76,14 +84,19 @@ bool UObjectiveComponent::BeginQuest(int32 QuestID, bool MakeActive)
 
 bool UObjectiveComponent::ProgressQuest(int32 QuestID, bool CurrCompleted)
 {
-	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOwner());
+	if (!GetOwner()->HasAuthority())
+	{
+		return false;
+	}
 
-	if (PC && ObjProgress.Contains(QuestID))
+	AQuestManager* QuestManager = GetQuestManager();
+
+	if (QuestManager && ObjProgress.Contains(QuestID))
 	{
-		bool success = PC->GetQuestManager()->AdvanceQuest(QuestID, CurrCompleted);
+		bool success = QuestManager->AdvanceQuest(QuestID, CurrCompleted);
 
-		return (UpdateObjectiveProgress(QuestID)
-			&& UpdateOptionalObjectiveProgress(QuestID) && success);
+		return (UpdateObjectiveProgress(QuestManager, QuestID)
+			&& UpdateOptionalObjectiveProgress(QuestManager, QuestID) && success);
 	}
 	else
 		return false;
@@ -91,14 +104,28 @@ bool UObjectiveComponent::ProgressQuest(int32 QuestID, bool CurrCompleted)
 
 bool UObjectiveComponent::ProgressObjective(int32 QuestID, int32 ProgressIncrease)
 {
-	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOwner());
+	// The server counts the progress and replicates it back in the quest's record
+	if (!GetOwner()->HasAuthority())
+	{
+		const FObjectiveProgress* Tracked = ObjProgress.Find(QuestID);
+		if (!Tracked)
+		{
+			return false;
+		}
+
+		ServerProgressObjective(QuestID, Tracked->ObjectiveID, ProgressIncrease);
+		return true;
+	}
+
+	AQuestManager* QuestManager = GetQuestManager();
 
 	// If we are currently tracking this quest's progress...
-	if (PC && ObjProgress.Contains(QuestID))
+	if (QuestManager && ObjProgress.Contains(QuestID))
 	{
 		// Get the objective struct and inc our current progress
 		auto& Struct = ObjProgress[QuestID];
 		Struct.IncrementProgress(ProgressIncrease);
+		QuestManager->SetObjectiveProgress(QuestID, Struct.CurrentProgress);
 
 		// If we are at or over our goal, progress the quest. Else, move on
 		if (Struct.CurrentProgress >= Struct.ProgressGoal)
@@ -112,10 +139,22 @@ bool UObjectiveComponent::ProgressObjective(int32 QuestID, int32 ProgressIncreas
 
 bool UObjectiveComponent::ProgressOptionalObjective(int32 QuestID, int32 ProgressIncrease)
 {
-	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOwner());
+	if (!GetOwner()->HasAuthority())
+	{
+		const FObjectiveProgress* Tracked = OptObjProgress.Find(QuestID);
+		if (!Tracked)
+		{
+			return false;
+		}
+
+		ServerProgressOptionalObjective(QuestID, Tracked->ObjectiveID, ProgressIncrease);
+		return true;
+	}
+
+	AQuestManager* QuestManager = GetQuestManager();
 
 	// If we are currently tracking this quest's progress...
-	if (PC && OptObjProgress.Contains(QuestID))
+	if (QuestManager && OptObjProgress.Contains(QuestID))
 	{
 		// Get the objective struct and inc our current progress
 		auto& Struct = OptObjProgress[QuestID];
@@ -123,7 +162,7 @@ bool UObjectiveComponent::ProgressOptionalObjective(int32 QuestID, int32 Progres
 
 		// If we are at or over our goal, make the opt obj as completed. Else, move on
 		if (Struct.CurrentProgress >= Struct.ProgressGoal)
-			return PC->GetQuestManager()->FinishOptionalObjective(QuestID, true);
+			return QuestManager->FinishOptionalObjective(QuestID, true);
 		else
 			return true;
 	}
@@ -133,9 +172,14 @@ bool UObjectiveComponent::ProgressOptionalObjective(int32 QuestID, int32 Progres
 
 bool UObjectiveComponent::FinishQuest(int32 QuestID, bool Completed)
 {
-	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOwner());
+	if (!GetOwner()->HasAuthority())
+	{
+		return false;
+	}
 
-	if (PC)
+	AQuestManager* QuestManager = GetQuestManager();
+
+	if (QuestManager)
 	{
 		if (ObjProgress.Contains(QuestID))
 			ObjProgress.Remove(QuestID);
@@ -144,21 +188,83 @@ bool UObjectiveComponent::FinishQuest(int32 QuestID, bool Completed)
 			OptObjProgress.Remove(QuestID);
 
 		if (Completed)
-			return PC->GetQuestManager()->CompleteQuest(QuestID);
+			return QuestManager->CompleteQuest(QuestID);
 		else
-			return PC->GetQuestManager()->FailQuest(QuestID);
+			return QuestManager->FailQuest(QuestID);
 	}
 	else
 		return false;
 }
 
-bool UObjectiveComponent::UpdateObjectiveProgress(int32 QuestID)
+bool UObjectiveComponent::ServerProgressObjective_Validate(int32 QuestID, int32 ObjectiveID, int32 ProgressIncrease)
+{
+	return ProgressIncrease > 0;
+}
+
+void UObjectiveComponent::ServerProgressObjective_Implementation(int32 QuestID, int32 ObjectiveID, int32 ProgressIncrease)
+{
+	if (IsValidClientProgress(ObjProgress, QuestID, ObjectiveID, ProgressIncrease))
+	{
+		ProgressObjective(QuestID, ProgressIncrease);
+	}
+}
+
+bool UObjectiveComponent::ServerProgressOptionalObjective_Validate(int32 QuestID, int32 ObjectiveID, int32 ProgressIncrease)
+{
+	return ProgressIncrease > 0;
+}
+
+void UObjectiveComponent::ServerProgressOptionalObjective_Implementation(int32 QuestID, int32 ObjectiveID, int32 ProgressIncrease)
+{
+	if (IsValidClientProgress(OptObjProgress, QuestID, ObjectiveID, ProgressIncrease))
+	{
+		ProgressOptionalObjective(QuestID, ProgressIncrease);
+	}
+}
+
+bool UObjectiveComponent::IsValidClientProgress(const TMap<int32, FObjectiveProgress>& Tracked, int32 QuestID,
+                                                int32 ObjectiveID, int32 ProgressIncrease) const
+{
+	// Progress made towards an objective the quest has already moved past (or never reached) doesn't count
+	AQuestManager* QuestManager = GetQuestManager();
+	const FObjectiveProgress* Objective = Tracked.Find(QuestID);
+
+	return QuestManager && QuestManager->ActiveQuests.Contains(QuestID) && Objective
+		&& Objective->ObjectiveID == ObjectiveID
+		&& ProgressIncrease <= Objective->ProgressGoal - Objective->CurrentProgress;
+}
+
+void UObjectiveComponent::ApplyQuestRecord(AQuestManager* QuestManager, int32 QuestID, int32 Progress)
+{
+	const FObjectiveProgress* Tracked = ObjProgress.Find(QuestID);
+	const int32 PrevObjective = Tracked ? Tracked->ObjectiveID : UTCStatics::DEFAULT_OBJECTIVE_ID;
+
+	UpdateObjectiveProgress(QuestManager, QuestID);
+
+	// Optional objectives only change with the main one, and restarting them would lose their progress
+	Tracked = ObjProgress.Find(QuestID);
+	if (!Tracked || Tracked->ObjectiveID != PrevObjective)
+	{
+		UpdateOptionalObjectiveProgress(QuestManager, QuestID);
+	}
+
+	if (FObjectiveProgress* Current = ObjProgress.Find(QuestID))
+	{
+		Current->CurrentProgress = Progress;
+	}
+}
+
+AQuestManager* UObjectiveComponent::GetQuestManager() const
 {
 	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOwner());
+	return PC ? PC->GetQuestManager() : nullptr;
+}
 
-	if (PC && PC->GetQuestManager()->ActiveQuests.Contains(QuestID)) // Start tracking or update tracking of active quest
+bool UObjectiveComponent::UpdateObjectiveProgress(AQuestManager* QuestManager, int32 QuestID)
+{
+	if (QuestManager && QuestManager->ActiveQuests.Contains(QuestID)) // Start tracking or update tracking of active quest
 	{
-		const auto& Quest = PC->GetQuestManager()->ActiveQuests[QuestID];
+		const auto& Quest = QuestManager->ActiveQuests[QuestID];
 
 		// Get objective stats
 		FObjectiveProgress ObjProg;
@@ -180,13 +286,11 @@ bool UObjectiveComponent::UpdateObjectiveProgress(int32 QuestID)
 		return false;
 }
 
-bool UObjectiveComponent::UpdateOptionalObjectiveProgress(int32 QuestID)
+bool UObjectiveComponent::UpdateOptionalObjectiveProgress(AQuestManager* QuestManager, int32 QuestID)
 {
-	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOwner());
-
-	if (PC && PC->GetQuestManager()->ActiveQuests.Contains(QuestID)) // Start tracking or update tracking of active quest
+	if (QuestManager && QuestManager->ActiveQuests.Contains(QuestID)) // Start tracking or update tracking of active quest
 	{
-		const auto& Quest = PC->GetQuestManager()->ActiveQuests[QuestID];
+		const auto& Quest = QuestManager->ActiveQuests[QuestID];
 
 		// Get objective stats
 		FObjectiveProgress ObjProg;
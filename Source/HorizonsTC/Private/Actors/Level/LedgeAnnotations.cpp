@@ -0,0 +1,331 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Actors/Level/LedgeAnnotations.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Components/SceneComponent.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "TCLog.h"
+
+// Matches the inset of the downward trace in ATCBaseCharacter::MantleCheck
+static const float LedgeInset = 15.0f;
+
+// Vertical step used when searching for the top of a wall face
+static const float WallProbeStep = 25.0f;
+
+TArray<TWeakObjectPtr<ALedgeAnnotations>> ALedgeAnnotations::ActiveAnnotations;
+
+ALedgeAnnotations::ALedgeAnnotations()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(FName(TEXT("Root")));
+}
+
+void ALedgeAnnotations::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (Grid.Num() == 0)
+	{
+		BuildGrid();
+	}
+
+	ActiveAnnotations.AddUnique(this);
+}
+
+void ALedgeAnnotations::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ActiveAnnotations.Remove(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ALedgeAnnotations::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildGrid();
+}
+
+void ALedgeAnnotations::BakeLedges()
+{
+	ULevel* Level = GetLevel();
+	if (!Level || !GetWorld())
+	{
+		return;
+	}
+
+	Modify();
+	Ledges.Reset();
+	BakedBounds.Init();
+
+	for (AActor* Actor : Level->Actors)
+	{
+		if (!Actor || Actor == this)
+		{
+			continue;
+		}
+
+		TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+		for (UPrimitiveComponent* Component : Components)
+		{
+			if (Component->IsCollisionEnabled())
+			{
+				BakedBounds += Component->Bounds.GetBox();
+			}
+
+			// Only static geometry can be baked. ECC_GameTraceChannel2 -> Climbable
+			if (Component->Mobility != EComponentMobility::Static || !Component->IsCollisionEnabled() ||
+				Component->GetCollisionResponseToChannel(ECC_GameTraceChannel2) != ECR_Block)
+			{
+				continue;
+			}
+
+			// Walk the top edge of each vertical face of the bounds. The traces find the real wall behind each face.
+			const FBox Box = Component->Bounds.GetBox();
+			const FVector& Min = Box.Min;
+			const FVector& Max = Box.Max;
+
+			BakeFace(Component, FVector(Min.X, Min.Y, Max.Z), FVector(Max.X, Min.Y, Max.Z), FVector(0.0f, -1.0f, 0.0f));
+			BakeFace(Component, FVector(Max.X, Min.Y, Max.Z), FVector(Max.X, Max.Y, Max.Z), FVector(1.0f, 0.0f, 0.0f));
+			BakeFace(Component, FVector(Max.X, Max.Y, Max.Z), FVector(Min.X, Max.Y, Max.Z), FVector(0.0f, 1.0f, 0.0f));
+			BakeFace(Component, FVector(Min.X, Max.Y, Max.Z), FVector(Min.X, Min.Y, Max.Z), FVector(-1.0f, 0.0f, 0.0f));
+		}
+	}
+
+	BuildGrid();
+
+	UE_LOG(LogHorizonsTC, Log, TEXT("%s: baked %d mantle ledges"), *GetName(), Ledges.Num());
+}
+
+void ALedgeAnnotations::BakeFace(UPrimitiveComponent* Component, const FVector& EdgeStart, const FVector& EdgeEnd,
+                                 const FVector& FaceNormal)
+{
+	UWorld* World = GetWorld();
+	check(World);
+
+	const float BoundsBottom = Component->Bounds.GetBox().Min.Z;
+	const int32 NumSamples = FMath::Max(1, FMath::FloorToInt(FVector::Dist(EdgeStart, EdgeEnd) / SampleSpacing));
+
+	FCollisionQueryParams Params(FName(TEXT("BakeLedges")), true);
+	Params.AddIgnoredActor(this);
+
+	FMantleLedge Current;
+	bool bHasCurrent = false;
+
+	auto CloseLedge = [&]()
+	{
+		if (bHasCurrent)
+		{
+			Ledges.Add(Current);
+			bHasCurrent = false;
+		}
+	};
+
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		const FVector EdgePoint = FMath::Lerp(EdgeStart, EdgeEnd, (Index + 0.5f) / NumSamples);
+
+		// Step 1: Probe inward from outside the face, top down, for the highest point of a non-walkable wall.
+		FHitResult WallHit;
+		bool bFoundWall = false;
+		for (float Z = EdgePoint.Z - 1.0f; Z > BoundsBottom; Z -= WallProbeStep)
+		{
+			const FVector ProbeStart(EdgePoint.X + FaceNormal.X * 50.0f, EdgePoint.Y + FaceNormal.Y * 50.0f, Z);
+			const FVector ProbeEnd = ProbeStart - FaceNormal * 100.0f;
+			if (Component->LineTraceComponent(WallHit, ProbeStart, ProbeEnd, Params) && WallHit.ImpactNormal.Z < WalkableNormalZ)
+			{
+				bFoundWall = true;
+				break;
+			}
+		}
+
+		if (!bFoundWall)
+		{
+			CloseLedge();
+			continue;
+		}
+
+		const FVector WallNormal = FVector(WallHit.ImpactNormal.X, WallHit.ImpactNormal.Y, 0.0f).GetSafeNormal();
+
+		// Step 2: Trace down just behind the wall for a walkable top surface.
+		FVector TopStart = WallHit.ImpactPoint - WallNormal * LedgeInset;
+		TopStart.Z = EdgePoint.Z + 10.0f;
+		const FVector TopEnd(TopStart.X, TopStart.Y, BoundsBottom);
+
+		FHitResult TopHit;
+		if (!Component->LineTraceComponent(TopHit, TopStart, TopEnd, Params) || TopHit.ImpactNormal.Z < WalkableNormalZ)
+		{
+			CloseLedge();
+			continue;
+		}
+
+		// Step 3: Measure the height above the floor in front of the wall. Ledges over a drop keep a height of zero.
+		const FVector FloorStart = WallHit.ImpactPoint + WallNormal * 30.0f;
+		FVector FloorEnd = FloorStart;
+		FloorEnd.Z = TopHit.ImpactPoint.Z - MaxBakeHeight - 10.0f;
+
+		float Height = 0.0f;
+		FHitResult FloorHit;
+		if (World->LineTraceSingleByChannel(FloorHit, FVector(FloorStart.X, FloorStart.Y, TopHit.ImpactPoint.Z), FloorEnd,
+		                                    ECC_Visibility, Params))
+		{
+			Height = TopHit.ImpactPoint.Z - FloorHit.ImpactPoint.Z;
+			if (Height < MinBakeHeight || Height > MaxBakeHeight)
+			{
+				CloseLedge();
+				continue;
+			}
+		}
+
+		// Step 4: Extend the current ledge or start a new one.
+		const FVector LedgePoint = TopHit.ImpactPoint;
+		if (bHasCurrent && FMath::Abs(LedgePoint.Z - Current.End.Z) <= MaxStepBetweenSamples &&
+			FVector::DotProduct(WallNormal, Current.Normal) > 0.95f)
+		{
+			Current.End = LedgePoint;
+			Current.Height = FMath::Max(Current.Height, Height);
+		}
+		else
+		{
+			CloseLedge();
+
+			Current.Start = LedgePoint;
+			Current.End = LedgePoint;
+			Current.Normal = WallNormal;
+			Current.Height = Height;
+			Current.Component = Component;
+			bHasCurrent = true;
+		}
+	}
+
+	CloseLedge();
+}
+
+void ALedgeAnnotations::BuildGrid()
+{
+	Grid.Reset();
+
+	for (int32 Index = 0; Index < Ledges.Num(); ++Index)
+	{
+		const FMantleLedge& Ledge = Ledges[Index];
+		const FIntPoint MinCell = GetCell(Ledge.Start.ComponentMin(Ledge.End));
+		const FIntPoint MaxCell = GetCell(Ledge.Start.ComponentMax(Ledge.End));
+
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+			{
+				Grid.FindOrAdd(FIntPoint(X, Y)).Add(Index);
+			}
+		}
+	}
+}
+
+FIntPoint ALedgeAnnotations::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+bool ALedgeAnnotations::HasLedgeData(const UWorld* World, const FVector& Location, float Reach, bool& bOutExhaustive)
+{
+	bool bHasData = false;
+	bOutExhaustive = false;
+
+	// The whole reach must lie within one level's baked bounds. Anything outside them, such as a streamed level
+	// without annotations, may hold geometry only a trace can find.
+	const FBox ReachBox(Location - FVector(Reach, Reach, 0.0f), Location + FVector(Reach, Reach, 0.0f));
+
+	for (const TWeakObjectPtr<ALedgeAnnotations>& Annotations : ActiveAnnotations)
+	{
+		if (Annotations.IsValid() && Annotations->GetWorld() == World && Annotations->Ledges.Num() > 0)
+		{
+			bHasData = true;
+			bOutExhaustive |= Annotations->bBakedDataIsExhaustive && Annotations->BakedBounds.IsValid &&
+				Annotations->BakedBounds.IsInsideXY(ReachBox);
+		}
+	}
+
+	return bHasData;
+}
+
+bool ALedgeAnnotations::FindLedge(const UWorld* World, const FVector& CapsuleBase, const FVector& Direction, float Reach,
+                                  float Radius, float MinHeight, float MaxHeight, FMantleLedge& OutLedge, FVector& OutPoint)
+{
+	bool bFound = false;
+	float BestDist = TNumericLimits<float>::Max();
+
+	for (const TWeakObjectPtr<ALedgeAnnotations>& Annotations : ActiveAnnotations)
+	{
+		if (Annotations.IsValid() && Annotations->GetWorld() == World)
+		{
+			bFound |= Annotations->FindLedgeLocal(CapsuleBase, Direction, Reach, Radius, MinHeight, MaxHeight,
+			                                      OutLedge, OutPoint, BestDist);
+		}
+	}
+
+	return bFound;
+}
+
+bool ALedgeAnnotations::FindLedgeLocal(const FVector& CapsuleBase, const FVector& Direction, float Reach, float Radius,
+                                       float MinHeight, float MaxHeight, FMantleLedge& OutLedge, FVector& OutPoint,
+                                       float& InOutBestDist) const
+{
+	const FVector Extent(Reach, Reach, 0.0f);
+	const FIntPoint MinCell = GetCell(CapsuleBase - Extent);
+	const FIntPoint MaxCell = GetCell(CapsuleBase + Extent);
+
+	bool bFound = false;
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			const TArray<int32>* Cell = Grid.Find(FIntPoint(X, Y));
+			if (!Cell)
+			{
+				continue;
+			}
+
+			for (const int32 Index : *Cell)
+			{
+				const FMantleLedge& Ledge = Ledges[Index];
+
+				// The character has to be heading into the wall
+				if (FVector::DotProduct(Direction, -Ledge.Normal) < 0.5f)
+				{
+					continue;
+				}
+
+				// Point on the ledge straight ahead of the character, clamped to the segment
+				const FVector Segment = Ledge.End - Ledge.Start;
+				const float Denominator = Segment.X * Direction.Y - Segment.Y * Direction.X;
+				const FVector ToBase = CapsuleBase - Ledge.Start;
+				const float SegmentAlpha = FMath::Abs(Denominator) > KINDA_SMALL_NUMBER
+					                           ? FMath::Clamp((ToBase.X * Direction.Y - ToBase.Y * Direction.X) / Denominator, 0.0f, 1.0f)
+					                           : 0.5f;
+				const FVector Point = Ledge.Start + Segment * SegmentAlpha;
+				const FVector Offset(Point.X - CapsuleBase.X, Point.Y - CapsuleBase.Y, 0.0f);
+				const float ForwardDist = FVector::DotProduct(Offset, Direction);
+				const float SideDist = (Offset - Direction * ForwardDist).Size();
+				const float RelativeHeight = Point.Z - CapsuleBase.Z;
+
+				if (ForwardDist <= 0.0f || ForwardDist > Reach || SideDist > Radius ||
+					RelativeHeight < MinHeight || RelativeHeight > MaxHeight || ForwardDist >= InOutBestDist)
+				{
+					continue;
+				}
+
+				InOutBestDist = ForwardDist;
+				OutLedge = Ledge;
+				OutPoint = Point;
+				bFound = true;
+			}
+		}
+	}
+
+	return bFound;
+}
@@ -2,14 +2,107 @@
 
 
 #include "Actors/Quests/QuestManager.h"
+#include "Actors/Components/ObjectiveComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Character/TCPlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
+#include "TCLog.h"
+#include "TCStats.h"
+#include "TCMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Begin Quest"), STAT_TC_BeginQuest, STATGROUP_HorizonsTC_Quests);
+DECLARE_CYCLE_STAT(TEXT("Advance Quest"), STAT_TC_AdvanceQuest, STATGROUP_HorizonsTC_Quests);
+DECLARE_CYCLE_STAT(TEXT("Finish Optional Objective"), STAT_TC_FinishOptionalObjective, STATGROUP_HorizonsTC_Quests);
+DECLARE_CYCLE_STAT(TEXT("Complete Quest"), STAT_TC_CompleteQuest, STATGROUP_HorizonsTC_Quests);
+DECLARE_CYCLE_STAT(TEXT("Fail Quest"), STAT_TC_FailQuest, STATGROUP_HorizonsTC_Quests);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Quest Records Dirtied"), STAT_TC_QuestRecordsDirtied, STATGROUP_HorizonsTC_Quests);
+
+static FAutoConsoleCommand CmdDumpQuestNetStats(
+	TEXT("tc.Quests.DumpNetStats"),
+	TEXT("Logs the quest records dirtied and replicated by this process, with average bytes per update."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FTCQuestNetCounters::Get().Dump();
+	}));
+
+/************************************************************************/
+/* Quest Records                                                        */
+/************************************************************************/
+
+void FTCQuestRecord::PreReplicatedRemove(const FTCQuestRecordArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnQuestRecordRemoved(*this);
+	}
+}
+
+void FTCQuestRecord::PostReplicatedAdd(const FTCQuestRecordArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnQuestRecordReplicated(*this);
+	}
+}
+
+void FTCQuestRecord::PostReplicatedChange(const FTCQuestRecordArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnQuestRecordReplicated(*this);
+	}
+}
+
+FTCQuestRecord* FTCQuestRecordArray::Find(int32 QuestID)
+{
+	return Items.FindByPredicate([QuestID](const FTCQuestRecord& Record) { return Record.QuestID == QuestID; });
+}
+
+bool FTCQuestRecordArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int64 StartBits = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+
+	const bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FTCQuestRecord, FTCQuestRecordArray>(Items, DeltaParms, *this);
+
+	// Only count real sends, not unchanged arrays or the reading side
+	if (DeltaParms.Writer && bResult)
+	{
+		FTCQuestNetCounters& Counters = FTCQuestNetCounters::Get();
+		Counters.UpdatesSent++;
+		Counters.BitsSent += DeltaParms.Writer->GetNumBits() - StartBits;
+	}
+
+	return bResult;
+}
+
+FTCQuestNetCounters& FTCQuestNetCounters::Get()
+{
+	static FTCQuestNetCounters Counters;
+	return Counters;
+}
+
+void FTCQuestNetCounters::Dump() const
+{
+	UE_LOG(LogHorizonsTC, Log, TEXT("Quest replication: %llu records dirtied, %llu updates sent, %llu bytes, %.2f bytes/update"),
+		RecordsDirtied, UpdatesSent, BitsSent / 8, UpdatesSent > 0 ? (double)BitsSent / 8.0 / (double)UpdatesSent : 0.0);
+}
+
+/************************************************************************/
+/* Quest Manager                                                        */
+/************************************************************************/
 
 // Sets default values
 AQuestManager::AQuestManager()
 {
 	PrimaryActorTick.bCanEverTick = false;
 
+	// Quest state is private to the player that owns it
+	bReplicates = true;
+	bOnlyRelevantToOwner = true;
+	SetReplicatingMovement(false);
+
+	QuestRecords.Owner = this;
 }
 
 // Called when the game starts or when spawned
@@ -28,23 +121,27 @@ void AQuestManager::Tick(float DeltaTime)
 
 bool AQuestManager::BeginQuest(int32 QuestID, bool MakeActive)
 {
-	auto PC = Cast<ATCPlayerController>(UGameplayStatics::GetPlayerController(GetWorld(), 0));
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_BeginQuest);
+	TC_LLM_SCOPE(Quests);
+
+	// Quest state is server authoritative. Clients get it through QuestRecords.
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
+	auto PC = GetOwningController();
 
 	// If valid ID and not previously undertaken, spawn this quest
 	if (QuestID > 0 && !CompletedQuests.Contains(QuestID) &&
 		!FailedQuests.Contains(QuestID) && !ActiveQuests.Contains(QuestID))
 	{
-		TSubclassOf<AMasterQuest>* Elem = AllQuests.Find(QuestID);
+		AMasterQuest* Quest = SpawnQuest(QuestID);
 
-		if (Elem)
+		if (Quest)
 		{
-			auto Spawn = GetWorld()->SpawnActor<AMasterQuest>(*Elem);
-			ActiveQuests.Add(QuestID, Spawn);
-
-			AMasterQuest* Quest = Cast<AMasterQuest>(Spawn);
-
-			if (Quest)
-				Quest->OnBeginDelegate.Broadcast();
+			Quest->OnBeginDelegate.Broadcast();
+			UpdateQuestRecord(QuestID);
 
 			// Make it our current quest if requested to
 			if (MakeActive)
@@ -56,7 +153,7 @@ bool AQuestManager::BeginQuest(int32 QuestID, bool MakeActive)
 			return true;
 		}
 	}
-	else if (MakeActive && ActiveQuests.Contains(QuestID))
+	else if (MakeActive && ActiveQuests.Contains(QuestID) && PC)
 	{
 		PC->SetCurrentQuest(QuestID);
 	}
@@ -66,6 +163,13 @@ bool AQuestManager::BeginQuest(int32 QuestID, bool MakeActive)
 
 bool AQuestManager::AdvanceQuest(int32 QuestID, bool CurrObjCompleted)
 {
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_AdvanceQuest);
+
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
 	// Advance quest if completed. Otherwise, fail it
 	if (CurrObjCompleted)
 	{
@@ -90,8 +194,10 @@ bool AQuestManager::AdvanceQuest(int32 QuestID, bool CurrObjCompleted)
 				(*Quest)->Objectives[Curr].IsFinished = true;
 				(*Quest)->QuestInfo.IncrementCurrentObjective();
 				(*Quest)->OnObjectiveAdvanceDelegate.Broadcast(--Curr, Curr);
+				UpdateQuestRecord(QuestID);
 
-				Cast<ATCPlayerController>(UGameplayStatics::GetPlayerController(GetWorld(), 0))->UpdateQuestHUD(QuestID);
+				if (ATCPlayerController* PC = GetOwningController())
+					PC->UpdateQuestHUD(QuestID);
 
 				return true;
 			}
@@ -105,6 +211,13 @@ bool AQuestManager::AdvanceQuest(int32 QuestID, bool CurrObjCompleted)
 
 bool AQuestManager::FinishOptionalObjective(int32 QuestID, bool ObjCompleted)
 {
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_FinishOptionalObjective);
+
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
 	auto Quest = ActiveQuests.Find(QuestID);
 
 	if (Quest)
@@ -145,6 +258,13 @@ bool AQuestManager::FinishOptionalObjective(int32 QuestID, bool ObjCompleted)
 
 bool AQuestManager::CompleteQuest(int32 QuestID)
 {
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_CompleteQuest);
+
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
 	auto Quest = ActiveQuests.Find(QuestID);
 
 	if (Quest)
@@ -157,15 +277,17 @@ bool AQuestManager::CompleteQuest(int32 QuestID)
 		if (ActiveQuests.Remove(QuestID) > 0)
 		{
 			CompletedQuests.Add(QuestID);
+			UpdateQuestRecord(QuestID);
+
 			if (NewQuest != UTCStatics::DEFAULT_QUEST_ID)
 			{
 				if (BeginQuest(NewQuest, true))
 					return true;
 			}
 
-			auto PC = Cast<ATCPlayerController>(UGameplayStatics::GetPlayerController(GetWorld(), 0));
+			auto PC = GetOwningController();
 
-			if (PC->GetCurrentQuest() == QuestID)
+			if (PC && PC->GetCurrentQuest() == QuestID)
 				PC->SetCurrentQuest(UTCStatics::DEFAULT_QUEST_ID, true);
 
 			return true;
@@ -179,6 +301,13 @@ bool AQuestManager::CompleteQuest(int32 QuestID)
 
 bool AQuestManager::FailQuest(int32 QuestID)
 {
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_FailQuest);
+
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
 	auto Quest = ActiveQuests.Find(QuestID);
 
 	if (Quest)
@@ -192,15 +321,17 @@ bool AQuestManager::FailQuest(int32 QuestID)
 		if (ActiveQuests.Remove(QuestID) > 0)
 		{
 			FailedQuests.Add(QuestID, QuestInfo.CurrentObjective);
+			UpdateQuestRecord(QuestID);
+
 			if (NewQuest != UTCStatics::DEFAULT_QUEST_ID)
 			{
 				if (BeginQuest(NewQuest, true))
 					return true;
 			}
 
-			auto PC = Cast<ATCPlayerController>(UGameplayStatics::GetPlayerController(GetWorld(), 0));
+			auto PC = GetOwningController();
 
-			if (PC->GetCurrentQuest() == QuestID)
+			if (PC && PC->GetCurrentQuest() == QuestID)
 				PC->SetCurrentQuest(UTCStatics::DEFAULT_QUEST_ID, true);
 
 			return true;
@@ -210,4 +341,223 @@ bool AQuestManager::FailQuest(int32 QuestID)
 	}
 	else
 		return false;
-}
\ No newline at end of file
+}
+
+void AQuestManager::SetObjectiveProgress(int32 QuestID, int32 Progress)
+{
+	FTCQuestRecord* Record = QuestRecords.Find(QuestID);
+	const uint16 ClampedProgress = (uint16)FMath::Clamp(Progress, 0, (int32)MAX_uint16);
+
+	if (HasAuthority() && Record && Record->Progress != ClampedProgress)
+	{
+		Record->Progress = ClampedProgress;
+		QuestRecords.MarkItemDirty(*Record);
+
+		FTCQuestNetCounters::Get().RecordsDirtied++;
+		INC_DWORD_STAT(STAT_TC_QuestRecordsDirtied);
+	}
+}
+
+void AQuestManager::UpdateQuestRecord(int32 QuestID)
+{
+	// Nobody to replicate to
+	if (GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	ETCQuestState State;
+	int32 Objective;
+
+	if (AMasterQuest** Quest = ActiveQuests.Find(QuestID))
+	{
+		State = ETCQuestState::Active;
+		Objective = (*Quest)->QuestInfo.CurrentObjective;
+	}
+	else if (const int32* FailedObj = FailedQuests.Find(QuestID))
+	{
+		State = ETCQuestState::Failed;
+		Objective = *FailedObj;
+	}
+	else if (CompletedQuests.Contains(QuestID))
+	{
+		State = ETCQuestState::Completed;
+		Objective = 0;
+	}
+	else
+	{
+		return;
+	}
+
+	FTCQuestRecord* Record = QuestRecords.Find(QuestID);
+	if (!Record)
+	{
+		Record = &QuestRecords.Items.AddDefaulted_GetRef();
+		Record->QuestID = QuestID;
+	}
+	else if (Record->State == State && Record->CurrentObjective == Objective)
+	{
+		return;
+	}
+
+	// Progress counts towards the current objective only
+	if (Record->CurrentObjective != Objective)
+	{
+		Record->Progress = 0;
+	}
+
+	Record->State = State;
+	Record->CurrentObjective = (uint8)Objective;
+	QuestRecords.MarkItemDirty(*Record);
+
+	FTCQuestNetCounters::Get().RecordsDirtied++;
+	INC_DWORD_STAT(STAT_TC_QuestRecordsDirtied);
+}
+
+void AQuestManager::OnQuestRecordReplicated(const FTCQuestRecord& Record)
+{
+	TC_LLM_SCOPE(Quests);
+
+	const int32 QuestID = Record.QuestID;
+	ATCPlayerController* PC = GetOwningController();
+
+	if (Record.State == ETCQuestState::Active)
+	{
+		// Step 1: Spawn our copy of the quest the first time we hear of it.
+		AMasterQuest* Quest = nullptr;
+		if (AMasterQuest** Found = ActiveQuests.Find(QuestID))
+		{
+			Quest = *Found;
+		}
+		else if ((Quest = SpawnQuest(QuestID)) != nullptr)
+		{
+			Quest->OnBeginDelegate.Broadcast();
+
+			if (PC && PC->GetCurrentQuest() == UTCStatics::DEFAULT_QUEST_ID)
+				PC->SetCurrentQuest(QuestID);
+		}
+
+		if (!Quest)
+		{
+			return;
+		}
+
+		// Step 2: Catch up on objectives, finishing the ones passed on the server.
+		const int32 PrevObjective = Quest->QuestInfo.CurrentObjective;
+		if (Record.CurrentObjective != PrevObjective && Quest->Objectives.IsValidIndex(Record.CurrentObjective))
+		{
+			for (int32 Obj = PrevObjective; Obj < Record.CurrentObjective; ++Obj)
+			{
+				Quest->Objectives[Obj].Completed = true;
+				Quest->Objectives[Obj].IsFinished = true;
+			}
+
+			Quest->QuestInfo.CurrentObjective = Record.CurrentObjective;
+			Quest->OnObjectiveAdvanceDelegate.Broadcast(PrevObjective, Record.CurrentObjective);
+
+			if (PC && PC->GetCurrentQuest() == QuestID)
+				PC->UpdateQuestHUD(QuestID);
+		}
+	}
+	else
+	{
+		// Step 3: Finished quests move to the completed or failed lists like they did on the server. Quests we
+		// never had an actor for (finished before joining, or begun and finished between updates) go there too.
+		AMasterQuest* Quest = nullptr;
+		ActiveQuests.RemoveAndCopyValue(QuestID, Quest);
+
+		if (Record.State == ETCQuestState::Completed)
+		{
+			if (Quest)
+				Quest->OnCompletedDelegate.Broadcast();
+			CompletedQuests.AddUnique(QuestID);
+		}
+		else
+		{
+			if (Quest)
+				Quest->OnFailDelegate.Broadcast();
+			FailedQuests.Add(QuestID, Record.CurrentObjective);
+		}
+
+		if (PC && PC->GetCurrentQuest() == QuestID)
+			PC->SetCurrentQuest(UTCStatics::DEFAULT_QUEST_ID, true);
+	}
+
+	// Step 4: Objective progress is derived from the record rather than replicated separately. The controller may not
+	// have resolved its reference to us yet when the initial records arrive, so we pass ourselves in.
+	if (PC && PC->GetObjectiveComp())
+	{
+		PC->GetObjectiveComp()->ApplyQuestRecord(this, QuestID, Record.Progress);
+	}
+}
+
+AMasterQuest* AQuestManager::SpawnQuest(int32 QuestID)
+{
+	TSubclassOf<AMasterQuest>* Elem = AllQuests.Find(QuestID);
+	if (!Elem)
+	{
+		return nullptr;
+	}
+
+	AMasterQuest* Quest = GetWorld()->SpawnActor<AMasterQuest>(*Elem);
+	if (Quest)
+	{
+		ActiveQuests.Add(QuestID, Quest);
+	}
+
+	return Quest;
+}
+
+void AQuestManager::RemoveQuest(int32 QuestID)
+{
+	AMasterQuest* Quest = nullptr;
+	if (ActiveQuests.RemoveAndCopyValue(QuestID, Quest) && Quest)
+	{
+		Quest->Destroy();
+	}
+
+	CompletedQuests.Remove(QuestID);
+	FailedQuests.Remove(QuestID);
+
+	ATCPlayerController* PC = GetOwningController();
+	if (PC && PC->GetCurrentQuest() == QuestID)
+	{
+		PC->SetCurrentQuest(UTCStatics::DEFAULT_QUEST_ID, true);
+	}
+}
+
+void AQuestManager::ForgetQuest(int32 QuestID)
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	RemoveQuest(QuestID);
+
+	const int32 RecordIndex = QuestRecords.Items.IndexOfByPredicate(
+		[QuestID](const FTCQuestRecord& Record) { return Record.QuestID == QuestID; });
+
+	if (RecordIndex != INDEX_NONE)
+	{
+		QuestRecords.Items.RemoveAtSwap(RecordIndex);
+		QuestRecords.MarkArrayDirty();
+	}
+}
+
+void AQuestManager::OnQuestRecordRemoved(const FTCQuestRecord& Record)
+{
+	RemoveQuest(Record.QuestID);
+}
+
+ATCPlayerController* AQuestManager::GetOwningController() const
+{
+	return Cast<ATCPlayerController>(GetOwner());
+}
+
+void AQuestManager::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(AQuestManager, QuestRecords, COND_OwnerOnly);
+}
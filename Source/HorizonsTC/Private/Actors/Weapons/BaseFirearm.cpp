@@ -6,6 +6,9 @@
 #include "Actors/Weapons/BaseProjectile.h"
 #include "Character/TCCharacter.h"
 #include "Character/Components/WeaponComponent.h"
+#include "Game/TCHitZoneSubsystem.h"
+#include "Game/TCLagCompensationSubsystem.h"
+#include "Game/TCPhysicsQuerySubsystem.h"
 
 #include "Camera/CameraComponent.h"
 #include "Components/SkeletalMeshComponent.h"
@@ -14,11 +17,26 @@
 #include "Kismet/KismetMathLibrary.h"
 
 #include "Engine.h"
+#include "TCLatency.h"
+#include "TCStats.h"
+#include "TCMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Fire Weapon"), STAT_TC_FireWeapon, STATGROUP_HorizonsTC_Weapons);
+DECLARE_CYCLE_STAT(TEXT("Weapon Aim Trace"), STAT_TC_WeaponAimTrace, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shots Fired"), STAT_TC_ShotsFired, STATGROUP_HorizonsTC_Weapons);
+
+static TAutoConsoleVariable<int32> CVarWeaponRandomSeed(
+	TEXT("tc.Weapons.RandomSeed"),
+	0,
+	TEXT("Seeds every weapon spawned afterwards from this value and its weapon ID, so runs fire identical shots. 0 for a random seed per weapon."),
+	ECVF_Cheat);
 
 class ABaseProjectile;
 
 ABaseFirearm::ABaseFirearm()
 {
+	TC_LLM_SCOPE(Weapons);
+
 	Mesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("WeaponMesh"));
 	Mesh->bReceivesDecals = true;
 	Mesh->CastShadow = true;
@@ -43,6 +61,8 @@ ABaseFirearm::ABaseFirearm()
 
 void ABaseFirearm::PostInitializeComponents()
 {
+	TC_LLM_SCOPE(Weapons);
+
 	Super::PostInitializeComponents();
 
 	Mesh->SetSkeletalMesh(WeaponData.WeaponMesh);
@@ -53,6 +73,28 @@ void ABaseFirearm::PostInitializeComponents()
 	CurrentAmmoInClip = StoredWeapon.CurrMagAmmo;
 	CurrentState = StoredWeapon.CurrWeaponState;
 	CurrentFireMode = StoredWeapon.CurrFireMode;
+
+	ResetStreamSeed();
+}
+
+
+void ABaseFirearm::SetStreamSeed(int32 NewSeed, uint16 FirstShotIndex)
+{
+	StreamSeed = NewSeed;
+	NextShotIndex = FirstShotIndex;
+}
+
+
+void ABaseFirearm::ResetStreamSeed()
+{
+	SetStreamSeed(PickStreamSeed(StoredWeapon.WeaponID));
+}
+
+
+int32 ABaseFirearm::PickStreamSeed(FName WeaponID)
+{
+	const int32 FixedSeed = CVarWeaponRandomSeed.GetValueOnGameThread();
+	return FixedSeed != 0 ? (int32)HashCombine((uint32)FixedSeed, GetTypeHash(WeaponID)) : FMath::Rand();
 }
 
 
@@ -511,33 +553,170 @@ EWeaponState ABaseFirearm::GetCurrentState() const
 
 void ABaseFirearm::FireWeapon()
 {
-	// Calculate projectile direction
-	FName Bone("null");
-	FTransform MainDir = CalculateMainProjectileDirection(Bone);
-	FTransform FinalDir = CalculateFinalProjectileDirection(MainDir, GetCurrentSpread());
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_FireWeapon);
+	INC_DWORD_STAT(STAT_TC_ShotsFired);
+
+	// Describe the shot. The aim point is snapped to the 1cm grid the network sees so every machine fires the same shot.
+	EHitZone HitZone = EHitZone::Torso;
+	FTCShotEvent Shot;
+	Shot.AimPoint = CalculateAimPoint(HitZone).GridSnap(1.0f);
+	Shot.StreamSeed = StreamSeed;
+	Shot.ShotIndex = NextShotIndex++;
+	Shot.SetFiringSpread(CurrentFiringSpread, WeaponData.FiringSpreadMax);
+
+	// Networked clients only predict the shot. The server fires it for real once it has validated it.
+	const bool bNetworked = GetNetMode() != NM_Standalone;
+	FRandomStream ShotStream(Shot.GetSeed());
+	SpawnShotProjectile(Shot, CalculateShotDirection(Shot, ShotStream), HitZone, !bNetworked || Pawn->HasAuthority(), ShotStream);
+
+	// Time the local player's shots from the fire press to the projectile moving
+	if (FTCLatencyTracker::IsEnabled() && Pawn->IsLocallyControlled() && Pawn->IsPlayerControlled() && IsValid(ProjectileRef))
+	{
+		const double ShotTime = FPlatformTime::Seconds();
+		ProjectileRef->TrackFirstMove(ShotTime, FTCLatencyTracker::Get().MarkShotFired(ShotTime));
+	}
+
+	if (bNetworked)
+	{
+		Pawn->GetWeaponComp()->RecordShot(Shot);
+	}
+
+
+	// Handle recoil + spread. Recoil is rolled after spread and damage so those match what other machines roll.
+	float Pitch = -1.0 * ShotStream.FRandRange(WeaponData.RecoilStats.UpMin, WeaponData.RecoilStats.UpMax);
+	float Yaw = ShotStream.FRandRange(WeaponData.RecoilStats.RightMin, WeaponData.RecoilStats.RightMax);
+
+	Pawn->GetWeaponComp()->AddRecoil(Pitch, Yaw);
+
+	CurrentFiringSpread = FMath::Min(WeaponData.FiringSpreadMax, CurrentFiringSpread + WeaponData.FiringSpreadIncrement);
+}
+
+
+FTransform ABaseFirearm::CalculateShotDirection(const FTCShotEvent& Shot, FRandomStream& ShotStream)
+{
+	// Spread comes from the shot's seed and its quantized spread, so every machine replaying the shot rolls the
+	// same direction whatever spread it has built up itself
+	const FVector MuzzlePos = GetProjectileSpawnLocation();
+	const FTransform MainDir(UKismetMathLibrary::FindLookAtRotation(MuzzlePos, Shot.AimPoint), MuzzlePos, FVector::OneVector);
+	const float Spread = WeaponData.WeaponSpread + Shot.GetFiringSpread(WeaponData.FiringSpreadMax);
 
+	return CalculateFinalProjectileDirection(MainDir, Spread, ShotStream);
+}
 
-	// Calculate projectile damage
+
+void ABaseFirearm::SpawnShotProjectile(const FTCShotEvent& Shot, const FTransform& FinalDir, EHitZone HitZone, bool bAuthoritative, FRandomStream& ShotStream)
+{
+	// Calculate projectile damage. Rolled after the spread, from the same stream.
 	float DamageToDeal = 0;
-	bool CritHit = CalculateDamage(Bone, DamageToDeal);
+	bool CritHit = CalculateDamage(HitZone, DamageToDeal, ShotStream);
 
 
 	// Begin spawning the projectile, initialize it, finish spawning
+	TC_LLM_SCOPE(Projectiles);
+
 	ProjectileRef = GetWorld()->SpawnActorDeferred<ABaseProjectile>
 		(WeaponData.ProjectileClass, FinalDir, Pawn, Pawn, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
 
 	ProjectileRef->InitializeProjectileStats(DamageToDeal, CritHit, WeaponData.WeaponDamage.ProjSpeed, WeaponData.WeaponDamage.bCanRicochet);
+	ProjectileRef->SetCosmeticOnly(!bAuthoritative);
 
 	UGameplayStatics::FinishSpawningActor(Cast<AActor>(ProjectileRef), FinalDir);
+}
+
+
+void ABaseFirearm::ReplayShot(const FTCShotEvent& Shot, float ShotTime, bool bAuthoritative)
+{
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		SimulateWeaponFire();
 
+		// Nothing ends a remote burst, so stop the fire FX once shots stop arriving
+		GetWorldTimerManager().SetTimer(TimerHandle_StopReplayFX, this, &ABaseFirearm::StopSimulatingWeaponFire,
+			FMath::Max(2.0f * TimeBetweenShots, 0.1f), false);
+	}
 
-	// Handle recoil + spread
-	float Pitch = -1.0 * UKismetMathLibrary::RandomFloatInRange(WeaponData.RecoilStats.UpMin, WeaponData.RecoilStats.UpMax);
-	float Yaw = UKismetMathLibrary::RandomFloatInRange(WeaponData.RecoilStats.RightMin, WeaponData.RecoilStats.RightMax);
+	FRandomStream ShotStream(Shot.GetSeed());
+	const FTransform ShotDir = CalculateShotDirection(Shot, ShotStream);
 
-	Pawn->GetWeaponComp()->AddRecoil(Pitch, Yaw);
+	EHitZone HitZone = EHitZone::Torso;
+	bool bRewound = false;
+	FHitResult RewoundHit(ForceInit);
 
-	CurrentFiringSpread = FMath::Min(WeaponData.FiringSpreadMax, CurrentFiringSpread + WeaponData.FiringSpreadIncrement);
+	if (bAuthoritative)
+	{
+		HitZone = TraceShotHitZone(ShotDir, Shot.AimPoint, ShotTime, bRewound, RewoundHit);
+	}
+
+	SpawnShotProjectile(Shot, ShotDir, HitZone, bAuthoritative, ShotStream);
+
+	// The rewind, not the projectile flying against where characters are now, decides which character is hit
+	if (bRewound && IsValid(ProjectileRef))
+	{
+		ProjectileRef->SetRewoundHit(RewoundHit.GetActor(), RewoundHit.Distance);
+	}
+
+	// Follow the shooter's spread, so anything reading ours (e.g. a spectated crosshair) matches theirs
+	CurrentFiringSpread = FMath::Min(WeaponData.FiringSpreadMax, Shot.GetFiringSpread(WeaponData.FiringSpreadMax) + WeaponData.FiringSpreadIncrement);
+
+	if (bAuthoritative)
+	{
+		UseAmmo();
+	}
+}
+
+
+bool ABaseFirearm::RefillClip()
+{
+	if (CurrentAmmoInClip <= 0)
+	{
+		ReloadWeapon();
+	}
+
+	return CurrentAmmoInClip > 0;
+}
+
+
+EHitZone ABaseFirearm::TraceShotHitZone(const FTransform& ShotDir, const FVector& AimPoint, float ShotTime, bool& bOutRewound, FHitResult& OutRewoundHit)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_WeaponAimTrace);
+
+	// Follow the projectile's spread direction, a little past the aim point so a target standing right on it still counts
+	const FVector StartPt = ShotDir.GetLocation();
+	const FVector EndPt = StartPt + ShotDir.GetRotation().GetForwardVector() * (FVector::Dist(StartPt, AimPoint) + 50.0f);
+
+	UTCHitZoneSubsystem* HitZones = GetWorld()->GetSubsystem<UTCHitZoneSubsystem>();
+	check(HitZones);
+
+	// Test characters where the shooter saw them. Walls are left to the projectile, which still has to get there.
+	UTCLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UTCLagCompensationSubsystem>();
+	bOutRewound = LagCompensation && LagCompensation->IsRecording();
+
+	if (bOutRewound)
+	{
+		return LagCompensation->RewindTrace(StartPt, EndPt, ShotTime, Pawn, OutRewoundHit)
+			? HitZones->ResolveHitZone(OutRewoundHit) : EHitZone::Torso;
+	}
+
+	FCollisionQueryParams TraceParams(TEXT("WeaponTrace"), true, GetInstigator());
+	TraceParams.AddIgnoredActor(this);
+	TraceParams.AddIgnoredActor(Pawn);
+
+	FTCQueryRequest Request(ETCQuerySource::WeaponAim, this, TraceParams);
+	Request.Slot = 1;
+	Request.Start = StartPt;
+	Request.End = EndPt;
+	Request.Channel = ECollisionChannel::ECC_Visibility;
+
+	UTCPhysicsQuerySubsystem* Queries = GetWorld()->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
+
+	FHitResult Hit(ForceInit);
+	if (!Queries->Query(Request, Hit))
+	{
+		return EHitZone::Torso;
+	}
+
+	return HitZones->ResolveHitZone(Hit);
 }
 
 
@@ -620,75 +799,109 @@ void ABaseFirearm::SetStoredWeapon(const FInventoryWeapon& NewStored)
 
 FInventoryWeapon ABaseFirearm::GetStoredWeapon() const
 {
-	return StoredWeapon;
+	FInventoryWeapon CurrentStored = StoredWeapon;
+	CurrentStored.CurrMagAmmo = CurrentAmmoInClip;
+	CurrentStored.CurrReserveAmmo = CurrentReserveAmmo;
+	CurrentStored.CurrFireMode = CurrentFireMode;
+	CurrentStored.CurrWeaponState = CurrentState;
+
+	return CurrentStored;
 }
 
 
-FTransform ABaseFirearm::CalculateMainProjectileDirection(FName& BoneName)
+FVector ABaseFirearm::GetProjectileSpawnLocation() const
 {
 	auto SocketTransform = Mesh->GetSocketTransform(FName("Muzzle"));
-	auto MuzzlePos = SocketTransform.GetLocation()
-		+ (UKismetMathLibrary::GetForwardVector(SocketTransform.Rotator()) * 11.0);
+	return SocketTransform.GetLocation() + (UKismetMathLibrary::GetForwardVector(SocketTransform.Rotator()) * 11.0);
+}
 
-	auto PC = Cast<ATCPlayerController>(UGameplayStatics::GetPlayerController(GetWorld(), 0));
 
-	auto CameraTransform = PC->PlayerCameraManager->GetTransformComponent()->GetComponentTransform();
+FVector ABaseFirearm::CalculateAimPoint(EHitZone& HitZone)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_WeaponAimTrace);
 
-	auto StartPt = CameraTransform.GetLocation()
-		+ (UKismetMathLibrary::GetForwardVector(CameraTransform.Rotator())
-			* (CameraTransform.GetLocation() - MuzzlePos).Size());
+	const FVector MuzzlePos = GetProjectileSpawnLocation();
 
-	auto EndPt = CameraTransform.GetLocation()
-		+ (UKismetMathLibrary::GetForwardVector(CameraTransform.Rotator()) * 10000.0);
+	FVector StartPt;
+	FVector EndPt;
+	FVector HitPoint;
+	const FHitResult* AimHit = nullptr;
 
+	// Result of our own trace when we aren't player controlled
+	FHitResult Hit(ForceInit);
 
-	FCollisionQueryParams TraceParams(TEXT("WeaponTrace"), true, GetInstigator());
-	TraceParams.bReturnPhysicalMaterial = true;
-	TraceParams.AddIgnoredActor(this);
-	TraceParams.AddIgnoredActor(Pawn);
+	ATCPlayerController* PC = Pawn ? Cast<ATCPlayerController>(Pawn->GetController()) : nullptr;
+	if (PC)
+	{
+		// Players shoot where the camera looks, sharing the frame's aim trace with the crosshair
+		const FTCPlayerAim& Aim = PC->GetShotAim();
 
-	FHitResult Hit(ForceInit);
+		StartPt = Aim.Start;
+		EndPt = Aim.End;
+		HitPoint = Aim.GetAimPoint();
+		AimHit = Aim.bHit ? &Aim.Hit : nullptr;
+	}
+	else
+	{
+		// Everyone else aims along their own view rotation from the muzzle
+		StartPt = MuzzlePos;
+		EndPt = MuzzlePos + GetAdjustedAim() * 10000.0;
+		HitPoint = EndPt;
+
+		FCollisionQueryParams TraceParams(TEXT("WeaponTrace"), true, GetInstigator());
+		TraceParams.bReturnPhysicalMaterial = true;
+		TraceParams.AddIgnoredActor(this);
+		TraceParams.AddIgnoredActor(Pawn);
+
+		FTCQueryRequest Request(ETCQuerySource::WeaponAim, this, TraceParams);
+		Request.Start = StartPt;
+		Request.End = EndPt;
+		Request.Channel = ECollisionChannel::ECC_Visibility;
 
-	FVector HitPoint = EndPt;
+		UTCPhysicsQuerySubsystem* Queries = GetWorld()->GetSubsystem<UTCPhysicsQuerySubsystem>();
+		check(Queries);
 
-	if (GetWorld()->LineTraceSingleByChannel(Hit, StartPt, EndPt, ECollisionChannel::ECC_Visibility, TraceParams))
+		if (Queries->Query(Request, Hit))
+		{
+			HitPoint = Hit.ImpactPoint;
+			AimHit = &Hit;
+		}
+	}
+
+	if (AimHit)
 	{
-		HitPoint = Hit.ImpactPoint;
-		BoneName = Hit.BoneName;
+		// Body index -> zone lookup, no bone name compares
+		UTCHitZoneSubsystem* HitZones = GetWorld()->GetSubsystem<UTCHitZoneSubsystem>();
+		check(HitZones);
+		HitZone = HitZones->ResolveHitZone(*AimHit);
 	}
 
 	DrawDebugLine(GetWorld(), StartPt, EndPt, FColor::Green, false, 1, 0, 1);
 
-	auto ARot = UKismetMathLibrary::FindLookAtRotation(MuzzlePos, HitPoint);
-	auto BRot = FRotator(0.0f, 0.0f, 0.0f);//XMovepenalty, YMovepenalty, Zmovepenalty);
-
-	auto FinalRot = UKismetMathLibrary::ComposeRotators(ARot, BRot);
-
-	return FTransform(FinalRot, MuzzlePos, FVector(1.0, 1.0, 1.0));
+	return HitPoint;
 }
 
 
-FTransform ABaseFirearm::CalculateFinalProjectileDirection(const FTransform& MainDir, const float Spread)
+FTransform ABaseFirearm::CalculateFinalProjectileDirection(const FTransform& MainDir, const float Spread, FRandomStream& Stream)
 {
-	float Roll = UKismetMathLibrary::RandomFloatInRange(Spread * -1.0, Spread);
-	float Pitch = UKismetMathLibrary::RandomFloatInRange(Spread * -1.0, Spread);
-	float Yaw = UKismetMathLibrary::RandomFloatInRange(Spread * -1.0, Spread);
+	float Roll = Stream.FRandRange(Spread * -1.0, Spread);
+	float Pitch = Stream.FRandRange(Spread * -1.0, Spread);
+	float Yaw = Stream.FRandRange(Spread * -1.0, Spread);
 
 	return FTransform(UKismetMathLibrary::ComposeRotators(MainDir.Rotator(), FRotator(Pitch, Yaw, Roll)),
 		MainDir.GetLocation(), MainDir.GetScale3D());
 }
 
 
-bool ABaseFirearm::CalculateDamage(const FName& BoneName, float& DamageOut)
+bool ABaseFirearm::CalculateDamage(EHitZone HitZone, float& DamageOut, FRandomStream& Stream)
 {
 	const auto& DamageData = WeaponData.WeaponDamage;
-	DamageOut = UKismetMathLibrary::RandomFloatInRange(DamageData.MinDamage, DamageData.MaxDamage);
-	bool IsCrit = BoneName == TEXT("head");
+	DamageOut = Stream.FRandRange(DamageData.MinDamage, DamageData.MaxDamage);
 
-	// If we landed a crit, multiple our initial damage by our multiplier. Else, return our randomized damage
-	DamageOut = IsCrit ? (DamageOut * DamageData.HeadshotDamageMultiplier) : DamageOut;
+	// Scale our randomized damage by the zone we hit (headshot multiplier on a crit)
+	DamageOut *= DamageData.GetZoneMultiplier(HitZone);
 
-	return IsCrit;
+	return HitZone == EHitZone::Head;
 }
 
 
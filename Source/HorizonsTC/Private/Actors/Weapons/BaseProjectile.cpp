@@ -4,15 +4,23 @@
 #include "Actors/Weapons/BaseProjectile.h"
 
 #include "Character/TCBaseCharacter.h"
+#include "Game/TCDamageQueueSubsystem.h"
 #include "Components/SphereComponent.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Kismet/GameplayStatics.h"
 
 #include "Engine.h"
+#include "TCLatency.h"
+#include "TCStats.h"
+#include "TCMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Hit"), STAT_TC_ProjectileHit, STATGROUP_HorizonsTC_Weapons);
 
 // Sets default values
 ABaseProjectile::ABaseProjectile()
 {
+	TC_LLM_SCOPE(Projectiles);
+
 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = false;
 
@@ -72,15 +80,96 @@ void ABaseProjectile::InitializeProjectileStats(float fDamage, bool bCritHit, fl
 }
 
 
+void ABaseProjectile::SetCosmeticOnly(bool bCosmetic)
+{
+	bCosmeticOnly = bCosmetic;
+}
+
+
+void ABaseProjectile::SetRewoundHit(AActor* Target, float Distance)
+{
+	bLagCompensated = true;
+	RewoundTarget = Target;
+
+	if (Target)
+	{
+		// Land when the projectile gets to where the target was, unless the world stops it first
+		// Speed is the shot's speed from the weapon data; InitialSpeed is only the component default
+		const float FlightSpeed = Speed > 0.0f ? Speed : Projectile->Velocity.Size();
+		const float TimeToTarget = FlightSpeed > 0.0f ? Distance / FlightSpeed : 0.0f;
+		GetWorldTimerManager().SetTimer(TimerHandle_RewoundHit, this, &ABaseProjectile::ApplyRewoundHit,
+			FMath::Max(TimeToTarget, KINDA_SMALL_NUMBER), false);
+	}
+}
+
+
+void ABaseProjectile::ApplyRewoundHit()
+{
+	GetWorldTimerManager().ClearTimer(TimerHandle_RewoundHit);
+
+	if (AActor* Target = RewoundTarget.Get())
+	{
+		UTCDamageQueueSubsystem* DamageQueue = GetWorld()->GetSubsystem<UTCDamageQueueSubsystem>();
+		check(DamageQueue);
+		DamageQueue->QueueDamage(Target, Damage, GetInstigatorController(), nullptr);
+	}
+
+	RewoundTarget.Reset();
+}
+
+
+void ABaseProjectile::TrackFirstMove(double InShotTime, double InFireInputTime)
+{
+	ShotTime = InShotTime;
+	FireInputTime = InFireInputTime;
+
+	// Spawning has already placed the projectile, so the next transform update is the movement component's
+	if (!FirstMoveHandle.IsValid())
+	{
+		FirstMoveHandle = CollisionComp->TransformUpdated.AddUObject(this, &ABaseProjectile::OnFirstMove);
+	}
+}
+
+
+void ABaseProjectile::OnFirstMove(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	CollisionComp->TransformUpdated.Remove(FirstMoveHandle);
+	FirstMoveHandle.Reset();
+
+	FTCLatencyTracker::Get().MarkProjectileMoved(ShotTime, FireInputTime);
+}
+
+
 void ABaseProjectile::OnProjHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_ProjectileHit);
+
 	// See if hit actor is a character or not
 	auto Character = Cast<ATCBaseCharacter>(OtherActor);
 	bool HitCharacter = (Character != nullptr);
 
-	// Apply Damage
-	UGameplayStatics::ApplyDamage(OtherActor, Damage, UGameplayStatics::GetPlayerController(GetWorld(), 0), 
-		nullptr, UDamageType::StaticClass());
+	// Queue damage. It's applied after physics, summed with any other hits on the same actor this frame.
+	if (!bCosmeticOnly)
+	{
+		if (bLagCompensated && HitCharacter)
+		{
+			// Characters are where they are now, not where the shooter saw them. The rewound target takes the hit.
+			ApplyRewoundHit();
+		}
+		else
+		{
+			// The world got in the way before the projectile reached the rewound target
+			if (bLagCompensated)
+			{
+				GetWorldTimerManager().ClearTimer(TimerHandle_RewoundHit);
+				RewoundTarget.Reset();
+			}
+
+			UTCDamageQueueSubsystem* DamageQueue = GetWorld()->GetSubsystem<UTCDamageQueueSubsystem>();
+			check(DamageQueue);
+			DamageQueue->QueueDamage(OtherActor, Damage, GetInstigatorController(), nullptr);
+		}
+	}
 
 	// Spawn impact effect
 	FTransform SpawnTrans(FRotator::ZeroRotator, Hit.Location, FVector::OneVector);
@@ -0,0 +1,116 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Actors/Weapons/TCShotEvents.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Serialization/BitWriter.h"
+#include "TCLog.h"
+#include "TCStats.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Batches Sent"), STAT_TC_ShotBatchesSent, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Bits Sent"), STAT_TC_ShotBitsSent, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Batches Multicast"), STAT_TC_ShotBatchesMulticast, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Bits Multicast"), STAT_TC_ShotBitsMulticast, STATGROUP_HorizonsTC_Weapons);
+
+static FAutoConsoleCommand CmdDumpShotStats(
+	TEXT("tc.Net.DumpShotStats"),
+	TEXT("Logs the shot RPC totals and average bytes per shot for this process."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FTCShotNetCounters::Get().Dump();
+	}));
+
+bool FTCShotBatch::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	Ar << BaseTime;
+	Ar << StreamSeed;
+
+	uint8 NumShots = (uint8)FMath::Min(Shots.Num(), MaxShots);
+	Ar << NumShots;
+
+	if (Ar.IsLoading())
+	{
+		if (NumShots > MaxShots)
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return true;
+		}
+
+		Shots.SetNum(NumShots);
+	}
+
+	for (int32 i = 0; i < NumShots; ++i)
+	{
+		FTCShotEvent& Shot = Shots[i];
+
+		bool bShotSuccess = true;
+		Shot.AimPoint.NetSerialize(Ar, Map, bShotSuccess);
+		Ar << Shot.TimeOffsetMs;
+		Ar << Shot.ShotIndex;
+		Ar << Shot.FiringSpread;
+
+		if (Ar.IsLoading())
+		{
+			Shot.StreamSeed = StreamSeed;
+		}
+
+		bOutSuccess &= bShotSuccess;
+	}
+
+	return true;
+}
+
+FTCShotNetCounters& FTCShotNetCounters::Get()
+{
+	static FTCShotNetCounters Counters;
+	return Counters;
+}
+
+void FTCShotNetCounters::RecordBatch(FTCShotBatch& Batch, bool bMulticast)
+{
+	// Same serializer the RPC uses, so this is the payload size before packet and bunch headers
+	FBitWriter Writer(0, true);
+	bool bSuccess = true;
+	Batch.NetSerialize(Writer, nullptr, bSuccess);
+
+	const uint32 NumBits = (uint32)Writer.GetNumBits();
+	const uint32 NumShots = (uint32)FMath::Min(Batch.Shots.Num(), FTCShotBatch::MaxShots);
+
+	if (bMulticast)
+	{
+		BatchesMulticast++;
+		ShotsMulticast += NumShots;
+		BitsMulticast += NumBits;
+
+		INC_DWORD_STAT(STAT_TC_ShotBatchesMulticast);
+		INC_DWORD_STAT_BY(STAT_TC_ShotBitsMulticast, NumBits);
+	}
+	else
+	{
+		BatchesSent++;
+		ShotsSent += NumShots;
+		BitsSent += NumBits;
+
+		INC_DWORD_STAT(STAT_TC_ShotBatchesSent);
+		INC_DWORD_STAT_BY(STAT_TC_ShotBitsSent, NumBits);
+	}
+}
+
+void FTCShotNetCounters::Dump() const
+{
+	const auto BytesPerShot = [](uint64 Bits, uint64 NumShots)
+	{
+		return NumShots > 0 ? (double)Bits / 8.0 / (double)NumShots : 0.0;
+	};
+
+	UE_LOG(LogHorizonsTC, Log, TEXT("Shot RPCs: batches, shots, bytes, bytes/shot"));
+	UE_LOG(LogHorizonsTC, Log, TEXT("  Client -> server  %8llu %8llu %10llu %6.2f"), BatchesSent, ShotsSent, BitsSent / 8,
+	       BytesPerShot(BitsSent, ShotsSent));
+	UE_LOG(LogHorizonsTC, Log, TEXT("  Server -> clients %8llu %8llu %10llu %6.2f"), BatchesMulticast, ShotsMulticast,
+	       BitsMulticast / 8, BytesPerShot(BitsMulticast, ShotsMulticast));
+	UE_LOG(LogHorizonsTC, Log, TEXT("  Rejected by server %llu"), ShotsRejected);
+}
@@ -5,39 +5,101 @@
 
 #include "Character/TCBaseCharacter.h"
 
-void UTCNotifyStateEarlyBlendOut::NotifyTick(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation,
-                                             float FrameDeltaTime)
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+
+void UTCNotifyStateEarlyBlendOut::NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation,
+                                              float TotalDuration)
 {
-	if (!MeshComp || !MeshComp->GetAnimInstance())
+	UAnimInstance* AnimInstance = MeshComp ? MeshComp->GetAnimInstance() : nullptr;
+	ATCBaseCharacter* OwnerCharacter = MeshComp ? Cast<ATCBaseCharacter>(MeshComp->GetOwner()) : nullptr;
+	if (!AnimInstance || !OwnerCharacter)
 	{
 		return;
 	}
 
-	UAnimInstance* AnimInstance = MeshComp->GetAnimInstance();
-	ATCBaseCharacter* OwnerCharacter = Cast<ATCBaseCharacter>(MeshComp->GetOwner());
-	if (!OwnerCharacter)
+	FAnimMontageInstance* Instance = AnimInstance->GetActiveInstanceForMontage(ThisMontage);
+	if (!Instance)
 	{
 		return;
 	}
 
-	bool bStopMontage = false;
-	if (bCheckMovementState && OwnerCharacter->GetMovementState() == MovementStateEquals)
+	// The character may already be in a state that ends the montage
+	if (ShouldBlendOut(OwnerCharacter))
 	{
-		bStopMontage = true;
+		Instance->Stop(FAlphaBlend(BlendOutTime));
+		return;
 	}
-	else if (bCheckStance && OwnerCharacter->GetStance() == StanceEquals)
+
+	const int32 InstanceID = Instance->GetInstanceID();
+	OwnerCharacter->AddMontageStateListener(InstanceID, OwnerCharacter->OnCharacterStateChanged.AddUObject(
+		this, &UTCNotifyStateEarlyBlendOut::OnCharacterStateChanged, TWeakObjectPtr<USkeletalMeshComponent>(MeshComp), InstanceID));
+}
+
+void UTCNotifyStateEarlyBlendOut::NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation)
+{
+	UAnimInstance* AnimInstance = MeshComp ? MeshComp->GetAnimInstance() : nullptr;
+	ATCBaseCharacter* OwnerCharacter = MeshComp ? Cast<ATCBaseCharacter>(MeshComp->GetOwner()) : nullptr;
+	if (!AnimInstance || !OwnerCharacter)
 	{
-		bStopMontage = true;
+		return;
 	}
-	else if (bCheckMovementInput && OwnerCharacter->HasMovementInput())
+
+	// We aren't told which instance's window ended. A restarted montage's new instance is still inside its window,
+	// so only instances that are stopping or have left the window stop listening.
+	for (const FAnimMontageInstance* Instance : AnimInstance->MontageInstances)
 	{
-		bStopMontage = true;
+		if (Instance && Instance->Montage == ThisMontage && (!Instance->IsActive() || !IsInWindow(*Instance)))
+		{
+			OwnerCharacter->RemoveMontageStateListener(Instance->GetInstanceID());
+		}
 	}
+}
+
+bool UTCNotifyStateEarlyBlendOut::ShouldBlendOut(ATCBaseCharacter* Character) const
+{
+	return (bCheckMovementState && Character->GetMovementState() == MovementStateEquals)
+		|| (bCheckStance && Character->GetStance() == StanceEquals)
+		|| (bCheckMovementInput && Character->HasMovementInput());
+}
+
+bool UTCNotifyStateEarlyBlendOut::IsInWindow(const FAnimMontageInstance& Instance) const
+{
+	const float Position = Instance.GetPosition();
 
-	if (bStopMontage)
+	for (const FAnimNotifyEvent& Event : Instance.Montage->Notifies)
 	{
-		AnimInstance->Montage_Stop(BlendOutTime, ThisMontage);
+		if (Event.NotifyStateClass == this && Position >= Event.GetTriggerTime() && Position < Event.GetEndTriggerTime())
+		{
+			return true;
+		}
 	}
+
+	return false;
+}
+
+void UTCNotifyStateEarlyBlendOut::OnCharacterStateChanged(ATCBaseCharacter* Character,
+                                                         TWeakObjectPtr<USkeletalMeshComponent> MeshComp,
+                                                         int32 MontageInstanceID)
+{
+	UAnimInstance* AnimInstance = MeshComp.IsValid() ? MeshComp->GetAnimInstance() : nullptr;
+	FAnimMontageInstance* Instance = AnimInstance ? AnimInstance->GetMontageInstanceForID(MontageInstanceID) : nullptr;
+
+	// Also cleans up after instances whose NotifyEnd never came (e.g. the montage was terminated)
+	if (!Instance || !Instance->IsActive() || !IsInWindow(*Instance))
+	{
+		Character->RemoveMontageStateListener(MontageInstanceID);
+		return;
+	}
+
+	if (!ShouldBlendOut(Character))
+	{
+		return;
+	}
+
+	// Only this instance goes, not a newer one of the same montage. Nothing left to listen for.
+	Instance->Stop(FAlphaBlend(BlendOutTime));
+	Character->RemoveMontageStateListener(MontageInstanceID);
 }
 
 FString UTCNotifyStateEarlyBlendOut::GetNotifyName_Implementation() const
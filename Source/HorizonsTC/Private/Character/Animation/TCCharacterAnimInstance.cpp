@@ -6,9 +6,30 @@
 #include "Curves/CurveVector.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "TCStats.h"
+#include "TCMemory.h"
+#include "Game/TCMontageCacheSubsystem.h"
+#include "Game/TCPhysicsQuerySubsystem.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Anim Update"), STAT_TC_AnimUpdate, STATGROUP_HorizonsTC);
+DECLARE_CYCLE_STAT(TEXT("Aiming Values"), STAT_TC_AnimAimingValues, STATGROUP_HorizonsTC_Anim);
+DECLARE_CYCLE_STAT(TEXT("Layer Values"), STAT_TC_AnimLayerValues, STATGROUP_HorizonsTC_Anim);
+DECLARE_CYCLE_STAT(TEXT("Foot IK"), STAT_TC_AnimFootIK, STATGROUP_HorizonsTC_Anim);
+DECLARE_CYCLE_STAT(TEXT("Grounded Values"), STAT_TC_AnimGroundedValues, STATGROUP_HorizonsTC_Anim);
+DECLARE_CYCLE_STAT(TEXT("In Air Values"), STAT_TC_AnimInAirValues, STATGROUP_HorizonsTC_Anim);
+DECLARE_CYCLE_STAT(TEXT("Ragdoll Values"), STAT_TC_AnimRagdollValues, STATGROUP_HorizonsTC_Anim);
+
+static TAutoConsoleVariable<int32> CVarCacheDynamicMontages(
+	TEXT("tc.Anim.CacheDynamicMontages"),
+	1,
+	TEXT("Play transitions and turn-in-place animations through shared cached montages instead of building a new montage per play."),
+	ECVF_Default);
 
 void UTCCharacterAnimInstance::NativeInitializeAnimation()
 {
+	TC_LLM_SCOPE(Animation);
+
 	Super::NativeInitializeAnimation();
 	Character = Cast<ATCBaseCharacter>(TryGetPawnOwner());
 }
@@ -17,6 +38,9 @@ void UTCCharacterAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 {
 	Super::NativeUpdateAnimation(DeltaSeconds);
 
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_AnimUpdate);
+	TC_LLM_SCOPE(Animation);
+
 	if (!Character || DeltaSeconds == 0.0f)
 	{
 		// Fix character looking right on editor
@@ -26,6 +50,8 @@ void UTCCharacterAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 		return;
 	}
 
+	TC_PERF_PHASE(Character->GetPerfCounters(), AnimUpdate);
+
 	// Update rest of character information. Others are reflected into anim bp when they're set inside character class
 	Velocity = Character->GetCharacterMovement()->Velocity;
 	MovementInput = Character->GetMovementInput();
@@ -38,6 +64,8 @@ void UTCCharacterAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 
 	if (MovementState == EMovementState::Grounded)
 	{
+		SCOPE_CYCLE_COUNTER(STAT_TC_AnimGroundedValues);
+
 		// Check If Moving Or Not & Enable Movement Animations if IsMoving and HasMovementInput, or if the Speed is greater than 150.
 		const bool prevShouldMove = bShouldMove;
 		bShouldMove = ShouldMoveCheck();
@@ -96,9 +124,8 @@ void UTCCharacterAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 
 void UTCCharacterAnimInstance::PlayTransition(const FBMDynamicMontageParams& Parameters)
 {
-	PlaySlotAnimationAsDynamicMontage(Parameters.Animation, FName(TEXT("Grounded Slot")),
-	                                  Parameters.BlendInTime, Parameters.BlendOutTime, Parameters.PlayRate, 1,
-	                                  0.0f, Parameters.StartTime);
+	PlaySlotAnimationCached(Parameters.Animation, FName(TEXT("Grounded Slot")),
+	                        Parameters.BlendInTime, Parameters.BlendOutTime, Parameters.PlayRate, Parameters.StartTime);
 }
 
 void UTCCharacterAnimInstance::PlayTransitionChecked(const FBMDynamicMontageParams& Parameters)
@@ -115,9 +142,8 @@ void UTCCharacterAnimInstance::PlayDynamicTransition(float ReTriggerDelay, FBMDy
 	{
 		bCanPlayDynamicTransition = false;
 		// Play Dynamic Additive Transition Animation
-		PlaySlotAnimationAsDynamicMontage(Parameters.Animation, FName(TEXT("Grounded Slot")),
-		                                  Parameters.BlendInTime, Parameters.BlendOutTime, Parameters.PlayRate, 1,
-		                                  0.0f, Parameters.StartTime);
+		PlaySlotAnimationCached(Parameters.Animation, FName(TEXT("Grounded Slot")),
+		                        Parameters.BlendInTime, Parameters.BlendOutTime, Parameters.PlayRate, Parameters.StartTime);
 
 		UWorld* World = GetWorld();
 		check(World);
@@ -168,6 +194,8 @@ void UTCCharacterAnimInstance::OnPivotDelay()
 
 void UTCCharacterAnimInstance::UpdateAimingValues(float DeltaSeconds)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_AnimAimingValues);
+
 	// Interp the Aiming Rotation value to achieve smooth aiming rotation changes.
 	// Interpolating the rotation before calculating the angle ensures the value is not affected by changes
 	// in actor rotation, allowing slow aiming rotation changes with fast actor rotation changes.
@@ -230,6 +258,8 @@ void UTCCharacterAnimInstance::UpdateAimingValues(float DeltaSeconds)
 
 void UTCCharacterAnimInstance::UpdateLayerValues()
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_AnimLayerValues);
+
 	// Get the Aim Offset weight by getting the opposite of the Aim Offset Mask.
 	EnableAimOffset = FMath::Lerp(1.0f, 0.0f, GetCurveValue(FName(TEXT("Mask_AimOffset"))));
 	// Set the Base Pose weights
@@ -258,6 +288,9 @@ void UTCCharacterAnimInstance::UpdateLayerValues()
 
 void UTCCharacterAnimInstance::UpdateFootIK(float DeltaSeconds)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_AnimFootIK);
+	TC_PERF_PHASE(Character->GetPerfCounters(), FootIK);
+
 	// Update Foot Locking values.
 	SetFootLocking(DeltaSeconds, FName(TEXT("Enable_FootIK_L")), FName(TEXT("FootLock_L")),
 	               FName(TEXT("ik_foot_l")), FootLock_L_Alpha,
@@ -405,15 +438,21 @@ void UTCCharacterAnimInstance::SetFootOffsets(float DeltaSeconds, FName EnableFo
 
 	UWorld* World = GetWorld();
 	check(World);
+	UTCPhysicsQuerySubsystem* Queries = World->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
 
 	FCollisionQueryParams Params;
 	Params.AddIgnoredActor(Character);
 
+	FTCQueryRequest Request(ETCQuerySource::FootIK, Character, Params);
+	Request.Slot = GetTypeHash(IKFootBone);
+	Request.Start = IKFootFloorLoc + FVector(0.0, 0.0, IK_TraceDistanceAboveFoot);
+	Request.End = IKFootFloorLoc - FVector(0.0, 0.0, IK_TraceDistanceBelowFoot);
+	Request.Channel = ECollisionChannel::ECC_Visibility;
+
 	FHitResult HitResult;
-	World->LineTraceSingleByChannel(HitResult,
-	                                IKFootFloorLoc + FVector(0.0, 0.0, IK_TraceDistanceAboveFoot),
-	                                IKFootFloorLoc - FVector(0.0, 0.0, IK_TraceDistanceBelowFoot),
-	                                ECollisionChannel::ECC_Visibility, Params);
+	TC_PERF_QUERY(Character->GetPerfCounters(), FootIKQuery);
+	Queries->Query(Request, HitResult);
 
 	FRotator TargetRotOffset = FRotator::ZeroRotator;
 	if (Character->GetCharacterMovement()->IsWalkable(HitResult))
@@ -575,6 +614,8 @@ void UTCCharacterAnimInstance::UpdateRotationValues()
 
 void UTCCharacterAnimInstance::UpdateInAirValues(float DeltaSeconds)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_AnimInAirValues);
+
 	// Update the fall speed. Setting this value only while in the air allows you to use it within the AnimGraph for the landing strength.
 	// If not, the Z velocity would return to 0 on landing.
 	FallSpeed = Velocity.Z;
@@ -592,6 +633,8 @@ void UTCCharacterAnimInstance::UpdateInAirValues(float DeltaSeconds)
 
 void UTCCharacterAnimInstance::UpdateRagdollValues()
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_AnimRagdollValues);
+
 	// Scale the Flail Rate by the velocity length. The faster the ragdoll moves, the faster the character will flail.
 	const float VelocityLength = GetOwningComponent()->GetPhysicsLinearVelocity(FName(TEXT("root"))).Size();
 	FlailRate = FMath::GetMappedRangeValueClamped(FVector2D(0.0f, 1000.0f), FVector2D(0.0f, 1.0f), VelocityLength);
@@ -697,6 +740,8 @@ float UTCCharacterAnimInstance::CalculateLandPrediction()
 	// Calculate the land prediction weight by tracing in the velocity direction to find a walkable surface the character
 	// is falling toward, and getting the 'Time' (range of 0-1, 1 being maximum, 0 being about to land) till impact.
 	// The Land Prediction Curve is used to control how the time affects the final weight for a smooth blend. 
+	TC_PERF_PHASE(Character->GetPerfCounters(), LandPrediction);
+
 	if (FallSpeed >= -200.0f)
 	{
 		return 0.0f;
@@ -713,13 +758,21 @@ float UTCCharacterAnimInstance::CalculateLandPrediction()
 
 	UWorld* World = GetWorld();
 	check(World);
+	UTCPhysicsQuerySubsystem* Queries = World->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
 
 	FCollisionQueryParams Params;
 	Params.AddIgnoredActor(Character);
 
+	FTCQueryRequest Request(ETCQuerySource::LandPrediction, Character, Params);
+	Request.Start = CapsuleWorldLoc;
+	Request.End = CapsuleWorldLoc + TraceLength;
+	Request.Shape = Character->GetCapsuleComponent()->GetCollisionShape();
+	Request.ProfileName = FName(TEXT("ALS_Character"));
+
 	FHitResult HitResult;
-	World->SweepSingleByProfile(HitResult, CapsuleWorldLoc, CapsuleWorldLoc + TraceLength, FQuat::Identity, FName(TEXT("ALS_Character")),
-	                            Character->GetCapsuleComponent()->GetCollisionShape(), Params);
+	TC_PERF_QUERY(Character->GetPerfCounters(), LandPredictionQuery);
+	Queries->Query(Request, HitResult);
 
 	if (Character->GetCharacterMovement()->IsWalkable(HitResult))
 	{
@@ -839,8 +892,8 @@ void UTCCharacterAnimInstance::TurnInPlace(FRotator TargetRotation, float PlayRa
 	{
 		return;
 	}
-	PlaySlotAnimationAsDynamicMontage(TargetTurnAsset.Animation, TargetTurnAsset.SlotName, 0.2f, 0.2f,
-	                                  TargetTurnAsset.PlayRate * PlayRateScale, 1, 0.0f, StartTime);
+	PlaySlotAnimationCached(TargetTurnAsset.Animation, TargetTurnAsset.SlotName, 0.2f, 0.2f,
+	                        TargetTurnAsset.PlayRate * PlayRateScale, StartTime);
 
 	// Step 4: Scale the rotation amount (gets scaled in animgraph) to compensate for turn angle (If Allowed) and play rate.
 	if (TargetTurnAsset.ScaleTurnAngle)
@@ -853,6 +906,24 @@ void UTCCharacterAnimInstance::TurnInPlace(FRotator TargetRotation, float PlayRa
 	}
 }
 
+void UTCCharacterAnimInstance::PlaySlotAnimationCached(UAnimSequenceBase* Asset, FName SlotName, float BlendInTime,
+                                                       float BlendOutTime, float PlayRate, float StartTime)
+{
+	UTCMontageCacheSubsystem* MontageCache = GetWorld() ? GetWorld()->GetSubsystem<UTCMontageCacheSubsystem>() : nullptr;
+	if (!MontageCache || CVarCacheDynamicMontages.GetValueOnGameThread() == 0)
+	{
+		PlaySlotAnimationAsDynamicMontage(Asset, SlotName, BlendInTime, BlendOutTime, PlayRate, 1, 0.0f, StartTime);
+		return;
+	}
+
+	// Blend out trigger time 0 blends out once the montage ends, as the dynamic montages did
+	UAnimMontage* Montage = MontageCache->FindOrCreateMontage(Asset, SlotName, BlendInTime, BlendOutTime, 1, 0.0f);
+	if (Montage)
+	{
+		Montage_Play(Montage, PlayRate, EMontagePlayReturnType::MontageLength, StartTime);
+	}
+}
+
 void UTCCharacterAnimInstance::OnJumped()
 {
 	bJumped = true;
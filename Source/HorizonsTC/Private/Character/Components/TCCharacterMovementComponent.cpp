@@ -0,0 +1,267 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Character/Components/TCCharacterMovementComponent.h"
+
+#include "Character/TCBaseCharacter.h"
+#include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+#include "TCLog.h"
+#include "TCStats.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Movement Corrections"), STAT_TC_MovementCorrections, STATGROUP_HorizonsTC_Character);
+
+static TAutoConsoleVariable<int32> CVarLogCorrections(
+	TEXT("tc.Movement.LogCorrections"),
+	0,
+	TEXT("Log every movement correction the server sends this client, with the position error and predicted locomotion state."),
+	ECVF_Default);
+
+namespace
+{
+	// Aiming never sprints (see ATCBaseCharacter::GetAllowedGait), so its two gaits follow the six looking/velocity ones
+	constexpr uint8 NumGaits = 3;
+	constexpr uint8 AimingBase = 2 * NumGaits;
+	constexpr uint8 LocomotionShift = 4;
+	constexpr uint8 LocomotionMask = 0x7 << LocomotionShift;
+}
+
+/************************************************************************/
+/* Movement Component                                                   */
+/************************************************************************/
+
+UTCCharacterMovementComponent::UTCCharacterMovementComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	static_assert(FSavedMove_Character::FLAG_Custom_0 == 1 << LocomotionShift, "Locomotion flags expect FLAG_Custom_0-2");
+}
+
+void UTCCharacterMovementComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	TCCharacterOwner = Cast<ATCBaseCharacter>(GetOwner());
+}
+
+void UTCCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType,
+                                                  FActorComponentTickFunction* ThisTickFunction)
+{
+	// Whoever controls the character decides its locomotion state. Snapshot it before this frame's move is saved.
+	if (TCCharacterOwner && TCCharacterOwner->IsLocallyControlled())
+	{
+		PredictedRotationMode = TCCharacterOwner->GetRotationMode();
+		PredictedGait = TCCharacterOwner->GetAllowedGait();
+	}
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+}
+
+void UTCCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	UnpackLocomotionFlags(Flags, PredictedRotationMode, PredictedGait);
+	bWantsJumpJets = (Flags & FSavedMove_Character::FLAG_Custom_3) != 0;
+
+	// Sprinting is only allowed if the server agrees it's enabled
+	if (PredictedGait == EGait::Sprinting && TCCharacterOwner && TCCharacterOwner->bSprintDisabled)
+	{
+		PredictedGait = EGait::Running;
+	}
+}
+
+void UTCCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	if (!TCCharacterOwner)
+	{
+		return;
+	}
+
+	// Step 1: The server's copy of a client's character takes on the client's rotation mode.
+	if (IsDrivenByRemoteMoves() && TCCharacterOwner->GetRotationMode() != PredictedRotationMode)
+	{
+		TCCharacterOwner->SetRotationMode(PredictedRotationMode);
+	}
+
+	// Step 2: Move with the speeds and acceleration of the move's gait. Standalone, the character's tick already did.
+	if (IsMovingOnGround() && GetNetMode() != NM_Standalone)
+	{
+		TCCharacterOwner->UpdateDynamicMovementSettings(PredictedGait, PredictedRotationMode);
+	}
+
+	// Step 3: Jump jets launch inside the move so the launch is part of what's predicted.
+	if (bWantsJumpJets)
+	{
+		bWantsJumpJets = false;
+
+		if (IsFalling() && TCCharacterOwner->CanJumpJet())
+		{
+			TCCharacterOwner->JumpJets();
+			TCCharacterOwner->bJumpJetsOnCooldown = true;
+		}
+	}
+}
+
+bool UTCCharacterMovementComponent::ClientUpdatePositionAfterServerUpdate()
+{
+	// Replaying saved moves leaves their locomotion state behind. Keep this frame's, which isn't saved yet.
+	const EGait RealGait = PredictedGait;
+	const ERotationMode RealRotationMode = PredictedRotationMode;
+	const bool bRealWantsJumpJets = bWantsJumpJets;
+	const bool bRealJumpJetsOnCooldown = TCCharacterOwner && TCCharacterOwner->bJumpJetsOnCooldown;
+
+	const bool bResult = Super::ClientUpdatePositionAfterServerUpdate();
+
+	PredictedGait = RealGait;
+	PredictedRotationMode = RealRotationMode;
+	bWantsJumpJets = bRealWantsJumpJets;
+	if (TCCharacterOwner)
+	{
+		TCCharacterOwner->bJumpJetsOnCooldown = bRealJumpJetsOnCooldown;
+	}
+
+	return bResult;
+}
+
+FNetworkPredictionData_Client* UTCCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		UTCCharacterMovementComponent* MutableThis = const_cast<UTCCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_TC(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UTCCharacterMovementComponent::OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData,
+                                                               float TimeStamp, FVector NewLocation, FVector NewVelocity,
+                                                               UPrimitiveComponent* NewBase, FName NewBaseBoneName,
+                                                               bool bHasBase, bool bBaseRelativePosition,
+                                                               uint8 ServerMovementMode)
+{
+	Super::OnClientCorrectionReceived(ClientData, TimeStamp, NewLocation, NewVelocity, NewBase, NewBaseBoneName, bHasBase,
+	                                  bBaseRelativePosition, ServerMovementMode);
+
+	INC_DWORD_STAT(STAT_TC_MovementCorrections);
+	++NumCorrections;
+
+	if (CVarLogCorrections.GetValueOnGameThread() != 0)
+	{
+		const FVector ClientLocation = UpdatedComponent ? UpdatedComponent->GetComponentLocation() : FVector::ZeroVector;
+		UE_LOG(LogHorizonsTC, Log, TEXT("%s: movement correction #%d at %.3f, error %.1f cm (gait %d, rotation mode %d)"),
+			*GetNameSafe(CharacterOwner), NumCorrections, TimeStamp, FVector::Dist(ClientLocation, NewLocation),
+			(int32)PredictedGait, (int32)PredictedRotationMode);
+	}
+}
+
+bool UTCCharacterMovementComponent::IsDrivenByRemoteMoves() const
+{
+	return CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_Authority
+		&& CharacterOwner->GetRemoteRole() == ROLE_AutonomousProxy;
+}
+
+uint8 UTCCharacterMovementComponent::PackLocomotionFlags(ERotationMode RotationMode, EGait Gait)
+{
+	const uint8 Packed = RotationMode == ERotationMode::Aiming
+		? AimingBase + FMath::Min((uint8)Gait, (uint8)EGait::Running)
+		: (uint8)RotationMode * NumGaits + (uint8)Gait;
+
+	return Packed << LocomotionShift;
+}
+
+void UTCCharacterMovementComponent::UnpackLocomotionFlags(uint8 Flags, ERotationMode& OutRotationMode, EGait& OutGait)
+{
+	const uint8 Packed = (Flags & LocomotionMask) >> LocomotionShift;
+
+	if (Packed >= AimingBase)
+	{
+		OutRotationMode = ERotationMode::Aiming;
+		OutGait = (EGait)(Packed - AimingBase);
+	}
+	else
+	{
+		OutRotationMode = (ERotationMode)(Packed / NumGaits);
+		OutGait = (EGait)(Packed % NumGaits);
+	}
+}
+
+/************************************************************************/
+/* Saved Move                                                           */
+/************************************************************************/
+
+void FSavedMove_TC::Clear()
+{
+	Super::Clear();
+
+	SavedGait = EGait::Running;
+	SavedRotationMode = ERotationMode::LookingDirection;
+	bSavedWantsJumpJets = false;
+	bSavedJumpJetsOnCooldown = false;
+}
+
+uint8 FSavedMove_TC::GetCompressedFlags() const
+{
+	uint8 Flags = Super::GetCompressedFlags();
+
+	Flags |= UTCCharacterMovementComponent::PackLocomotionFlags(SavedRotationMode, SavedGait);
+
+	if (bSavedWantsJumpJets)
+	{
+		Flags |= FLAG_Custom_3;
+	}
+
+	return Flags;
+}
+
+bool FSavedMove_TC::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_TC* TCMove = static_cast<const FSavedMove_TC*>(NewMove.Get());
+
+	if (SavedGait != TCMove->SavedGait || SavedRotationMode != TCMove->SavedRotationMode
+		|| bSavedWantsJumpJets != TCMove->bSavedWantsJumpJets)
+	{
+		return false;
+	}
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_TC::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel,
+                               FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	const UTCCharacterMovementComponent* Movement = Cast<UTCCharacterMovementComponent>(C->GetCharacterMovement());
+	if (Movement)
+	{
+		SavedGait = Movement->PredictedGait;
+		SavedRotationMode = Movement->PredictedRotationMode;
+		bSavedWantsJumpJets = Movement->bWantsJumpJets;
+	}
+
+	if (const ATCBaseCharacter* Character = Cast<ATCBaseCharacter>(C))
+	{
+		bSavedJumpJetsOnCooldown = Character->bJumpJetsOnCooldown;
+	}
+}
+
+void FSavedMove_TC::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+
+	UTCCharacterMovementComponent* Movement = Cast<UTCCharacterMovementComponent>(C->GetCharacterMovement());
+	if (Movement)
+	{
+		Movement->PredictedGait = SavedGait;
+		Movement->PredictedRotationMode = SavedRotationMode;
+		Movement->bWantsJumpJets = bSavedWantsJumpJets;
+	}
+
+	if (ATCBaseCharacter* Character = Cast<ATCBaseCharacter>(C))
+	{
+		Character->bJumpJetsOnCooldown = bSavedJumpJetsOnCooldown;
+	}
+}
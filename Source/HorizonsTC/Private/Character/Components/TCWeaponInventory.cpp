@@ -0,0 +1,33 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#include "Character/Components/TCWeaponInventory.h"
+#include "Character/Components/WeaponComponent.h"
+
+void FTCInventoryEntry::PreReplicatedRemove(const FTCWeaponInventory& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnInventoryEntryRemoved(*this);
+	}
+}
+
+void FTCInventoryEntry::PostReplicatedAdd(const FTCWeaponInventory& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnInventoryEntryReplicated(*this);
+	}
+}
+
+void FTCInventoryEntry::PostReplicatedChange(const FTCWeaponInventory& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnInventoryEntryReplicated(*this);
+	}
+}
+
+FTCInventoryEntry* FTCWeaponInventory::FindSlot(int32 Slot)
+{
+	return Items.FindByPredicate([Slot](const FTCInventoryEntry& Entry) { return Entry.Slot == Slot; });
+}
@@ -5,9 +5,38 @@
 #include "Character/TCCharacter.h"
 #include "Actors/Weapons/BaseFirearm.h"
 
+#include "Components/StaticMeshComponent.h"
 #include "Engine/DataTable.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/IConsoleManager.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "Net/UnrealNetwork.h"
+#include "TCStats.h"
+#include "TCMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spawn Weapons"), STAT_TC_SpawnWeapons, STATGROUP_HorizonsTC_Weapons);
+DECLARE_CYCLE_STAT(TEXT("Switch Weapon"), STAT_TC_SwitchWeapon, STATGROUP_HorizonsTC_Weapons);
+DECLARE_CYCLE_STAT(TEXT("Validate Shots"), STAT_TC_ValidateShots, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory Entries Dirtied"), STAT_TC_InventoryEntriesDirtied, STATGROUP_HorizonsTC_Weapons);
+
+static TAutoConsoleVariable<float> CVarMaxShotAge(
+	TEXT("tc.Net.MaxShotAge"),
+	1.0f,
+	TEXT("Seconds a client's shot time may differ from the server's clock before the shot is rejected."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFireRateTolerance(
+	TEXT("tc.Net.FireRateTolerance"),
+	0.2f,
+	TEXT("Fraction of the time between shots a client's shots may come early (jitter) before they're rejected."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMaxShotRange(
+	TEXT("tc.Net.MaxShotRange"),
+	15000.0f,
+	TEXT("Furthest a client's aim point may be from the shooter."),
+	ECVF_Default);
 
 // Sets default values for this component's properties
 UWeaponComponent::UWeaponComponent()
@@ -16,8 +45,17 @@ UWeaponComponent::UWeaponComponent()
 	// off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = true;
 
+	// Tick after everything else so the frame's shots (input, timers) go out in one batch
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	// Carries shot RPCs for networked games
+	SetIsReplicatedByDefault(true);
+
 	MaxWeapons = 2;
 	CurrentWeaponIdx = -1;
+	bLazyHolsteredWeapons = false;
+	LastValidatedShotTime = TNumericLimits<float>::Lowest();
+	ReplicatedInventory.Owner = this;
 
 	// Find weapon data table
 	static ConstructorHelpers::FObjectFinder<UDataTable> WeaponsObject(*(UTCStatics::WEAPON_DB_PATH));
@@ -47,6 +85,8 @@ void UWeaponComponent::UpdateWeaponHUD()
 
 void UWeaponComponent::SwitchWeapon(int32 WeaponIndex, bool Equip)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_SwitchWeapon);
+
 	if (WeaponIndex < WeaponInventory.Num())
 	{
 		UnequipWeapon();
@@ -62,44 +102,222 @@ void UWeaponComponent::SwitchWeapon(int32 WeaponIndex, bool Equip)
 
 void UWeaponComponent::SpawnWeapons()
 {
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_SpawnWeapons);
+	TC_LLM_SCOPE(Weapons);
+
 	int i = 0;
 	for (const auto& wep : InitialInventory)
 	{
 		// Search WeaponDB for specified weapon
-		static const FString ContextString(TEXT("Weapon Data"));
-		FWeaponData* WeaponInfo = WeaponsData->FindRow<FWeaponData>(wep.WeaponID, ContextString, true);
+		FWeaponData* WeaponInfo = FindWeaponData(wep.WeaponID);
 		if (WeaponInfo != nullptr)
 		{
-			// Begin spawning the weapon to fill variables used in construction script
-			ABaseFirearm* SpawnedWeapon = Cast<ABaseFirearm>(UGameplayStatics::BeginDeferredActorSpawnFromClass(
-				GetWorld(), WeaponClass, FTransform(), ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn
-			));
-			
-			// Populate member variables
-			SpawnedWeapon->SetOwner(OwningCharacter);
-			SpawnedWeapon->SetOwningPawn(OwningCharacter);
-			SpawnedWeapon->SetStoredWeapon(wep);
-			SpawnedWeapon->SetWeaponData(*WeaponInfo);
-
-			// Finish Spawning
-			UGameplayStatics::FinishSpawningActor(SpawnedWeapon, FTransform());
-
-			// Add to inventory
-			WeaponInventory.Add(SpawnedWeapon);
-
-			// Attach to character's holster socket if the component has an unequip socket specified
-			if (WeaponUnequipSockets.IsValidIndex(i))
+			UStaticMeshComponent* HolsterMesh = nullptr;
+
+			if (bLazyHolsteredWeapons)
+			{
+				// The firearm isn't spawned until it's drawn, only its holster mesh is shown
+				WeaponInventory.Add(nullptr);
+
+				if (WeaponUnequipSockets.IsValidIndex(i))
+				{
+					HolsterMesh = CreateHolsterMesh(WeaponUnequipSockets[i], *WeaponInfo);
+				}
+			}
+			else
 			{
-				SpawnedWeapon->AttachMeshToPawn(WeaponUnequipSockets[i]);
-				SpawnedWeapon->AddActorLocalRotation(WeaponInfo->DirectionFix);
+				ABaseFirearm* SpawnedWeapon = SpawnFirearm(wep, *WeaponInfo);
+
+				// Add to inventory
+				WeaponInventory.Add(SpawnedWeapon);
+
+				// Attach to character's holster socket if the component has an unequip socket specified
+				if (WeaponUnequipSockets.IsValidIndex(i))
+				{
+					SpawnedWeapon->AttachMeshToPawn(WeaponUnequipSockets[i]);
+					SpawnedWeapon->AddActorLocalRotation(WeaponInfo->DirectionFix);
+				}
 			}
+
+			StoredInventory.Add(wep);
+			HolsterMeshes.Add(HolsterMesh);
 			OwningCharacter->SetIsArmed(true);
 		}
 		i++;
 	}
 
+	// In networked games the server picks every slot's shot stream, so a client can't choose its own rolls
+	NextShotIndices.Init(0, StoredInventory.Num());
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ShotStreamSeeds.Reset(StoredInventory.Num());
+		for (const FInventoryWeapon& Stored : StoredInventory)
+		{
+			ShotStreamSeeds.Add(ABaseFirearm::PickStreamSeed(Stored.WeaponID));
+		}
+	}
+
+	for (int32 Slot = 0; Slot < WeaponInventory.Num(); ++Slot)
+	{
+		RestoreShotStream(Slot);
+	}
+
 	// Set weapon in first loadout slot as current
 	SwitchWeapon(0, false);
+
+	// The server starts replicating the inventory. Clients apply whatever arrived before their weapons existed.
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		for (int32 Slot = 0; Slot < StoredInventory.Num(); ++Slot)
+		{
+			UpdateReplicatedSlot(Slot);
+		}
+	}
+	else
+	{
+		for (const FTCInventoryEntry& Entry : ReplicatedInventory.Items)
+		{
+			OnInventoryEntryReplicated(Entry);
+		}
+	}
+}
+
+FWeaponData* UWeaponComponent::FindWeaponData(FName WeaponID) const
+{
+	static const FString ContextString(TEXT("Weapon Data"));
+	return WeaponsData ? WeaponsData->FindRow<FWeaponData>(WeaponID, ContextString, true) : nullptr;
+}
+
+ABaseFirearm* UWeaponComponent::SpawnFirearm(const FInventoryWeapon& Stored, const FWeaponData& Data)
+{
+	TC_LLM_SCOPE(Weapons);
+
+	// Begin spawning the weapon to fill variables used in construction script
+	ABaseFirearm* SpawnedWeapon = Cast<ABaseFirearm>(UGameplayStatics::BeginDeferredActorSpawnFromClass(
+		GetWorld(), WeaponClass, FTransform(), ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn
+	));
+
+	// Populate member variables
+	SpawnedWeapon->SetOwner(OwningCharacter);
+	SpawnedWeapon->SetOwningPawn(OwningCharacter);
+	SpawnedWeapon->SetStoredWeapon(Stored);
+	SpawnedWeapon->SetWeaponData(Data);
+
+	// Finish Spawning
+	UGameplayStatics::FinishSpawningActor(SpawnedWeapon, FTransform());
+
+	return SpawnedWeapon;
+}
+
+UStaticMeshComponent* UWeaponComponent::CreateHolsterMesh(FName Socket, const FWeaponData& Data)
+{
+	if (!Data.HolsterMesh || !OwningCharacter)
+	{
+		return nullptr;
+	}
+
+	// Purely visual: no collision, overlaps or navigation
+	UStaticMeshComponent* HolsterMesh = NewObject<UStaticMeshComponent>(OwningCharacter);
+	HolsterMesh->SetStaticMesh(Data.HolsterMesh);
+	HolsterMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	HolsterMesh->SetGenerateOverlapEvents(false);
+	HolsterMesh->SetCanEverAffectNavigation(false);
+	HolsterMesh->SetupAttachment(OwningCharacter->GetMesh(), Socket);
+	HolsterMesh->SetRelativeRotation(Data.DirectionFix);
+	HolsterMesh->RegisterComponent();
+
+	return HolsterMesh;
+}
+
+ABaseFirearm* UWeaponComponent::MaterializeWeapon(int32 WeaponIndex)
+{
+	if (!WeaponInventory.IsValidIndex(WeaponIndex))
+	{
+		return nullptr;
+	}
+
+	if (WeaponInventory[WeaponIndex] == nullptr)
+	{
+		FWeaponData* WeaponInfo = FindWeaponData(StoredInventory[WeaponIndex].WeaponID);
+		if (WeaponInfo == nullptr)
+		{
+			return nullptr;
+		}
+
+		WeaponInventory[WeaponIndex] = SpawnFirearm(StoredInventory[WeaponIndex], *WeaponInfo);
+		RestoreShotStream(WeaponIndex);
+		SetHolsterMeshVisible(WeaponIndex, false);
+	}
+
+	return WeaponInventory[WeaponIndex];
+}
+
+void UWeaponComponent::ReleaseWeapon(int32 WeaponIndex, bool ReturnToHolster)
+{
+	ABaseFirearm* Weapon = WeaponInventory.IsValidIndex(WeaponIndex) ? WeaponInventory[WeaponIndex] : nullptr;
+	if (Weapon == nullptr)
+	{
+		return;
+	}
+
+	Weapon->StopFire();
+
+	// Keep ammo and fire mode. Anything in progress (firing, reloading) is cancelled by holstering.
+	FInventoryWeapon Stored = Weapon->GetStoredWeapon();
+	Stored.CurrWeaponState = EWeaponState::Idle;
+	Stored.AttachedSocket = ReturnToHolster && WeaponUnequipSockets.IsValidIndex(WeaponIndex)
+		? WeaponUnequipSockets[WeaponIndex] : UTCStatics::EMPTY_SOCKET;
+	StoredInventory[WeaponIndex] = Stored;
+
+	// The slot's shot stream carries on where this weapon left it
+	if (NextShotIndices.IsValidIndex(WeaponIndex))
+	{
+		NextShotIndices[WeaponIndex] = Weapon->GetNextShotIndex();
+	}
+
+	WeaponInventory[WeaponIndex] = nullptr;
+	if (CurrentWeapon == Weapon)
+	{
+		CurrentWeapon = nullptr;
+	}
+	Weapon->Destroy();
+
+	SetHolsterMeshVisible(WeaponIndex, ReturnToHolster);
+}
+
+void UWeaponComponent::RestoreShotStream(int32 WeaponIndex)
+{
+	ABaseFirearm* Weapon = WeaponInventory.IsValidIndex(WeaponIndex) ? WeaponInventory[WeaponIndex] : nullptr;
+	if (!Weapon || GetNetMode() == NM_Standalone || !ShotStreamSeeds.IsValidIndex(WeaponIndex))
+	{
+		return;
+	}
+
+	const uint16 NextIndex = NextShotIndices.IsValidIndex(WeaponIndex) ? NextShotIndices[WeaponIndex] : 0;
+	Weapon->SetStreamSeed(ShotStreamSeeds[WeaponIndex], NextIndex);
+}
+
+void UWeaponComponent::OnRep_ShotStreamSeeds()
+{
+	for (int32 Slot = 0; Slot < WeaponInventory.Num(); ++Slot)
+	{
+		// Shots fired before the seed arrived have used up their indices. The server expects the next one.
+		if (WeaponInventory[Slot] && NextShotIndices.IsValidIndex(Slot))
+		{
+			NextShotIndices[Slot] = WeaponInventory[Slot]->GetNextShotIndex();
+		}
+
+		RestoreShotStream(Slot);
+	}
+}
+
+void UWeaponComponent::SetHolsterMeshVisible(int32 WeaponIndex, bool bVisible)
+{
+	if (HolsterMeshes.IsValidIndex(WeaponIndex) && HolsterMeshes[WeaponIndex])
+	{
+		HolsterMeshes[WeaponIndex]->SetVisibility(bVisible);
+	}
 }
 
 void UWeaponComponent::SwitchFireMode()
@@ -139,10 +357,18 @@ void UWeaponComponent::SwitchFireMode()
 		}
 		break;
 	}
+
+	UpdateReplicatedSlot(CurrentWeaponIdx);
 }
 
 void UWeaponComponent::EquipWeapon(int32 WeaponIndex)
 {
+	// Lazily holstered weapons only get an actor once they're drawn
+	if (bLazyHolsteredWeapons && !CurrentWeapon && WeaponIndex == CurrentWeaponIdx)
+	{
+		CurrentWeapon = MaterializeWeapon(WeaponIndex);
+	}
+
 	if (CurrentWeapon) {
 		// Find the correct socket and equip the weapon
 		auto EquipSocket = WeaponEquipSockets.Find(WeaponInventory[WeaponIndex]->GetWeaponData().WeaponType);
@@ -181,6 +407,12 @@ void UWeaponComponent::EquipWeapon(int32 WeaponIndex)
 		default:
 			OwningCharacter->SetOverlayState(EOverlayState::Rifle);
 		}
+
+		if (GetOwnerRole() == ROLE_AutonomousProxy)
+		{
+			ServerSetEquippedWeapon(WeaponIndex, true, false);
+		}
+		UpdateReplicatedSlot(WeaponIndex);
 	}
 }
 
@@ -195,8 +427,13 @@ void UWeaponComponent::UnequipWeapon(bool ReturnToHolster)
 	{
 		CurrentWeapon->DetachMeshFromPawn();
 
+		if (bLazyHolsteredWeapons)
+		{
+			// Swap the firearm back out for its holster mesh
+			ReleaseWeapon(CurrentWeaponIdx, ReturnToHolster);
+		}
 		// If the weapon is kept attached to the character's body on unequip, attach it
-		if (ReturnToHolster)
+		else if (ReturnToHolster)
 		{
 			// Finds unequip socket from position in inventory
 			auto index = WeaponInventory.Find(CurrentWeapon);
@@ -206,6 +443,12 @@ void UWeaponComponent::UnequipWeapon(bool ReturnToHolster)
 			}
 		}
 		OwningCharacter->SetOverlayState(EOverlayState::Default);
+
+		if (GetOwnerRole() == ROLE_AutonomousProxy)
+		{
+			ServerSetEquippedWeapon(CurrentWeaponIdx, false, ReturnToHolster);
+		}
+		UpdateReplicatedSlot(CurrentWeaponIdx);
 	}
 }
 
@@ -321,10 +564,286 @@ int32 UWeaponComponent::GetCurrentWeaponIndex() const
 	return CurrentWeaponIdx;
 }
 
+void UWeaponComponent::RecordShot(const FTCShotEvent& Shot)
+{
+	// A batch carries one stream seed, so a shot from another stream (e.g. after a weapon swap) starts a new batch
+	if (PendingShots.Shots.Num() > 0 && PendingShots.StreamSeed != Shot.StreamSeed)
+	{
+		FlushShots();
+	}
+
+	const float Now = GetShotTime();
+
+	if (PendingShots.Shots.Num() == 0)
+	{
+		PendingShots.BaseTime = Now;
+		PendingShots.StreamSeed = Shot.StreamSeed;
+	}
+
+	FTCShotEvent& Recorded = PendingShots.Shots.Add_GetRef(Shot);
+	Recorded.TimeOffsetMs = (uint16)FMath::Clamp(FMath::RoundToInt((Now - PendingShots.BaseTime) * 1000.0f), 0, (int32)MAX_uint16);
+
+	if (PendingShots.Shots.Num() >= FTCShotBatch::MaxShots)
+	{
+		FlushShots();
+	}
+}
+
+void UWeaponComponent::FlushShots()
+{
+	if (PendingShots.Shots.Num() == 0)
+	{
+		return;
+	}
+
+	const bool bMulticast = GetOwnerRole() == ROLE_Authority;
+	FTCShotNetCounters::Get().RecordBatch(PendingShots, bMulticast);
+
+	if (bMulticast)
+	{
+		MulticastShotsFired(PendingShots);
+	}
+	else
+	{
+		ServerFireShots(PendingShots);
+	}
+
+	PendingShots.Shots.Reset();
+}
+
+bool UWeaponComponent::ServerFireShots_Validate(const FTCShotBatch& Batch)
+{
+	return Batch.Shots.Num() <= FTCShotBatch::MaxShots;
+}
+
+void UWeaponComponent::ServerFireShots_Implementation(const FTCShotBatch& Batch)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_ValidateShots);
+
+	ABaseFirearm* Weapon = GetShotWeapon();
+	if (!Weapon)
+	{
+		FTCShotNetCounters::Get().ShotsRejected += Batch.Shots.Num();
+		return;
+	}
+
+	const float ServerTime = GetShotTime();
+	const float MaxShotAge = CVarMaxShotAge.GetValueOnGameThread();
+	const float MinShotInterval = Weapon->GetTimeBetweenShots() * (1.0f - CVarFireRateTolerance.GetValueOnGameThread());
+	const float MaxRangeSq = FMath::Square(CVarMaxShotRange.GetValueOnGameThread());
+
+	// The client's seed is ignored. Every shot is rolled from the stream the server picked for the weapon.
+	uint16 ExpectedIndex = Weapon->GetNextShotIndex();
+
+	for (const FTCShotEvent& ClientShot : Batch.Shots)
+	{
+		FTCShotEvent Shot = ClientShot;
+		Shot.StreamSeed = Weapon->GetStreamSeed();
+
+		const float ShotTime = Batch.BaseTime + Shot.TimeOffsetMs / 1000.0f;
+
+		// Step 1: Reject shots out of stream order (replayed, skipped or reordered indices), so a client can't
+		// pick which rolls it gets. In order shots use up their index even if they fail validation below.
+		if (Shot.ShotIndex != ExpectedIndex)
+		{
+			FTCShotNetCounters::Get().ShotsRejected++;
+			continue;
+		}
+
+		++ExpectedIndex;
+
+		// Step 2: Reject shots stamped too far from now, faster than the weapon fires, without ammo or aimed out of range.
+		const bool bValid = FMath::Abs(ServerTime - ShotTime) <= MaxShotAge
+			&& ShotTime >= LastValidatedShotTime + MinShotInterval
+			&& Weapon->RefillClip()
+			&& FVector::DistSquared(Shot.AimPoint, GetOwner()->GetActorLocation()) <= MaxRangeSq;
+
+		if (!bValid)
+		{
+			FTCShotNetCounters::Get().ShotsRejected++;
+			continue;
+		}
+
+		LastValidatedShotTime = ShotTime;
+
+		// Step 3: Fire it for real, then pass it on to the other clients.
+		Weapon->ReplayShot(Shot, ShotTime, true);
+		RecordShot(Shot);
+	}
+
+	// The weapon's stream continues from the next index the client must send
+	Weapon->SetStreamSeed(Weapon->GetStreamSeed(), ExpectedIndex);
+
+	// One inventory update for the whole batch's ammo
+	UpdateReplicatedSlot(CurrentWeaponIdx);
+}
+
+void UWeaponComponent::MulticastShotsFired_Implementation(const FTCShotBatch& Batch)
+{
+	// The server and the shooter have already fired these shots
+	if (GetOwnerRole() == ROLE_Authority || (OwningCharacter && OwningCharacter->IsLocallyControlled()))
+	{
+		return;
+	}
+
+	if (ABaseFirearm* Weapon = GetShotWeapon())
+	{
+		for (const FTCShotEvent& Shot : Batch.Shots)
+		{
+			Weapon->ReplayShot(Shot, Batch.BaseTime + Shot.TimeOffsetMs / 1000.0f, false);
+		}
+	}
+}
+
+ABaseFirearm* UWeaponComponent::GetShotWeapon()
+{
+	// Shots can arrive before the equip that preceded them, so a character that's firing gets its weapon drawn here
+	if (OwningCharacter && !HasWeaponEquipped())
+	{
+		EquipWeapon();
+	}
+
+	return CurrentWeapon;
+}
+
+float UWeaponComponent::GetShotTime() const
+{
+	const UWorld* World = GetWorld();
+	const AGameStateBase* GameState = World->GetGameState();
+
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+void UWeaponComponent::UpdateReplicatedSlot(int32 WeaponIndex)
+{
+	if (GetOwnerRole() != ROLE_Authority || GetNetMode() == NM_Standalone || !StoredInventory.IsValidIndex(WeaponIndex))
+	{
+		return;
+	}
+
+	const ABaseFirearm* Weapon = WeaponInventory[WeaponIndex];
+	const bool bEquipped = WeaponIndex == CurrentWeaponIdx && HasWeaponEquipped();
+
+	FInventoryWeapon State = Weapon ? Weapon->GetStoredWeapon() : StoredInventory[WeaponIndex];
+
+	// Firing and reloading play out from shots. Replicating them would dirty the entry on every trigger pull.
+	State.CurrWeaponState = EWeaponState::Idle;
+
+	if (bEquipped)
+	{
+		State.AttachedSocket = UTCStatics::EMPTY_SOCKET;
+	}
+	else if (Weapon)
+	{
+		State.AttachedSocket = WeaponUnequipSockets.IsValidIndex(WeaponIndex) ? WeaponUnequipSockets[WeaponIndex] : UTCStatics::EMPTY_SOCKET;
+	}
+
+	FTCInventoryEntry* Entry = ReplicatedInventory.FindSlot(WeaponIndex);
+	if (!Entry)
+	{
+		Entry = &ReplicatedInventory.Items.AddDefaulted_GetRef();
+		Entry->Slot = (uint8)WeaponIndex;
+	}
+	else if (Entry->bEquipped == bEquipped && Entry->Weapon == State)
+	{
+		return;
+	}
+
+	Entry->bEquipped = bEquipped;
+	Entry->Weapon = State;
+	ReplicatedInventory.MarkItemDirty(*Entry);
+
+	INC_DWORD_STAT(STAT_TC_InventoryEntriesDirtied);
+}
+
+void UWeaponComponent::OnInventoryEntryReplicated(const FTCInventoryEntry& Entry)
+{
+	// Weapons aren't spawned yet. SpawnWeapons applies the entry once they are.
+	const int32 Slot = Entry.Slot;
+	if (!OwningCharacter || !StoredInventory.IsValidIndex(Slot))
+	{
+		return;
+	}
+
+	// A live firearm keeps its own ammo and fire mode. The stored copy is what it's next spawned from.
+	if (!WeaponInventory[Slot])
+	{
+		StoredInventory[Slot] = Entry.Weapon;
+	}
+
+	// The owner drew or holstered the weapon itself
+	if (OwningCharacter->IsLocallyControlled())
+	{
+		return;
+	}
+
+	const bool bDrawn = Slot == CurrentWeaponIdx && HasWeaponEquipped();
+	if (Entry.bEquipped && !bDrawn)
+	{
+		if (Slot == CurrentWeaponIdx)
+		{
+			EquipWeapon();
+		}
+		else
+		{
+			SwitchWeapon(Slot);
+		}
+	}
+	else if (!Entry.bEquipped && bDrawn)
+	{
+		UnequipWeapon(Entry.Weapon.AttachedSocket != UTCStatics::EMPTY_SOCKET);
+	}
+}
+
+void UWeaponComponent::OnInventoryEntryRemoved(const FTCInventoryEntry& Entry)
+{
+	if (OwningCharacter && !OwningCharacter->IsLocallyControlled() && Entry.Slot == CurrentWeaponIdx && HasWeaponEquipped())
+	{
+		UnequipWeapon(false);
+	}
+}
+
+bool UWeaponComponent::ServerSetEquippedWeapon_Validate(int32 WeaponIndex, bool bEquipped, bool bReturnToHolster)
+{
+	return WeaponIndex >= 0 && WeaponIndex <= MAX_uint8;
+}
+
+void UWeaponComponent::ServerSetEquippedWeapon_Implementation(int32 WeaponIndex, bool bEquipped, bool bReturnToHolster)
+{
+	if (!WeaponInventory.IsValidIndex(WeaponIndex))
+	{
+		return;
+	}
+
+	if (bEquipped)
+	{
+		if (WeaponIndex != CurrentWeaponIdx)
+		{
+			SwitchWeapon(WeaponIndex);
+		}
+		else if (!HasWeaponEquipped())
+		{
+			EquipWeapon();
+		}
+	}
+	else if (WeaponIndex == CurrentWeaponIdx)
+	{
+		UnequipWeapon(bReturnToHolster);
+	}
+}
+
+void UWeaponComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UWeaponComponent, ReplicatedInventory);
+	DOREPLIFETIME_CONDITION(UWeaponComponent, ShotStreamSeeds, COND_OwnerOnly);
+}
+
 // Called every frame
 void UWeaponComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	// ...
+	FlushShots();
 }
\ No newline at end of file
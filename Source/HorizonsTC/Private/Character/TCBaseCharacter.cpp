@@ -4,8 +4,14 @@
 #include "Character/TCBaseCharacter.h"
 
 
+#include "Actors/Level/LedgeAnnotations.h"
 #include "Character/TCPlayerController.h"
 #include "Character/Animation/TCCharacterAnimInstance.h"
+#include "Character/Components/TCCharacterMovementComponent.h"
+#include "Game/TCHitZoneSubsystem.h"
+#include "Game/TCLagCompensationSubsystem.h"
+#include "Game/TCPhysicsQuerySubsystem.h"
+#include "Game/TCRagdollSubsystem.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/TimelineComponent.h"
 #include "Curves/CurveVector.h"
@@ -15,8 +21,20 @@
 
 #include "Kismet/KismetMathLibrary.h"
 #include "Kismet/GameplayStatics.h"
+#include "TCLatency.h"
+#include "TCStats.h"
 
-ATCBaseCharacter::ATCBaseCharacter()
+DECLARE_CYCLE_STAT(TEXT("Character Tick"), STAT_TC_CharacterTick, STATGROUP_HorizonsTC);
+DECLARE_CYCLE_STAT(TEXT("Set Essential Values"), STAT_TC_SetEssentialValues, STATGROUP_HorizonsTC_Character);
+DECLARE_CYCLE_STAT(TEXT("Update Character Movement"), STAT_TC_UpdateCharacterMovement, STATGROUP_HorizonsTC_Character);
+DECLARE_CYCLE_STAT(TEXT("Update Grounded Rotation"), STAT_TC_UpdateGroundedRotation, STATGROUP_HorizonsTC_Character);
+DECLARE_CYCLE_STAT(TEXT("Update In Air Rotation"), STAT_TC_UpdateInAirRotation, STATGROUP_HorizonsTC_Character);
+DECLARE_CYCLE_STAT(TEXT("Falling Mantle Check"), STAT_TC_FallingMantleCheck, STATGROUP_HorizonsTC_Character);
+DECLARE_CYCLE_STAT(TEXT("Mantle Check"), STAT_TC_MantleCheck, STATGROUP_HorizonsTC_Character);
+DECLARE_CYCLE_STAT(TEXT("Ragdoll Update"), STAT_TC_RagdollUpdate, STATGROUP_HorizonsTC_Character);
+
+ATCBaseCharacter::ATCBaseCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UTCCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	PrimaryActorTick.bCanEverTick = true;
 	MantleTimeline = CreateDefaultSubobject<UTimelineComponent>(FName(TEXT("MantleTimeline")));
@@ -124,6 +142,33 @@ void ATCBaseCharacter::BeginPlay()
 
 	// Set jump jet states
 	bJumpJetsEnabled = bHasJumpJets;
+
+	// Bake our physics asset's hit zones now rather than on the first shot that lands
+	if (UTCHitZoneSubsystem* HitZones = GetWorld()->GetSubsystem<UTCHitZoneSubsystem>())
+	{
+		HitZones->RegisterMesh(GetMesh());
+	}
+
+	// Keep a hitbox history for the server to rewind client shots against
+	if (UTCLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UTCLagCompensationSubsystem>())
+	{
+		LagCompensation->RegisterCharacter(this);
+	}
+}
+
+void ATCBaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTCRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UTCRagdollSubsystem>())
+	{
+		RagdollSubsystem->UnregisterRagdoll(this);
+	}
+
+	if (UTCLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<UTCLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ATCBaseCharacter::PreInitializeComponents()
@@ -143,8 +188,15 @@ void ATCBaseCharacter::SetAimYawRate(float NewAimYawRate)
 
 void ATCBaseCharacter::Tick(float DeltaTime)
 {
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_CharacterTick);
+
 	Super::Tick(DeltaTime);
 
+	if (GTCCollectCharacterPerf)
+	{
+		++PerfCounters.NumTicks;
+	}
+
 	// Set required values
 	SetEssentialValues(DeltaTime);
 
@@ -164,7 +216,7 @@ void ATCBaseCharacter::Tick(float DeltaTime)
 		// Perform a mantle check if falling while movement input is pressed.
 		if (bHasMovementInput)
 		{
-			MantleCheck(FallingTraceSettings);
+			UpdateFallingMantleCheck();
 		}
 	}
 	else if (MovementState == EMovementState::Ragdoll)
@@ -190,6 +242,13 @@ void ATCBaseCharacter::RagdollStart()
 	// Step 3: Stop any active montages.
 	MainAnimInstance->Montage_Stop(0.2f);
 
+	// Step 4: Hand the ragdoll to the budget. It keeps simulating for at least tc.Ragdoll.MinSimulateTime.
+	RagdollRestTime = 0.0f;
+	if (UTCRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UTCRagdollSubsystem>())
+	{
+		RagdollSubsystem->RegisterRagdoll(this);
+	}
+
 	//ClearHeldObject();
 }
 
@@ -200,6 +259,18 @@ void ATCBaseCharacter::RagdollEnd()
 		return;
 	}
 
+	// Step 0: Leave the ragdoll budget and make sure the mesh is updating again.
+	if (UTCRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UTCRagdollSubsystem>())
+	{
+		RagdollSubsystem->UnregisterRagdoll(this);
+	}
+	if (bRagdollFrozen)
+	{
+		GetMesh()->bNoSkeletonUpdate = false;
+		GetMesh()->SetComponentTickEnabled(true);
+		bRagdollFrozen = false;
+	}
+
 	// Step 1: Save a snapshot of the current Ragdoll Pose for use in AnimGraph to blend out of the ragdoll
 	MainAnimInstance->SavePoseSnapshot(FName(TEXT("RagdollPose")));
 
@@ -285,6 +356,21 @@ void ATCBaseCharacter::DisablePhysicsSim()
 	GetMesh()->SetAllBodiesSimulatePhysics(false);
 }
 
+void ATCBaseCharacter::AddMontageStateListener(int32 MontageInstanceID, FDelegateHandle Handle)
+{
+	RemoveMontageStateListener(MontageInstanceID);
+	MontageStateListeners.Add(MontageInstanceID, Handle);
+}
+
+void ATCBaseCharacter::RemoveMontageStateListener(int32 MontageInstanceID)
+{
+	FDelegateHandle Handle;
+	if (MontageStateListeners.RemoveAndCopyValue(MontageInstanceID, Handle))
+	{
+		OnCharacterStateChanged.Remove(Handle);
+	}
+}
+
 void ATCBaseCharacter::SetMovementState(const EMovementState NewState)
 {
 	if (MovementState != NewState)
@@ -294,6 +380,7 @@ void ATCBaseCharacter::SetMovementState(const EMovementState NewState)
 		MainAnimInstance->PrevMovementState = PrevMovementState;
 		MainAnimInstance->MovementState = MovementState;
 		OnMovementStateChanged(PrevMovementState);
+		OnCharacterStateChanged.Broadcast(this);
 	}
 }
 
@@ -316,6 +403,7 @@ void ATCBaseCharacter::SetStance(const EStance NewStance)
 		Stance = NewStance;
 		MainAnimInstance->Stance = Stance;
 		OnStanceChanged(Prev);
+		OnCharacterStateChanged.Broadcast(this);
 	}
 }
 
@@ -327,6 +415,7 @@ void ATCBaseCharacter::SetRotationMode(const ERotationMode NewRotationMode)
 		RotationMode = NewRotationMode;
 		MainAnimInstance->RotationMode = RotationMode;
 		OnRotationModeChanged(Prev);
+		OnCharacterStateChanged.Broadcast(this);
 	}
 }
 
@@ -398,11 +487,14 @@ void ATCBaseCharacter::SetActorLocationAndTargetRotation(FVector NewLocation, FR
 
 bool ATCBaseCharacter::MantleCheckGrounded()
 {
+	// Timed here rather than in MantleCheck, which the falling check already times
+	TC_PERF_PHASE(PerfCounters, MantleCheck);
 	return MantleCheck(GroundedTraceSettings);
 }
 
 bool ATCBaseCharacter::MantleCheckFalling()
 {
+	TC_PERF_PHASE(PerfCounters, MantleCheck);
 	return MantleCheck(FallingTraceSettings);
 }
 
@@ -417,13 +509,24 @@ void ATCBaseCharacter::SetMovementModel()
 
 void ATCBaseCharacter::SetHasMovementInput(bool bNewHasMovementInput)
 {
+	if (bHasMovementInput == bNewHasMovementInput)
+	{
+		return;
+	}
+
 	bHasMovementInput = bNewHasMovementInput;
 	MainAnimInstance->bHasMovementInput = bHasMovementInput;
+	OnCharacterStateChanged.Broadcast(this);
 }
 
 FMovementSettings ATCBaseCharacter::GetTargetMovementSettings()
 {
-	if (RotationMode == ERotationMode::VelocityDirection)
+	return GetMovementSettings(RotationMode);
+}
+
+FMovementSettings ATCBaseCharacter::GetMovementSettings(ERotationMode ForRotationMode) const
+{
+	if (ForRotationMode == ERotationMode::VelocityDirection)
 	{
 		if (Stance == EStance::Standing)
 		{
@@ -434,7 +537,7 @@ FMovementSettings ATCBaseCharacter::GetTargetMovementSettings()
 			return MovementData.VelocityDirection.Crouching;
 		}
 	}
-	else if (RotationMode == ERotationMode::LookingDirection)
+	else if (ForRotationMode == ERotationMode::LookingDirection)
 	{
 		if (Stance == EStance::Standing)
 		{
@@ -445,7 +548,7 @@ FMovementSettings ATCBaseCharacter::GetTargetMovementSettings()
 			return MovementData.LookingDirection.Crouching;
 		}
 	}
-	else if (RotationMode == ERotationMode::Aiming)
+	else if (ForRotationMode == ERotationMode::Aiming)
 	{
 		if (Stance == EStance::Standing)
 		{
@@ -461,6 +564,11 @@ FMovementSettings ATCBaseCharacter::GetTargetMovementSettings()
 	return MovementData.VelocityDirection.Standing;
 }
 
+UTCCharacterMovementComponent* ATCBaseCharacter::GetTCCharacterMovement() const
+{
+	return Cast<UTCCharacterMovementComponent>(GetCharacterMovement());
+}
+
 bool ATCBaseCharacter::CanSprint()
 {
 	// Immediately return false if sprint isn't enabled for whatever reason (ex: limited input mode on)
@@ -568,11 +676,67 @@ void ATCBaseCharacter::SetAcceleration(const FVector& NewAcceleration)
 	MainAnimInstance->Acceleration = Acceleration;
 }
 
+void ATCBaseCharacter::FreezeRagdoll()
+{
+	if (bRagdollFrozen || MovementState != EMovementState::Ragdoll)
+	{
+		return;
+	}
+
+	// Keep the pose for the get up blend, then stop both simulation and bone updates so the mesh holds it.
+	if (MainAnimInstance)
+	{
+		MainAnimInstance->SavePoseSnapshot(FName(TEXT("RagdollPose")));
+	}
+
+	GetMesh()->SetAllBodiesSimulatePhysics(false);
+	GetMesh()->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	GetMesh()->bNoSkeletonUpdate = true;
+	GetMesh()->SetComponentTickEnabled(false);
+
+	LastRagdollVelocity = FVector::ZeroVector;
+	bRagdollFrozen = true;
+}
+
+void ATCBaseCharacter::UnfreezeRagdoll()
+{
+	if (!bRagdollFrozen)
+	{
+		return;
+	}
+
+	GetMesh()->bNoSkeletonUpdate = false;
+	GetMesh()->SetComponentTickEnabled(true);
+	GetMesh()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	GetMesh()->SetAllBodiesBelowSimulatePhysics(FName(TEXT("Pelvis")), true, true);
+
+	bRagdollFrozen = false;
+}
+
 void ATCBaseCharacter::RagdollUpdate()
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_RagdollUpdate);
+	TC_PERF_PHASE(PerfCounters, RagdollUpdate);
+
+	// Frozen ragdolls hold still until the budget wakes them, so there is nothing to follow.
+	if (bRagdollFrozen)
+	{
+		return;
+	}
+
 	// Set the Last Ragdoll Velocity.
 	LastRagdollVelocity = GetMesh()->GetPhysicsLinearVelocity(FName(TEXT("Root")));
 
+	// Track how long the ragdoll has been at rest. The budget freezes it once it has settled.
+	if (UTCRagdollSubsystem::IsRagdollAtRest(LastRagdollVelocity))
+	{
+		RagdollRestTime += GetWorld()->GetDeltaSeconds();
+	}
+	else
+	{
+		RagdollRestTime = 0.0f;
+	}
+
 	// Use the Ragdoll Velocity to scale the ragdoll's joint strength for physical animation.
 	const float SpringValue = FMath::GetMappedRangeValueClamped(FVector2D(0.0f, 1000.0f),
 	                                                            FVector2D(0.0f, 25000.0f), LastRagdollVelocity.Size());
@@ -589,6 +753,13 @@ void ATCBaseCharacter::RagdollUpdate()
 
 void ATCBaseCharacter::SetActorLocationDuringRagdoll()
 {
+	// A ragdoll at rest barely moves, so only trace for the ground every few frames.
+	if (RagdollRestTime > 0.0f &&
+		(GFrameCounter + GetUniqueID()) % UTCRagdollSubsystem::GetRestTraceInterval() != 0)
+	{
+		return;
+	}
+
 	// Set the pelvis as the target location.
 	const FVector TargetRagdollLocation = GetMesh()->GetSocketLocation(FName(TEXT("Pelvis")));
 
@@ -608,9 +779,17 @@ void ATCBaseCharacter::SetActorLocationDuringRagdoll()
 	FCollisionQueryParams Params;
 	Params.AddIgnoredActor(this);
 
+	FTCQueryRequest Request(ETCQuerySource::Ragdoll, this, Params);
+	Request.Start = TargetRagdollLocation;
+	Request.End = TraceVect;
+	Request.Channel = ECC_Visibility;
+
+	UTCPhysicsQuerySubsystem* Queries = GetWorld()->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
+
 	FHitResult HitResult;
-	GetWorld()->LineTraceSingleByChannel(HitResult, TargetRagdollLocation, TraceVect,
-	                                     ECC_Visibility, Params);
+	TC_PERF_QUERY(PerfCounters, RagdollQuery);
+	Queries->Query(Request, HitResult);
 
 	bRagdollOnGround = HitResult.IsValidBlockingHit();
 	if (bRagdollOnGround)
@@ -646,6 +825,9 @@ void ATCBaseCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode, uin
 
 void ATCBaseCharacter::OnMovementStateChanged(const EMovementState PreviousState)
 {
+	// Cached mantle results are only meaningful within a single fall
+	ResetMantleQueryCache();
+
 	// Re-enable jump jets on landing
 	if (bHasJumpJets && PreviousState == EMovementState::InAir)
 	{
@@ -793,6 +975,9 @@ void ATCBaseCharacter::OnLandFrictionReset()
 
 void ATCBaseCharacter::SetEssentialValues(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_SetEssentialValues);
+	TC_PERF_PHASE(PerfCounters, SetEssentialValues);
+
 	// These values represent how the capsule is moving as well as how it wants to move, and therefore are essential
 	// for any data driven animation system. They are also used throughout the system for various functions,
 	// so I found it is easiest to manage them all in one place.
@@ -832,8 +1017,12 @@ void ATCBaseCharacter::SetEssentialValues(float DeltaTime)
 
 void ATCBaseCharacter::UpdateCharacterMovement()
 {
-	// Set the Allowed Gait
-	const EGait AllowedGait = GetAllowedGait();
+	SCOPE_CYCLE_COUNTER(STAT_TC_UpdateCharacterMovement);
+	TC_PERF_PHASE(PerfCounters, UpdateCharacterMovement);
+
+	// Set the Allowed Gait. The server's copy of a client's character uses the gait the client's moves carry.
+	const UTCCharacterMovementComponent* TCMovement = GetTCCharacterMovement();
+	const EGait AllowedGait = TCMovement && TCMovement->IsDrivenByRemoteMoves() ? TCMovement->GetPredictedGait() : GetAllowedGait();
 
 	// Determine the Actual Gait. If it is different from the current Gait, Set the new Gait Event.
 	const EGait ActualGait = GetActualGait(AllowedGait);
@@ -844,13 +1033,13 @@ void ATCBaseCharacter::UpdateCharacterMovement()
 	}
 
 	// Use the allowed gait to update the movement settings.
-	UpdateDynamicMovementSettings(AllowedGait);
+	UpdateDynamicMovementSettings(AllowedGait, RotationMode);
 }
 
-void ATCBaseCharacter::UpdateDynamicMovementSettings(EGait AllowedGait)
+void ATCBaseCharacter::UpdateDynamicMovementSettings(EGait AllowedGait, ERotationMode ForRotationMode)
 {
 	// Get the Current Movement Settings.
-	CurrentMovementSettings = GetTargetMovementSettings();
+	CurrentMovementSettings = GetMovementSettings(ForRotationMode);
 
 	// Update the Character Max Walk Speed to the configured speeds based on the currently Allowed Gait.
 	GetCharacterMovement()->MaxWalkSpeed = CurrentMovementSettings.GetSpeedForGait(AllowedGait);
@@ -867,6 +1056,9 @@ void ATCBaseCharacter::UpdateDynamicMovementSettings(EGait AllowedGait)
 
 void ATCBaseCharacter::UpdateGroundedRotation(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_UpdateGroundedRotation);
+	TC_PERF_PHASE(PerfCounters, UpdateGroundedRotation);
+
 	if (MovementAction == EMovementAction::None)
 	{
 		const bool bCanUpdateMovingRot = ((bIsMoving && bHasMovementInput) || Speed > 150.0f) && !HasAnyRootMotion();
@@ -943,6 +1135,9 @@ void ATCBaseCharacter::UpdateGroundedRotation(float DeltaTime)
 
 void ATCBaseCharacter::UpdateInAirRotation(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TC_UpdateInAirRotation);
+	TC_PERF_PHASE(PerfCounters, UpdateInAirRotation);
+
 	if (RotationMode == ERotationMode::VelocityDirection || RotationMode == ERotationMode::LookingDirection)
 	{
 		// Velocity / Looking Direction Rotation
@@ -1041,34 +1236,102 @@ void ATCBaseCharacter::MantleStart(float MantleHeight, const FComponentAndTransf
 	GetCapsuleComponent()->SetWorldRotation(ForcedRotation);
 }
 
-bool ATCBaseCharacter::MantleCheck(const FMantleTraceSettings& TraceSettings, EDrawDebugTrace::Type DebugType)
+FCollisionShape ATCBaseCharacter::GetMantleForwardTrace(const FMantleTraceSettings& TraceSettings,
+                                                        FVector& OutStart, FVector& OutEnd)
 {
-	// Step 1: Trace forward to find a wall / object the character cannot walk on.
 	const FVector& CapsuleBaseLocation = GetCapsuleBaseLocation(2.0f, GetCapsuleComponent());
-	FVector TraceStart = CapsuleBaseLocation + GetPlayerMovementInput() * -30.0f;
-	TraceStart.Z += (TraceSettings.MaxLedgeHeight + TraceSettings.MinLedgeHeight) / 2.0f;
-	const FVector TraceEnd = TraceStart + (GetPlayerMovementInput() * TraceSettings.ReachDistance);
+	const FVector MovementInput = GetPlayerMovementInput();
+	OutStart = CapsuleBaseLocation + MovementInput * -30.0f;
+	OutStart.Z += (TraceSettings.MaxLedgeHeight + TraceSettings.MinLedgeHeight) / 2.0f;
+	OutEnd = OutStart + (MovementInput * TraceSettings.ReachDistance);
 	const float HalfHeight = 1.0f + ((TraceSettings.MaxLedgeHeight - TraceSettings.MinLedgeHeight) / 2.0f);
 
+	return FCollisionShape::MakeCapsule(TraceSettings.ForwardTraceRadius, HalfHeight);
+}
+
+bool ATCBaseCharacter::MantleCheck(const FMantleTraceSettings& TraceSettings, EDrawDebugTrace::Type DebugType)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_MantleCheck);
+
 	UWorld* World = GetWorld();
 	check(World);
 
+	// Step 0: Use the ledges baked for this level if there are any, skipping trace based discovery.
+	// Same reach as the traces: the forward trace starts 30 units behind the capsule base
+	// and the downward trace is inset 15 units past the wall.
+	const float Reach = TraceSettings.ReachDistance - 30.0f + TraceSettings.ForwardTraceRadius + 15.0f;
+	const FVector CapsuleBase = GetCapsuleBaseLocation(2.0f, GetCapsuleComponent());
+
+	bool bBakedDataIsExhaustive = false;
+	if (ALedgeAnnotations::HasLedgeData(World, CapsuleBase, Reach, bBakedDataIsExhaustive))
+	{
+		FMantleLedge Ledge;
+		FVector LedgePoint;
+		if (ALedgeAnnotations::FindLedge(World, CapsuleBase, GetPlayerMovementInput(), Reach,
+		                                 TraceSettings.ForwardTraceRadius, TraceSettings.MinLedgeHeight,
+		                                 TraceSettings.MaxLedgeHeight, Ledge, LedgePoint) &&
+			Ledge.Component.IsValid())
+		{
+			return MantleFromLedge(LedgePoint, Ledge.Normal, Ledge.Component.Get(), DebugType);
+		}
+
+		// Only trusted where an exhaustive bake covers the whole reach
+		if (bBakedDataIsExhaustive)
+		{
+			return false;
+		}
+	}
+
+	// Step 1: Trace forward to find a wall / object the character cannot walk on.
+	// The falling check may already have traced it asynchronously.
+	if (PrefetchedMantleWallHit.IsSet())
+	{
+		const FHitResult WallHit = PrefetchedMantleWallHit.GetValue();
+		PrefetchedMantleWallHit.Reset();
+		return MantleCheckFromWallHit(TraceSettings, WallHit, CapsuleBase, DebugType);
+	}
+
+	FVector TraceStart;
+	FVector TraceEnd;
+	const FCollisionShape TraceShape = GetMantleForwardTrace(TraceSettings, TraceStart, TraceEnd);
+
 	FCollisionQueryParams Params;
 	Params.AddIgnoredActor(this);
 
-	FHitResult HitResult;
+	FTCQueryRequest Request(ETCQuerySource::Mantle, this, Params);
+	Request.Start = TraceStart;
+	Request.End = TraceEnd;
+	Request.Shape = TraceShape;
 	// ECC_GameTraceChannel2 -> Climbable
-	World->SweepSingleByChannel(HitResult, TraceStart, TraceEnd, FQuat::Identity, ECC_GameTraceChannel2,
-	                            FCollisionShape::MakeCapsule(TraceSettings.ForwardTraceRadius, HalfHeight), Params);
+	Request.Channel = ECC_GameTraceChannel2;
+
+	UTCPhysicsQuerySubsystem* Queries = World->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
+
+	FHitResult HitResult;
+	TC_PERF_QUERY(PerfCounters, MantleQuery);
+	Queries->Query(Request, HitResult);
+
+	return MantleCheckFromWallHit(TraceSettings, HitResult, CapsuleBase, DebugType);
+}
 
-	if (!HitResult.IsValidBlockingHit() || GetCharacterMovement()->IsWalkable(HitResult))
+bool ATCBaseCharacter::MantleCheckFromWallHit(const FMantleTraceSettings& TraceSettings, const FHitResult& WallHit,
+                                              const FVector& CapsuleBaseLocation, EDrawDebugTrace::Type DebugType)
+{
+	if (!WallHit.IsValidBlockingHit() || GetCharacterMovement()->IsWalkable(WallHit))
 	{
 		// Not a valid surface to mantle
 		return false;
 	}
 
-	const FVector InitialTraceImpactPoint = HitResult.ImpactPoint;
-	const FVector InitialTraceNormal = HitResult.ImpactNormal;
+	UWorld* World = GetWorld();
+	check(World);
+
+	FCollisionQueryParams Params;
+	Params.AddIgnoredActor(this);
+
+	const FVector InitialTraceImpactPoint = WallHit.ImpactPoint;
+	const FVector InitialTraceNormal = WallHit.ImpactNormal;
 
 	// Step 2: Trace downward from the first trace's Impact Point and determine if the hit location is walkable.
 	FVector DownwardTraceEnd = InitialTraceImpactPoint;
@@ -1077,8 +1340,19 @@ bool ATCBaseCharacter::MantleCheck(const FMantleTraceSettings& TraceSettings, ED
 	FVector DownwardTraceStart = DownwardTraceEnd;
 	DownwardTraceStart.Z += TraceSettings.MaxLedgeHeight + TraceSettings.DownwardTraceRadius + 1.0f;
 
-	World->SweepSingleByChannel(HitResult, DownwardTraceStart, DownwardTraceEnd, FQuat::Identity,
-	                            ECC_GameTraceChannel2, FCollisionShape::MakeSphere(TraceSettings.DownwardTraceRadius), Params);
+	FTCQueryRequest Request(ETCQuerySource::Mantle, this, Params);
+	Request.Slot = 1; // Downward trace, separate from the forward trace in slot 0
+	Request.Start = DownwardTraceStart;
+	Request.End = DownwardTraceEnd;
+	Request.Shape = FCollisionShape::MakeSphere(TraceSettings.DownwardTraceRadius);
+	Request.Channel = ECC_GameTraceChannel2;
+
+	UTCPhysicsQuerySubsystem* Queries = World->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
+
+	FHitResult HitResult;
+	TC_PERF_QUERY(PerfCounters, MantleQuery);
+	Queries->Query(Request, HitResult);
 
 
 	if (!GetCharacterMovement()->IsWalkable(HitResult))
@@ -1090,6 +1364,12 @@ bool ATCBaseCharacter::MantleCheck(const FMantleTraceSettings& TraceSettings, ED
 	const FVector DownTraceLocation(HitResult.Location.X, HitResult.Location.Y, HitResult.ImpactPoint.Z);
 	UPrimitiveComponent* HitComponent = HitResult.GetComponent();
 
+	return MantleFromLedge(DownTraceLocation, InitialTraceNormal, HitComponent, DebugType);
+}
+
+bool ATCBaseCharacter::MantleFromLedge(const FVector& DownTraceLocation, const FVector& InitialTraceNormal,
+                                       UPrimitiveComponent* HitComponent, EDrawDebugTrace::Type DebugType)
+{
 	// Step 3: Check if the capsule has room to stand at the downward trace's location.
 	// If so, set that location as the Target Transform and calculate the mantle height.
 	const FVector& CapsuleLocationFBase = GetCapsuleLocationFromBase(DownTraceLocation, 2.0f, GetCapsuleComponent());
@@ -1129,6 +1409,113 @@ bool ATCBaseCharacter::MantleCheck(const FMantleTraceSettings& TraceSettings, ED
 	return true;
 }
 
+void ATCBaseCharacter::UpdateFallingMantleCheck()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_FallingMantleCheck);
+	TC_PERF_PHASE(PerfCounters, MantleCheck);
+
+	UWorld* World = GetWorld();
+	check(World);
+
+	// Step 1: Finish the check started by an async forward trace on a previous frame.
+	if (PendingMantleTrace.IsValid())
+	{
+		FTraceDatum TraceData;
+		if (World->QueryTraceData(PendingMantleTrace, TraceData))
+		{
+			PendingMantleTrace = FTraceHandle();
+
+			// Finished through the virtual check, so overrides see the async result too
+			PrefetchedMantleWallHit = TraceData.OutHits.Num() > 0 ? TraceData.OutHits[0] : FHitResult();
+			const bool bMantled = MantleCheck(FallingTraceSettings);
+			PrefetchedMantleWallHit.Reset();
+
+			if (bMantled)
+			{
+				ResetMantleQueryCache();
+				return;
+			}
+
+			bHasFailedMantleCheck = true;
+			LastFailedMantleLocation = GetActorLocation();
+			LastFailedMantleInput = (TraceData.End - TraceData.Start).GetSafeNormal();
+		}
+		else if (!World->IsTraceHandleValid(PendingMantleTrace, false))
+		{
+			// The result expired before it could be read
+			PendingMantleTrace = FTraceHandle();
+		}
+		else
+		{
+			return;
+		}
+	}
+
+	// Step 2: Skip the check if the last one failed close by while heading the same way.
+	const FVector MovementInput = GetPlayerMovementInput();
+	const FVector CurrentLocation = GetActorLocation();
+
+	if (bHasFailedMantleCheck &&
+		FVector::DistSquared(CurrentLocation, LastFailedMantleLocation) < FMath::Square(MantleRetestDistance) &&
+		FVector::DotProduct(MovementInput, LastFailedMantleInput) > MantleRetestInputDot)
+	{
+		return;
+	}
+
+	// Step 3: Spread the remaining checks of a crowd over several frames.
+	if (FallingMantleCheckInterval > 1 && (GFrameCounter + GetUniqueID()) % FallingMantleCheckInterval != 0)
+	{
+		return;
+	}
+
+	// Step 4: Either queue the forward trace for next frame or run the whole check now.
+	// Baked ledge queries are cheap enough that there is nothing to gain from deferring them.
+	const float Reach = FallingTraceSettings.ReachDistance - 30.0f + FallingTraceSettings.ForwardTraceRadius + 15.0f;
+	bool bBakedDataIsExhaustive = false;
+	if (bAsyncFallingMantleTrace &&
+		!ALedgeAnnotations::HasLedgeData(World, GetCapsuleBaseLocation(2.0f, GetCapsuleComponent()), Reach, bBakedDataIsExhaustive))
+	{
+		FVector TraceStart;
+		FVector TraceEnd;
+		const FCollisionShape TraceShape = GetMantleForwardTrace(FallingTraceSettings, TraceStart, TraceEnd);
+
+		FCollisionQueryParams Params;
+		Params.AddIgnoredActor(this);
+
+		// Periodic check rather than a player action, so it gives way when the frame's query budget is spent
+		FTCQueryRequest Request(ETCQuerySource::Mantle, this, Params);
+		Request.Priority = ETCQueryPriority::High;
+		Request.Start = TraceStart;
+		Request.End = TraceEnd;
+		Request.Shape = TraceShape;
+		Request.Channel = ECC_GameTraceChannel2;
+
+		UTCPhysicsQuerySubsystem* Queries = World->GetSubsystem<UTCPhysicsQuerySubsystem>();
+		check(Queries);
+
+		TC_PERF_QUERY(PerfCounters, MantleQuery);
+		PendingMantleTrace = Queries->QueryAsync(Request);
+		return;
+	}
+
+	if (MantleCheck(FallingTraceSettings))
+	{
+		ResetMantleQueryCache();
+	}
+	else
+	{
+		bHasFailedMantleCheck = true;
+		LastFailedMantleLocation = CurrentLocation;
+		LastFailedMantleInput = MovementInput;
+	}
+}
+
+void ATCBaseCharacter::ResetMantleQueryCache()
+{
+	bHasFailedMantleCheck = false;
+	PendingMantleTrace = FTraceHandle();
+}
+
 static FTransform MantleComponentLocalToWorld(FComponentAndTransform CompAndTransform)
 {
 	const FTransform& InverseTransform = CompAndTransform.Component->GetComponentToWorld().Inverse();
@@ -1207,15 +1594,24 @@ bool ATCBaseCharacter::CapsuleHasRoomCheck(UCapsuleComponent* Capsule, FVector T
 	TraceEnd.Z -= ZTarget;
 	const float Radius = Capsule->GetUnscaledCapsuleRadius() + RadiusOffset;
 
-	const UWorld* World = GetWorld();
+	UWorld* World = GetWorld();
 	check(World);
+	UTCPhysicsQuerySubsystem* Queries = World->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
 
 	FCollisionQueryParams Params;
 	Params.AddIgnoredActor(this);
 
+	FTCQueryRequest Request(ETCQuerySource::Mantle, this, Params);
+	Request.Slot = 2; // Room check
+	Request.Start = TraceStart;
+	Request.End = TraceEnd;
+	Request.Shape = FCollisionShape::MakeSphere(Radius);
+	Request.ProfileName = FName(TEXT("ALS_Character"));
+
 	FHitResult HitResult;
-	World->SweepSingleByProfile(HitResult, TraceStart, TraceEnd, FQuat::Identity,
-	                            FName(TEXT("ALS_Character")), FCollisionShape::MakeSphere(Radius), Params);
+	TC_PERF_QUERY(PerfCounters, MantleQuery);
+	Queries->Query(Request, HitResult);
 
 	return !(HitResult.bBlockingHit || HitResult.bStartPenetrating);
 }
@@ -1557,7 +1953,25 @@ FVector ATCBaseCharacter::GetPlayerMovementInput()
 	FVector Forward;
 	FVector Right;
 	GetControlForwardRightVector(Forward, Right);
-	return (Forward + Right).GetSafeNormal();
+	const FVector PlayerInput = (Forward + Right).GetSafeNormal();
+
+	if (!bMovementInputFallback || IsPlayerControlled() || !PlayerInput.IsZero())
+	{
+		return PlayerInput;
+	}
+
+	// Benchmark bots have no input axes. Use the movement input it was given this frame or last, or else where it is heading.
+	FVector Input = GetPendingMovementInputVector();
+	if (Input.IsNearlyZero())
+	{
+		Input = GetLastMovementInputVector();
+	}
+	if (Input.IsNearlyZero())
+	{
+		Input = GetVelocity();
+	}
+
+	return FVector(Input.X, Input.Y, 0.0f).GetSafeNormal();
 }
 
 static TPair<float, float> FixDiagonalGamepadValues(const float Y, const float X)
@@ -1595,11 +2009,21 @@ void ATCBaseCharacter::PlayerRightMovementInput(float Value)
 
 void ATCBaseCharacter::PlayerCameraUpInput(float Value)
 {
+	if (Value != 0.0f)
+	{
+		FTCLatencyTracker::Get().MarkLookInput();
+	}
+
 	AddControllerPitchInput(LookUpDownRate * Value);
 }
 
 void ATCBaseCharacter::PlayerCameraRightInput(float Value)
 {
+	if (Value != 0.0f)
+	{
+		FTCLatencyTracker::Get().MarkLookInput();
+	}
+
 	AddControllerYawInput(LookLeftRightRate * Value);
 }
 
@@ -1634,11 +2058,11 @@ void ATCBaseCharacter::JumpPressedAction()
 		{
 			// If we can't mantle, then jump jet
 
-			if (!MantleCheckFalling() && bJumpJetsEnabled && !bJumpJetsOnCooldown)
+			// The launch happens in the next move, so it's predicted and replayed like any other movement
+			UTCCharacterMovementComponent* TCMovement = GetTCCharacterMovement();
+			if (TCMovement && !MantleCheckFalling() && CanJumpJet())
 			{
-				JumpJets();
-
-				bJumpJetsOnCooldown = true;
+				TCMovement->RequestJumpJets();
 			}
 		}
 		else if (MovementState == EMovementState::Ragdoll)
@@ -0,0 +1,151 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Character/TCCameraPipeline.h"
+
+#include "HAL/IConsoleManager.h"
+#include "TCLog.h"
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand CmdCameraBenchmarkPipeline(
+	TEXT("tc.Camera.BenchmarkPipeline"),
+	TEXT("Runs the camera pipeline stages on synthetic inputs the given number of times (default 100000) and logs the\n")
+	TEXT("average cost of the pre-trace stages and the final blend. Needs no world or camera manager."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+
+		// Step 1: Typical third person parameters, with a pivot target that circles so the lag never settles
+		FTCCameraInputs Inputs;
+		Inputs.DeltaTime = 1.0f / 60.0f;
+		Inputs.Params.RotationLagSpeed = 20.0f;
+		Inputs.Params.PivotLagSpeed = FVector(15.0f, 15.0f, 10.0f);
+		Inputs.Params.PivotOffset = FVector(0.0f, 0.0f, 10.0f);
+		Inputs.Params.CameraOffset = FVector(-200.0f, 40.0f, 20.0f);
+		Inputs.Params.Weight_FirstPerson = 0.25f;
+
+		FTCCameraState State;
+		FVector Checksum = FVector::ZeroVector;
+
+		auto UpdateInputs = [&Inputs, &State](int32 i)
+		{
+			const float Angle = i * 0.01f;
+			Inputs.PivotTarget.SetLocation(FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * 500.0f);
+			Inputs.ControlRotation = FRotator(-10.0f, FMath::RadiansToDegrees(Angle), 0.0f);
+			Inputs.CurrentCameraRotation = State.TargetCameraRotation;
+			Inputs.FPTarget = Inputs.PivotTarget.GetLocation() + FVector(0.0f, 0.0f, 60.0f);
+		};
+
+		// Step 2: Time the stages in separate loops, as the collision trace sits between them in the real frame.
+		// The checksum keeps the results live so neither loop can be optimized away.
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < Iterations; ++i)
+		{
+			UpdateInputs(i);
+			FTCCameraPipeline::EvaluatePreTrace(Inputs, State);
+			Checksum += State.TargetCameraLocation;
+		}
+		const uint64 PreTraceCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < Iterations; ++i)
+		{
+			Inputs.Params.Weight_FirstPerson = (i & 255) / 255.0f;
+			FTCCameraPipeline::BlendFinal(Inputs, State);
+			Checksum += State.FinalLocation;
+		}
+		const uint64 BlendCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		UE_LOG(LogHorizonsTC, Log, TEXT("Camera pipeline over %d iterations: pre-trace stages %.1fns, final blend %.1fns (checksum %s)"),
+		       Iterations, FPlatformTime::ToMilliseconds64(PreTraceCycles) * 1000000.0 / Iterations,
+		       FPlatformTime::ToMilliseconds64(BlendCycles) * 1000000.0 / Iterations, *Checksum.ToCompactString());
+	}));
+#endif
+
+void FTCCameraPipeline::UpdateTargetRotation(const FTCCameraInputs& Inputs, FTCCameraState& State)
+{
+	const FRotator InterpResult = FMath::RInterpTo(Inputs.CurrentCameraRotation, Inputs.ControlRotation,
+	                                               Inputs.DeltaTime, Inputs.Params.RotationLagSpeed);
+
+	// Shortest path lerp, matching UKismetMathLibrary::RLerp
+	State.TargetCameraRotation = FRotator(FQuat::Slerp(InterpResult.Quaternion(), Inputs.DebugViewRotation.Quaternion(),
+	                                                   Inputs.Params.Override_Debug));
+}
+
+void FTCCameraPipeline::UpdateSmoothedPivot(const FTCCameraInputs& Inputs, FTCCameraState& State)
+{
+	const FVector AxisIndpLag = CalculateAxisIndependentLag(State.SmoothedPivotTarget.GetLocation(),
+	                                                        Inputs.PivotTarget.GetLocation(), State.TargetCameraRotation,
+	                                                        Inputs.Params.PivotLagSpeed, Inputs.DeltaTime);
+
+	State.SmoothedPivotTarget.SetRotation(Inputs.PivotTarget.GetRotation());
+	State.SmoothedPivotTarget.SetLocation(AxisIndpLag);
+	State.SmoothedPivotTarget.SetScale3D(FVector::OneVector);
+}
+
+void FTCCameraPipeline::UpdatePivotLocation(const FTCCameraInputs& Inputs, FTCCameraState& State)
+{
+	const FRotationMatrix PivotAxes(State.SmoothedPivotTarget.Rotator());
+	const FVector& Offset = Inputs.Params.PivotOffset;
+
+	State.PivotLocation = State.SmoothedPivotTarget.GetLocation() +
+		PivotAxes.GetScaledAxis(EAxis::X) * Offset.X +
+		PivotAxes.GetScaledAxis(EAxis::Y) * Offset.Y +
+		PivotAxes.GetScaledAxis(EAxis::Z) * Offset.Z;
+}
+
+void FTCCameraPipeline::UpdateTargetLocation(const FTCCameraInputs& Inputs, FTCCameraState& State)
+{
+	const FRotationMatrix CameraAxes(State.TargetCameraRotation);
+	const FVector& Offset = Inputs.Params.CameraOffset;
+
+	const FVector OffsetLocation = State.PivotLocation +
+		CameraAxes.GetScaledAxis(EAxis::X) * Offset.X +
+		CameraAxes.GetScaledAxis(EAxis::Y) * Offset.Y +
+		CameraAxes.GetScaledAxis(EAxis::Z) * Offset.Z;
+
+	State.TargetCameraLocation = FMath::Lerp(OffsetLocation, Inputs.PivotTarget.GetLocation() + Inputs.DebugViewOffset,
+	                                         Inputs.Params.Override_Debug);
+}
+
+void FTCCameraPipeline::EvaluatePreTrace(const FTCCameraInputs& Inputs, FTCCameraState& State)
+{
+	UpdateTargetRotation(Inputs, State);
+	UpdateSmoothedPivot(Inputs, State);
+	UpdatePivotLocation(Inputs, State);
+	UpdateTargetLocation(Inputs, State);
+}
+
+void FTCCameraPipeline::BlendFinal(const FTCCameraInputs& Inputs, FTCCameraState& State)
+{
+	const FTransform TargetCameraTransform(State.TargetCameraRotation, State.TargetCameraLocation, FVector::OneVector);
+	const FTransform FPTargetCameraTransform(State.TargetCameraRotation, Inputs.FPTarget, FVector::OneVector);
+	const FTransform DebugTransform(Inputs.DebugViewRotation, State.TargetCameraLocation, FVector::OneVector);
+
+	// Same blend as UKismetMathLibrary::TLerp in quaternion mode
+	FTransform MixedTransform;
+	MixedTransform.Blend(TargetCameraTransform, FPTargetCameraTransform, Inputs.Params.Weight_FirstPerson);
+
+	FTransform TargetTransform;
+	TargetTransform.Blend(MixedTransform, DebugTransform, Inputs.Params.Override_Debug);
+
+	State.FinalLocation = TargetTransform.GetLocation();
+	State.FinalRotation = TargetTransform.Rotator();
+	State.FinalFOV = FMath::Lerp(Inputs.TPFOV, Inputs.FPFOV, Inputs.Params.Weight_FirstPerson);
+}
+
+FVector FTCCameraPipeline::CalculateAxisIndependentLag(const FVector& CurrentLocation, const FVector& TargetLocation,
+                                                       FRotator CameraRotation, const FVector& LagSpeeds, float DeltaTime)
+{
+	CameraRotation.Roll = 0.0f;
+	CameraRotation.Pitch = 0.0f;
+	const FVector UnrotatedCurLoc = CameraRotation.UnrotateVector(CurrentLocation);
+	const FVector UnrotatedTargetLoc = CameraRotation.UnrotateVector(TargetLocation);
+
+	const FVector ResultVector(
+		FMath::FInterpTo(UnrotatedCurLoc.X, UnrotatedTargetLoc.X, DeltaTime, LagSpeeds.X),
+		FMath::FInterpTo(UnrotatedCurLoc.Y, UnrotatedTargetLoc.Y, DeltaTime, LagSpeeds.Y),
+		FMath::FInterpTo(UnrotatedCurLoc.Z, UnrotatedTargetLoc.Z, DeltaTime, LagSpeeds.Z));
+
+	return CameraRotation.RotateVector(ResultVector);
+}
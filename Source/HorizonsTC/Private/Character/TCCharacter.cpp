@@ -6,10 +6,12 @@
 #include "Character/Components/WeaponComponent.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Kismet/GameplayStatics.h"
+#include "TCLatency.h"
 
 FName ATCCharacter::WeaponComponentName(TEXT("WeaponComp"));
 
-ATCCharacter::ATCCharacter()
+ATCCharacter::ATCCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
 {
 	WeaponComponent = CreateOptionalDefaultSubobject<UWeaponComponent>(ATCCharacter::WeaponComponentName);
 }
@@ -65,6 +67,8 @@ void ATCCharacter::OnStartFire()
 {
 	if (WeaponComponent->CanFire())
 	{
+		FTCLatencyTracker::Get().MarkFireInput();
+
 		if (Gait == EGait::Sprinting)
 		{
 			SetDesiredGait(EGait::Running);
@@ -0,0 +1,135 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Character/TCCharacterDebug.h"
+#include "Character/TCBaseCharacter.h"
+#include "Library/TCCharacterEnumLibrary.h"
+
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "TCLog.h"
+
+static FAutoConsoleCommandWithWorldAndArgs CmdCharacterDebugLog(
+	TEXT("tc.Character.DebugLog"),
+	TEXT("Logs the TCLocomotion gameplay debugger report for every TC character, or those whose name contains the argument. ")
+	TEXT("Per-frame costs average the ticks since the previous call. Each call collects timings for the next minute."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World)
+		{
+			return;
+		}
+
+		// Long enough to cover the next call of a typical before/after comparison, without leaving collection on for good
+		FTCCharacterPerfCollection::KeepAlive(60.0f);
+
+		// One report per character, so repeated calls show the cost since the last one
+		static TMap<TWeakObjectPtr<ATCBaseCharacter>, FTCCharacterDebugReport> Reports;
+
+		for (auto It = Reports.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+
+		TArray<FString> Lines;
+		for (TActorIterator<ATCBaseCharacter> It(World); It; ++It)
+		{
+			if (Args.Num() > 0 && !It->GetName().Contains(Args[0]))
+			{
+				continue;
+			}
+
+			Lines.Reset();
+			Reports.FindOrAdd(*It).Describe(**It, Lines);
+
+			for (const FString& Line : Lines)
+			{
+				UE_LOG(LogHorizonsTC, Log, TEXT("%s"), *Line);
+			}
+		}
+	}));
+
+void FTCCharacterDebugReport::Describe(ATCBaseCharacter& Character, TArray<FString>& OutLines)
+{
+	// Step 1: Per-frame costs from the counters gathered since the last report
+	const FTCCharacterPerfCounters& Counters = Character.GetPerfCounters();
+	if (LastCharacter.Get() != &Character || Counters.NumTicks < LastCounters.NumTicks)
+	{
+		// New character, or its counters were reset (e.g. by the benchmark)
+		LastCharacter = &Character;
+		LastCounters.Reset();
+	}
+
+	const double Ticks = FMath::Max<uint32>(Counters.NumTicks - LastCounters.NumTicks, 1);
+	auto PhaseMs = [&](FTCCharacterPerfCounters::EPhase Phase)
+	{
+		return FPlatformTime::ToMilliseconds64(Counters.PhaseCycles[Phase] - LastCounters.PhaseCycles[Phase]) / Ticks;
+	};
+	auto Queries = [&](FTCCharacterPerfCounters::EQuery Query)
+	{
+		return (Counters.Queries[Query] - LastCounters.Queries[Query]) / Ticks;
+	};
+
+	// Step 2: State
+	OutLines.Add(FString::Printf(TEXT("%s (%u ticks)"), *Character.GetName(), Counters.NumTicks - LastCounters.NumTicks));
+	OutLines.Add(FString::Printf(TEXT("  State: %s  Action: %s  Gait: %s  Stance: %s  Rotation: %s  View: %s"),
+		*GetEnumerationToString(Character.GetMovementState()), *GetEnumerationToString(Character.GetMovementAction()),
+		*GetEnumerationToString(Character.GetGait()), *GetEnumerationToString(Character.GetStance()),
+		*GetEnumerationToString(Character.GetRotationMode()), *GetEnumerationToString(Character.GetViewMode())));
+
+	// Step 3: Cost per frame
+	OutLines.Add(FString::Printf(TEXT("  Foot IK: %.3fms %.1f queries  Mantle: %.3fms %.1f queries  Land prediction: %.3fms %.1f queries"),
+		PhaseMs(FTCCharacterPerfCounters::FootIK), Queries(FTCCharacterPerfCounters::FootIKQuery),
+		PhaseMs(FTCCharacterPerfCounters::MantleCheck), Queries(FTCCharacterPerfCounters::MantleQuery),
+		PhaseMs(FTCCharacterPerfCounters::LandPrediction), Queries(FTCCharacterPerfCounters::LandPredictionQuery)));
+	OutLines.Add(FString::Printf(TEXT("  Anim update: %.3fms  Movement: %.3fms  Essential values: %.3fms  Ragdoll: %.3fms"),
+		PhaseMs(FTCCharacterPerfCounters::AnimUpdate), PhaseMs(FTCCharacterPerfCounters::UpdateCharacterMovement),
+		PhaseMs(FTCCharacterPerfCounters::SetEssentialValues), PhaseMs(FTCCharacterPerfCounters::RagdollUpdate)));
+
+	// Step 4: How often the character and its pose tick. Update rate optimizations are the mesh's rate tier.
+	USkeletalMeshComponent* Mesh = Character.GetMesh();
+	check(Mesh);
+
+	FString RateTier = TEXT("off");
+	if (Mesh->bEnableUpdateRateOptimizations && Mesh->AnimUpdateRateParams)
+	{
+		RateTier = FString::Printf(TEXT("update every %d, evaluate every %d"),
+			Mesh->AnimUpdateRateParams->UpdateRate, Mesh->AnimUpdateRateParams->EvaluationRate);
+	}
+
+	OutLines.Add(FString::Printf(TEXT("  Tick interval: actor %.3fs, mesh %.3fs  LOD: %d  Rendered: %s  URO: %s"),
+		Character.GetActorTickInterval(), Mesh->PrimaryComponentTick.TickInterval, Mesh->PredictedLODLevel,
+		Mesh->WasRecentlyRendered() ? TEXT("yes") : TEXT("no"), *RateTier));
+
+	// Step 5: Montages
+	UAnimInstance* AnimInstance = Mesh->GetAnimInstance();
+	int32 NumMontages = 0;
+
+	if (AnimInstance)
+	{
+		for (const FAnimMontageInstance* MontageInstance : AnimInstance->MontageInstances)
+		{
+			if (MontageInstance && MontageInstance->Montage)
+			{
+				OutLines.Add(FString::Printf(TEXT("  Montage: %s  %.2f/%.2fs  weight %.2f%s"), *MontageInstance->Montage->GetName(),
+					MontageInstance->GetPosition(), MontageInstance->Montage->GetPlayLength(), MontageInstance->GetWeight(),
+					MontageInstance->IsPlaying() ? TEXT("") : TEXT("  (paused)")));
+				++NumMontages;
+			}
+		}
+	}
+
+	if (NumMontages == 0)
+	{
+		OutLines.Add(TEXT("  Montage: none"));
+	}
+
+	LastCounters = Counters;
+}
@@ -0,0 +1,130 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Character/TCCharacterPerf.h"
+
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+
+bool GTCCollectCharacterPerf = false;
+
+static bool GTCCharacterPerfCVar = false;
+
+static FAutoConsoleVariableRef CVarCollectCharacterPerf(
+	TEXT("tc.Perf.CharacterCounters"),
+	GTCCharacterPerfCVar,
+	TEXT("Collect per-character locomotion timings and physics query counts (FTCCharacterPerfCounters). ")
+	TEXT("Tools that need them (the locomotion benchmark, the TCLocomotion debugger category) turn them on themselves."),
+	FConsoleVariableDelegate::CreateLambda([](IConsoleVariable*) { FTCCharacterPerfCollection::Update(); }),
+	ECVF_Cheat);
+
+namespace TCCharacterPerf
+{
+	static int32 NumRefs = 0;
+
+	// FPlatformTime::Seconds() the last keep alive runs out at
+	static double KeepAliveEnd = 0.0;
+
+	static FDelegateHandle KeepAliveTicker;
+}
+
+void FTCCharacterPerfCollection::AddRef()
+{
+	++TCCharacterPerf::NumRefs;
+	Update();
+}
+
+void FTCCharacterPerfCollection::Release()
+{
+	check(TCCharacterPerf::NumRefs > 0);
+	--TCCharacterPerf::NumRefs;
+	Update();
+}
+
+void FTCCharacterPerfCollection::KeepAlive(float Seconds)
+{
+	TCCharacterPerf::KeepAliveEnd = FMath::Max(TCCharacterPerf::KeepAliveEnd, FPlatformTime::Seconds() + Seconds);
+
+	// Ticks only while a keep alive is running, to notice it running out
+	if (!TCCharacterPerf::KeepAliveTicker.IsValid())
+	{
+		TCCharacterPerf::KeepAliveTicker = FTicker::GetCoreTicker().AddTicker(
+			FTickerDelegate::CreateStatic(&FTCCharacterPerfCollection::TickKeepAlive));
+	}
+
+	Update();
+}
+
+void FTCCharacterPerfCollection::Update()
+{
+	GTCCollectCharacterPerf = GTCCharacterPerfCVar || TCCharacterPerf::NumRefs > 0
+		|| FPlatformTime::Seconds() < TCCharacterPerf::KeepAliveEnd;
+}
+
+bool FTCCharacterPerfCollection::TickKeepAlive(float DeltaTime)
+{
+	if (FPlatformTime::Seconds() < TCCharacterPerf::KeepAliveEnd)
+	{
+		return true;
+	}
+
+	TCCharacterPerf::KeepAliveTicker.Reset();
+	Update();
+	return false;
+}
+
+void FTCCharacterPerfCounters::Reset()
+{
+	FMemory::Memzero(PhaseCycles);
+	FMemory::Memzero(Queries);
+	NumTicks = 0;
+}
+
+void FTCCharacterPerfCounters::Accumulate(const FTCCharacterPerfCounters& Other)
+{
+	for (int32 i = 0; i < NumPhases; ++i)
+	{
+		PhaseCycles[i] += Other.PhaseCycles[i];
+	}
+	for (int32 i = 0; i < NumQueries; ++i)
+	{
+		Queries[i] += Other.Queries[i];
+	}
+	NumTicks += Other.NumTicks;
+}
+
+double FTCCharacterPerfCounters::GetPhaseMs(EPhase Phase) const
+{
+	return FPlatformTime::ToMilliseconds64(PhaseCycles[Phase]);
+}
+
+const TCHAR* FTCCharacterPerfCounters::GetPhaseName(EPhase Phase)
+{
+	static const TCHAR* Names[NumPhases] =
+	{
+		TEXT("SetEssentialValues"),
+		TEXT("UpdateCharacterMovement"),
+		TEXT("UpdateGroundedRotation"),
+		TEXT("UpdateInAirRotation"),
+		TEXT("MantleCheck"),
+		TEXT("RagdollUpdate"),
+		TEXT("AnimUpdate"),
+		TEXT("FootIK"),
+		TEXT("LandPrediction")
+	};
+	check(Phase >= 0 && Phase < NumPhases);
+	return Names[Phase];
+}
+
+const TCHAR* FTCCharacterPerfCounters::GetQueryName(EQuery Query)
+{
+	static const TCHAR* Names[NumQueries] =
+	{
+		TEXT("MantleQueries"),
+		TEXT("FootIKQueries"),
+		TEXT("LandPredictionQueries"),
+		TEXT("RagdollQueries")
+	};
+	check(Query >= 0 && Query < NumQueries);
+	return Names[Query];
+}
@@ -0,0 +1,332 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Character/TCCheatManager.h"
+#include "Character/TCCharacter.h"
+#include "Character/TCPlayerController.h"
+#include "Character/Components/WeaponComponent.h"
+#include "Actors/Quests/MasterQuest.h"
+#include "Actors/Quests/QuestManager.h"
+#include "Actors/Weapons/BaseFirearm.h"
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/PlatformMemory.h"
+#include "TimerManager.h"
+#include "UObject/UObjectArray.h"
+#include "TCLog.h"
+#include "TCStatics.h"
+
+namespace TCStress
+{
+	// Synthetic quests get IDs far above any authored quest
+	static constexpr int32 FirstSyntheticQuestID = 1000000;
+
+	/** Logs the elapsed time, UObjects created and memory kept by everything run during its lifetime */
+	struct FScopedReport
+	{
+		explicit FScopedReport(const FString& InName)
+			: Name(InName)
+			, StartCycles(FPlatformTime::Cycles64())
+			, StartObjects(GUObjectArray.GetObjectArrayNumMinusAvailable())
+			, StartUsedMemory(FPlatformMemory::GetStats().UsedPhysical)
+		{
+		}
+
+		~FScopedReport()
+		{
+			const double ElapsedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+			const int32 Objects = GUObjectArray.GetObjectArrayNumMinusAvailable() - StartObjects;
+			const double UsedMB = ((double)FPlatformMemory::GetStats().UsedPhysical - (double)StartUsedMemory) / (1024.0 * 1024.0);
+
+			UE_LOG(LogHorizonsTC, Log, TEXT("Stress %s: %.2fms, %+d UObjects, %+.2fMB used"), *Name, ElapsedMs, Objects, UsedMB);
+		}
+
+		FString Name;
+		uint64 StartCycles;
+		int32 StartObjects;
+		uint64 StartUsedMemory;
+	};
+}
+
+void UTCCheatManager::TCStressSpawnBots(int32 Count)
+{
+	APlayerController* PC = GetOuterAPlayerController();
+	APawn* PlayerPawn = PC ? PC->GetPawn() : nullptr;
+	UWorld* World = GetWorld();
+
+	if (!PlayerPawn || !PlayerPawn->IsA<ATCCharacter>() || !World)
+	{
+		UE_LOG(LogHorizonsTC, Warning, TEXT("Stress bots: needs a possessed TC character to copy"));
+		return;
+	}
+
+	TCStress::FScopedReport Report(FString::Printf(TEXT("SpawnBots(%d)"), Count));
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	// Rings of 12 around the player, 3m apart, all facing outwards so they don't shoot each other
+	const FVector Origin = PlayerPawn->GetActorLocation();
+	const int32 FirstBot = StressBots.Num();
+
+	for (int32 i = FirstBot; i < FirstBot + Count; ++i)
+	{
+		const float Radius = 300.0f * (1 + i / 12);
+		const float Yaw = (i % 12) * 30.0f + (i / 12) * 15.0f;
+		const FRotator Rotation(0.0f, Yaw, 0.0f);
+
+		ATCCharacter* Bot = World->SpawnActor<ATCCharacter>(PlayerPawn->GetClass(), Origin + Rotation.Vector() * Radius,
+		                                                    Rotation, SpawnParams);
+		if (!Bot)
+		{
+			continue;
+		}
+
+		if (!Bot->GetController())
+		{
+			Bot->SpawnDefaultController();
+		}
+
+		// Nobody may be looking at them, but their animation and weapons should cost what they would on screen
+		Bot->GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+
+		if (Bot->IsArmed())
+		{
+			Bot->GetWeaponComp()->EquipWeapon(0);
+		}
+
+		StressBots.Add(Bot);
+	}
+
+	UE_LOG(LogHorizonsTC, Log, TEXT("Stress bots: %d alive"), StressBots.Num());
+}
+
+void UTCCheatManager::TCStressClearBots()
+{
+	TCStress::FScopedReport Report(FString::Printf(TEXT("ClearBots(%d)"), StressBots.Num()));
+
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(TimerHandle_StressFire);
+	}
+
+	for (ATCCharacter* Bot : StressBots)
+	{
+		if (IsValid(Bot))
+		{
+			if (AController* Controller = Bot->GetController())
+			{
+				Controller->Destroy();
+			}
+			Bot->Destroy();
+		}
+	}
+
+	StressBots.Empty();
+}
+
+void UTCCheatManager::TCStressFire(bool bEnable)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	TCStress::FScopedReport Report(FString::Printf(TEXT("Fire(%s, %d bots)"), bEnable ? TEXT("on") : TEXT("off"), StressBots.Num()));
+
+	if (bEnable)
+	{
+		UpdateStressFire();
+		World->GetTimerManager().SetTimer(TimerHandle_StressFire, this, &UTCCheatManager::UpdateStressFire, 0.25f, true);
+	}
+	else
+	{
+		World->GetTimerManager().ClearTimer(TimerHandle_StressFire);
+
+		for (ATCCharacter* Bot : StressBots)
+		{
+			if (IsValid(Bot) && Bot->GetWeaponComp()->HasWeaponEquipped())
+			{
+				Bot->GetWeaponComp()->SetFiring(false);
+			}
+		}
+	}
+}
+
+void UTCCheatManager::UpdateStressFire()
+{
+	for (ATCCharacter* Bot : StressBots)
+	{
+		if (!IsValid(Bot) || !Bot->GetWeaponComp()->HasWeaponEquipped())
+		{
+			continue;
+		}
+
+		ABaseFirearm* Weapon = Bot->GetWeaponComp()->GetCurrentWeapon();
+		check(Weapon);
+
+		// Endless ammo, no reload animations
+		Weapon->SetFireMode(EFireModes::Auto);
+		Weapon->SetReserveAmmoCount(Weapon->GetMaxReserveAmmo());
+		Weapon->RefillClip();
+
+		if (Bot->GetWeaponComp()->CanFire())
+		{
+			Bot->GetWeaponComp()->SetFiring(true);
+		}
+	}
+}
+
+void UTCCheatManager::TCStressQuests(int32 Count, int32 Advances)
+{
+	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOuterAPlayerController());
+	AQuestManager* QuestManager = PC ? PC->GetQuestManager() : nullptr;
+
+	if (!QuestManager || !QuestManager->HasAuthority())
+	{
+		UE_LOG(LogHorizonsTC, Warning, TEXT("Stress quests: needs the server's quest manager"));
+		return;
+	}
+
+	// Every synthetic quest is a copy of the first authored one
+	TSubclassOf<AMasterQuest> QuestClass;
+	for (const auto& Elem : QuestManager->AllQuests)
+	{
+		if (Elem.Value)
+		{
+			QuestClass = Elem.Value;
+			break;
+		}
+	}
+
+	if (!QuestClass)
+	{
+		UE_LOG(LogHorizonsTC, Warning, TEXT("Stress quests: the quest manager has no quest classes to copy"));
+		return;
+	}
+
+	TArray<AMasterQuest*> Quests;
+	Quests.Reserve(Count);
+
+	TCStress::FScopedReport TotalReport(FString::Printf(TEXT("Quests(%d, %d advances)"), Count, Advances));
+
+	// Step 1: Begin them all. Follow ups are cleared so completing a copy never starts an authored quest.
+	{
+		TCStress::FScopedReport Report(TEXT("Quests: begin"));
+
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const int32 QuestID = TCStress::FirstSyntheticQuestID + i;
+			QuestManager->AllQuests.Add(QuestID, QuestClass);
+
+			if (QuestManager->BeginQuest(QuestID, false))
+			{
+				AMasterQuest* Quest = QuestManager->ActiveQuests[QuestID];
+				Quest->QuestInfo.FollowUpQuest = UTCStatics::DEFAULT_QUEST_ID;
+				Quest->QuestInfo.FailFollowUpQuest = UTCStatics::DEFAULT_QUEST_ID;
+				Quests.Add(Quest);
+			}
+		}
+	}
+
+	// Step 2: Advance each one objective at a time, until it completes or runs out of advances
+	{
+		TCStress::FScopedReport Report(TEXT("Quests: advance"));
+
+		for (int32 Pass = 0; Pass < Advances; ++Pass)
+		{
+			for (int32 i = 0; i < Count; ++i)
+			{
+				const int32 QuestID = TCStress::FirstSyntheticQuestID + i;
+				if (QuestManager->ActiveQuests.Contains(QuestID))
+				{
+					QuestManager->AdvanceQuest(QuestID, true);
+				}
+			}
+		}
+	}
+
+	// Step 3: Leave no trace of them
+	{
+		TCStress::FScopedReport Report(TEXT("Quests: forget"));
+
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const int32 QuestID = TCStress::FirstSyntheticQuestID + i;
+			QuestManager->ForgetQuest(QuestID);
+			QuestManager->AllQuests.Remove(QuestID);
+		}
+
+		// Completed quests keep their actors, so those are destroyed here
+		for (AMasterQuest* Quest : Quests)
+		{
+			if (IsValid(Quest))
+			{
+				Quest->Destroy();
+			}
+		}
+	}
+}
+
+void UTCCheatManager::TCStressRagdoll()
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	int32 NumStarted = 0;
+	int32 NumEnded = 0;
+
+	TCStress::FScopedReport Report(TEXT("Ragdoll"));
+
+	for (TActorIterator<ATCBaseCharacter> It(World); It; ++It)
+	{
+		if (It->GetMovementState() == EMovementState::Ragdoll)
+		{
+			It->RagdollEnd();
+			++NumEnded;
+		}
+		else
+		{
+			It->RagdollStart();
+			++NumStarted;
+		}
+	}
+
+	UE_LOG(LogHorizonsTC, Log, TEXT("Stress ragdoll: %d started, %d ended"), NumStarted, NumEnded);
+}
+
+void UTCCheatManager::TCStressPauseMenus(int32 Loops)
+{
+	ATCPlayerController* PC = Cast<ATCPlayerController>(GetOuterAPlayerController());
+	if (!PC)
+	{
+		return;
+	}
+
+	// Start from gameplay so every loop builds the pause stack from scratch
+	if (PC->IsPauseStackOpen())
+	{
+		PC->TogglePauseMenu();
+	}
+
+	TCStress::FScopedReport Report(FString::Printf(TEXT("PauseMenus(%d)"), Loops));
+
+	for (int32 i = 0; i < Loops; ++i)
+	{
+		PC->TogglePauseMenu();
+		PC->ToggleQuestMenu();
+		PC->TogglePauseMenu();
+
+		// Back out to gameplay
+		if (PC->IsPauseStackOpen())
+		{
+			PC->TogglePauseMenu();
+		}
+	}
+}
@@ -0,0 +1,43 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Character/TCGameplayDebuggerCategory.h"
+
+#if WITH_GAMEPLAY_DEBUGGER
+
+#include "Character/TCBaseCharacter.h"
+
+FTCGameplayDebuggerCategory::FTCGameplayDebuggerCategory()
+{
+	// Text lines are replicated by the category itself, so a client can inspect the server's characters
+	bShowOnlyWithDebugActor = true;
+}
+
+void FTCGameplayDebuggerCategory::CollectData(APlayerController* OwnerPC, AActor* DebugActor)
+{
+	// Data is only collected while the category is shown. Collection stops shortly after it's closed.
+	FTCCharacterPerfCollection::KeepAlive(FMath::Max(2.0f * CollectDataInterval, 1.0f));
+
+	ATCBaseCharacter* Character = Cast<ATCBaseCharacter>(DebugActor);
+	if (!Character)
+	{
+		AddTextLine(TEXT("{red}Select a TC character"));
+		return;
+	}
+
+	TArray<FString> Lines;
+	Report.Describe(*Character, Lines);
+
+	// First line names the character
+	for (int32 i = 0; i < Lines.Num(); ++i)
+	{
+		AddTextLine(i == 0 ? FString::Printf(TEXT("{yellow}%s"), *Lines[i]) : Lines[i]);
+	}
+}
+
+TSharedRef<FGameplayDebuggerCategory> FTCGameplayDebuggerCategory::MakeInstance()
+{
+	return MakeShareable(new FTCGameplayDebuggerCategory());
+}
+
+#endif // WITH_GAMEPLAY_DEBUGGER
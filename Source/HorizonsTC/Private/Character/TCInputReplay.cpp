@@ -0,0 +1,489 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Character/TCInputReplay.h"
+#include "Character/TCPlayerController.h"
+#include "Actors/Weapons/BaseFirearm.h"
+
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "TCLog.h"
+#include "TCStats.h"
+
+static TAutoConsoleVariable<int32> CVarInputReplayCsv(
+	TEXT("tc.Input.ReplayCsv"),
+	1,
+	TEXT("Capture a CSV profile (Saved/Profiling/CSV) for the length of every input replay."),
+	ECVF_Default);
+
+static ATCPlayerController* GetReplayController(UWorld* World)
+{
+	return World ? Cast<ATCPlayerController>(World->GetFirstPlayerController()) : nullptr;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdInputRecord(
+	TEXT("tc.Input.Record"),
+	TEXT("Records the local player's input to Saved/Profiling/TCInput/<Name>.tcinput until tc.Input.StopRecord."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (ATCPlayerController* PC = GetReplayController(World))
+		{
+			PC->StartInputRecording(Args.Num() > 0 ? Args[0] : FString());
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld CmdInputStopRecord(
+	TEXT("tc.Input.StopRecord"),
+	TEXT("Stops recording input and writes the trace."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (ATCPlayerController* PC = GetReplayController(World))
+		{
+			PC->StopInputRecording();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdInputReplay(
+	TEXT("tc.Input.Replay"),
+	TEXT("Plays back an input trace recorded with tc.Input.Record at its recorded timestep. Argument: trace name."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		ATCPlayerController* PC = GetReplayController(World);
+		if (PC && Args.Num() > 0)
+		{
+			PC->StartInputReplay(Args[0]);
+		}
+	}));
+
+namespace TCInputReplay
+{
+	static constexpr uint32 Magic = 0x52494354; // "TCIR"
+	static constexpr uint32 Version = 1;
+
+	// Per event flags. Key events keep their EInputEvent in the bits above these.
+	static constexpr uint8 Flag_Axis = 1 << 0;
+	static constexpr uint8 Flag_Gamepad = 1 << 1;
+	static constexpr uint8 EventShift = 2;
+}
+
+FTCInputReplay::FTCInputReplay(APlayerController* InController)
+	: Controller(InController)
+{
+}
+
+FTCInputReplay::~FTCInputReplay()
+{
+	if (Mode == EMode::Playing)
+	{
+		StopPlayback();
+	}
+	else if (Mode == EMode::Recording)
+	{
+		StopRecording();
+	}
+}
+
+FString FTCInputReplay::GetTracePath(const FString& Name)
+{
+	return FPaths::Combine(FPaths::ProfilingDir(), TEXT("TCInput"), Name + TEXT(".tcinput"));
+}
+
+bool FTCInputReplay::StartRecording(const FString& Name)
+{
+	if (Mode != EMode::None)
+	{
+		UE_LOG(LogHorizonsTC, Warning, TEXT("Input replay: already %s"), Mode == EMode::Recording ? TEXT("recording") : TEXT("playing"));
+		return false;
+	}
+
+	TraceName = Name.IsEmpty() ? FString::Printf(TEXT("Input-%s"), *FDateTime::Now().ToString()) : Name;
+	Frames.Reset();
+	Events.Reset();
+	PendingEvents.Reset();
+
+	// Keep the session's fixed seed if it has one, otherwise pick one so the trace can reproduce this run's shots
+	IConsoleVariable* SeedVar = IConsoleManager::Get().FindConsoleVariable(TEXT("tc.Weapons.RandomSeed"));
+	int32 Seed = SeedVar ? SeedVar->GetInt() : 0;
+	while (Seed == 0)
+	{
+		Seed = FMath::Rand();
+	}
+	if (!ApplyRandomSeed(Seed))
+	{
+		return false;
+	}
+
+	Mode = EMode::Recording;
+
+	UE_LOG(LogHorizonsTC, Log, TEXT("Input replay: recording %s (seed %d)"), *TraceName, RandomSeed);
+	return true;
+}
+
+bool FTCInputReplay::StopRecording()
+{
+	if (Mode != EMode::Recording)
+	{
+		return false;
+	}
+
+	Mode = EMode::None;
+	RestoreRandomSeed();
+
+	const FString Path = GetTracePath(TraceName);
+	const bool bSaved = Save(Path);
+
+	if (bSaved)
+	{
+		UE_LOG(LogHorizonsTC, Log, TEXT("Input replay: wrote %s (%d frames, %d events)"), *Path, Frames.Num(), Events.Num());
+	}
+	else
+	{
+		UE_LOG(LogHorizonsTC, Error, TEXT("Input replay: failed to write %s"), *Path);
+	}
+
+	Frames.Empty();
+	Events.Empty();
+	return bSaved;
+}
+
+bool FTCInputReplay::StartPlayback(const FString& Name, bool bInQuitWhenFinished)
+{
+	if (Mode != EMode::None)
+	{
+		UE_LOG(LogHorizonsTC, Warning, TEXT("Input replay: already %s"), Mode == EMode::Recording ? TEXT("recording") : TEXT("playing"));
+		return false;
+	}
+
+	const FString Path = GetTracePath(Name);
+	if (!Load(Path) || Frames.Num() == 0)
+	{
+		UE_LOG(LogHorizonsTC, Error, TEXT("Input replay: couldn't load %s"), *Path);
+		return false;
+	}
+
+	// Without the recorded seed the shots would differ from the recording's
+	if (!ApplyRandomSeed(RandomSeed))
+	{
+		return false;
+	}
+
+	TraceName = Name;
+	PlaybackFrame = 0;
+	bQuitWhenFinished = bInQuitWhenFinished;
+
+	// Step the engine by the recorded deltas instead of wall clock time, however fast this machine runs
+	bPreviousFixedTimestep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(Frames[0].DeltaSeconds);
+
+#if CSV_PROFILER
+	bStartedCsvCapture = false;
+	if (CVarInputReplayCsv.GetValueOnGameThread() != 0 && !FCsvProfiler::Get()->IsCapturing())
+	{
+		FCsvProfiler::Get()->BeginCapture(-1, FString(), FString::Printf(TEXT("Replay-%s.csv"), *TraceName));
+		bStartedCsvCapture = true;
+	}
+#endif
+
+	Mode = EMode::Playing;
+	PlaybackStartCycles = FPlatformTime::Cycles64();
+
+	UE_LOG(LogHorizonsTC, Log, TEXT("Input replay: playing %s (%d frames, %d events, seed %d)"), *TraceName, Frames.Num(),
+	       Events.Num(), RandomSeed);
+	return true;
+}
+
+void FTCInputReplay::StopPlayback()
+{
+	if (Mode != EMode::Playing)
+	{
+		return;
+	}
+
+	Mode = EMode::None;
+
+	const double ElapsedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - PlaybackStartCycles);
+	UE_LOG(LogHorizonsTC, Log, TEXT("Input replay: %s played %d/%d frames in %.1fms (%.3fms per frame)"), *TraceName,
+	       PlaybackFrame, Frames.Num(), ElapsedMs, ElapsedMs / FMath::Max(PlaybackFrame, 1));
+
+#if CSV_PROFILER
+	if (bStartedCsvCapture)
+	{
+		FCsvProfiler::Get()->EndCapture();
+		bStartedCsvCapture = false;
+	}
+#endif
+
+	RestoreTimestep();
+	RestoreRandomSeed();
+
+	Frames.Empty();
+	Events.Empty();
+
+	if (bQuitWhenFinished)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void FTCInputReplay::RecordEvent(const FTCInputEvent& Event)
+{
+	if (Mode == EMode::Recording)
+	{
+		PendingEvents.Add(Event);
+	}
+}
+
+void FTCInputReplay::Tick(float DeltaSeconds, TFunctionRef<void(const FTCInputEvent&)> Inject)
+{
+	if (Mode == EMode::Recording)
+	{
+		// Everything the viewport delivered since the last tick is processed by this frame
+		FFrame& Frame = Frames.AddDefaulted_GetRef();
+		Frame.DeltaSeconds = DeltaSeconds;
+		Frame.FirstEvent = Events.Num();
+		Frame.NumEvents = PendingEvents.Num();
+
+		Events.Append(PendingEvents);
+		PendingEvents.Reset();
+	}
+	else if (Mode == EMode::Playing)
+	{
+		if (!Frames.IsValidIndex(PlaybackFrame))
+		{
+			StopPlayback();
+			return;
+		}
+
+		const FFrame& Frame = Frames[PlaybackFrame];
+		for (int32 i = Frame.FirstEvent; i < Frame.FirstEvent + Frame.NumEvents; ++i)
+		{
+			Inject(Events[i]);
+		}
+
+		++PlaybackFrame;
+
+		// The engine picks up the fixed delta when the next frame starts
+		if (Frames.IsValidIndex(PlaybackFrame))
+		{
+			FApp::SetFixedDeltaTime(Frames[PlaybackFrame].DeltaSeconds);
+		}
+	}
+}
+
+bool FTCInputReplay::ApplyRandomSeed(int32 Seed)
+{
+	RandomSeed = Seed;
+
+	IConsoleVariable* SeedVar = IConsoleManager::Get().FindConsoleVariable(TEXT("tc.Weapons.RandomSeed"));
+	if (!SeedVar)
+	{
+		UE_LOG(LogHorizonsTC, Error, TEXT("Input replay: tc.Weapons.RandomSeed doesn't exist, shots can't be reproduced"));
+		return false;
+	}
+
+	// Set with console priority: a lower priority write is ignored if the seed was set from the console
+	PreviousRandomSeed = SeedVar->GetInt();
+	SeedVar->Set(Seed, ECVF_SetByConsole);
+
+	if (SeedVar->GetInt() != Seed)
+	{
+		UE_LOG(LogHorizonsTC, Error, TEXT("Input replay: couldn't set tc.Weapons.RandomSeed to %d (it's %d), shots can't be reproduced"),
+		       Seed, SeedVar->GetInt());
+		return false;
+	}
+
+	// Weapons spawned later read the seed themselves
+	UWorld* World = Controller.IsValid() ? Controller->GetWorld() : nullptr;
+	if (World)
+	{
+		for (TActorIterator<ABaseFirearm> It(World); It; ++It)
+		{
+			It->ResetStreamSeed();
+		}
+	}
+
+	return true;
+}
+
+void FTCInputReplay::RestoreRandomSeed()
+{
+	if (IConsoleVariable* SeedVar = IConsoleManager::Get().FindConsoleVariable(TEXT("tc.Weapons.RandomSeed")))
+	{
+		SeedVar->Set(PreviousRandomSeed, ECVF_SetByConsole);
+	}
+}
+
+void FTCInputReplay::RestoreTimestep()
+{
+	FApp::SetUseFixedTimeStep(bPreviousFixedTimestep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+}
+
+bool FTCInputReplay::Save(const FString& Path) const
+{
+	TArray<uint8> Data;
+	FMemoryWriter Ar(Data);
+
+	// Step 1: Header
+	uint32 Magic = TCInputReplay::Magic;
+	uint32 Version = TCInputReplay::Version;
+	int32 Seed = RandomSeed;
+	Ar << Magic << Version << Seed;
+
+	// Step 2: Key names, once each. Events refer to them by index.
+	TArray<FName> KeyNames;
+	TMap<FName, uint16> KeyIndices;
+	for (const FTCInputEvent& Event : Events)
+	{
+		const FName KeyName = Event.Key.GetFName();
+		if (!KeyIndices.Contains(KeyName))
+		{
+			KeyIndices.Add(KeyName, (uint16)KeyNames.Add(KeyName));
+		}
+	}
+
+	int32 NumKeys = KeyNames.Num();
+	Ar << NumKeys;
+	for (FName& KeyName : KeyNames)
+	{
+		FString KeyString = KeyName.ToString();
+		Ar << KeyString;
+	}
+
+	// Step 3: Frames, each with its delta time and events
+	int32 NumFrames = Frames.Num();
+	Ar << NumFrames;
+
+	for (const FFrame& Frame : Frames)
+	{
+		float DeltaSeconds = Frame.DeltaSeconds;
+		uint32 NumEvents = (uint32)Frame.NumEvents;
+		Ar << DeltaSeconds;
+		Ar.SerializeIntPacked(NumEvents);
+
+		for (int32 i = Frame.FirstEvent; i < Frame.FirstEvent + Frame.NumEvents; ++i)
+		{
+			const FTCInputEvent& Event = Events[i];
+
+			uint8 Flags = (Event.bAxis ? TCInputReplay::Flag_Axis : 0) | (Event.bGamepad ? TCInputReplay::Flag_Gamepad : 0);
+			if (!Event.bAxis)
+			{
+				Flags |= (uint8)Event.Event.GetValue() << TCInputReplay::EventShift;
+			}
+
+			uint16 KeyIndex = KeyIndices.FindChecked(Event.Key.GetFName());
+			float Value = Event.Value;
+			Ar << Flags << KeyIndex << Value;
+
+			if (Event.bAxis)
+			{
+				uint8 NumSamples = Event.NumSamples;
+				Ar << NumSamples;
+			}
+		}
+	}
+
+	return FFileHelper::SaveArrayToFile(Data, *Path);
+}
+
+bool FTCInputReplay::Load(const FString& Path)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Path, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Ar(Data);
+	Frames.Reset();
+	Events.Reset();
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Ar << Magic << Version << RandomSeed;
+
+	if (Magic != TCInputReplay::Magic || Version != TCInputReplay::Version)
+	{
+		UE_LOG(LogHorizonsTC, Error, TEXT("Input replay: %s is not a version %u input trace"), *Path, TCInputReplay::Version);
+		return false;
+	}
+
+	int32 NumKeys = 0;
+	Ar << NumKeys;
+	if (Ar.IsError() || NumKeys < 0 || NumKeys > MAX_uint16)
+	{
+		return false;
+	}
+
+	TArray<FKey> Keys;
+	Keys.Reserve(NumKeys);
+	for (int32 i = 0; i < NumKeys; ++i)
+	{
+		FString KeyString;
+		Ar << KeyString;
+		Keys.Add(FKey(*KeyString));
+	}
+
+	int32 NumFrames = 0;
+	Ar << NumFrames;
+	if (Ar.IsError() || NumFrames < 0)
+	{
+		return false;
+	}
+
+	Frames.Reserve(NumFrames);
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames && !Ar.IsError(); ++FrameIndex)
+	{
+		FFrame& Frame = Frames.AddDefaulted_GetRef();
+		uint32 NumEvents = 0;
+		Ar << Frame.DeltaSeconds;
+		Ar.SerializeIntPacked(NumEvents);
+
+		Frame.FirstEvent = Events.Num();
+		Frame.NumEvents = (int32)NumEvents;
+
+		for (uint32 i = 0; i < NumEvents && !Ar.IsError(); ++i)
+		{
+			uint8 Flags = 0;
+			uint16 KeyIndex = 0;
+			FTCInputEvent& Event = Events.AddDefaulted_GetRef();
+			Ar << Flags << KeyIndex << Event.Value;
+
+			if (!Keys.IsValidIndex(KeyIndex))
+			{
+				Ar.SetError();
+				break;
+			}
+
+			Event.Key = Keys[KeyIndex];
+			Event.bAxis = (Flags & TCInputReplay::Flag_Axis) != 0;
+			Event.bGamepad = (Flags & TCInputReplay::Flag_Gamepad) != 0;
+
+			if (Event.bAxis)
+			{
+				Ar << Event.NumSamples;
+			}
+			else
+			{
+				Event.Event = (EInputEvent)(Flags >> TCInputReplay::EventShift);
+			}
+		}
+	}
+
+	if (Ar.IsError())
+	{
+		Frames.Reset();
+		Events.Reset();
+		return false;
+	}
+
+	return true;
+}
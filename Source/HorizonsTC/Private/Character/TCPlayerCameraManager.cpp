@@ -5,7 +5,29 @@
 
 #include "Character/TCBaseCharacter.h"
 #include "Character/Animation/TCPlayerCameraBehavior.h"
-#include "Kismet/KismetMathLibrary.h"
+#include "Game/TCPhysicsQuerySubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TCLatency.h"
+#include "TCLog.h"
+#include "TCStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Camera Behavior"), STAT_TC_CameraBehavior, STATGROUP_HorizonsTC);
+DECLARE_CYCLE_STAT(TEXT("Camera Gather Inputs"), STAT_TC_CameraGatherInputs, STATGROUP_HorizonsTC_Camera);
+DECLARE_CYCLE_STAT(TEXT("Camera Pipeline Stages"), STAT_TC_CameraStages, STATGROUP_HorizonsTC_Camera);
+DECLARE_CYCLE_STAT(TEXT("Camera Collision"), STAT_TC_CameraCollision, STATGROUP_HorizonsTC_Camera);
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarCameraAsyncTraceCompare(
+	TEXT("tc.Camera.AsyncTraceCompare"),
+	0,
+	TEXT("When non-zero, also runs the blocking camera sweep while async tracing is enabled and periodically logs\n")
+	TEXT("how far the async camera deviates from it, along with the frame-to-frame jitter of both."),
+	ECVF_Cheat);
+
+// Number of frames accumulated before the comparison is logged and reset
+static const int32 CameraJitterReportInterval = 300;
+#endif
 
 ATCPlayerCameraManager::ATCPlayerCameraManager()
 {
@@ -65,71 +87,65 @@ void ATCPlayerCameraManager::UpdateViewTargetInternal(FTViewTarget& OutVT, float
 FVector ATCPlayerCameraManager::CalculateAxisIndependentLag(FVector CurrentLocation, FVector TargetLocation,
                                                             FRotator CameraRotation, FVector LagSpeeds, float DeltaTime)
 {
-	CameraRotation.Roll = 0.0f;
-	CameraRotation.Pitch = 0.0f;
-	const FVector UnrotatedCurLoc = CameraRotation.UnrotateVector(CurrentLocation);
-	const FVector UnrotatedTargetLoc = CameraRotation.UnrotateVector(TargetLocation);
+	return FTCCameraPipeline::CalculateAxisIndependentLag(CurrentLocation, TargetLocation, CameraRotation, LagSpeeds, DeltaTime);
+}
+
+void ATCPlayerCameraManager::GatherCameraInputs(float DeltaTime, FTCCameraInputs& OutInputs)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_CameraGatherInputs);
 
-	const FVector ResultVector(
-		FMath::FInterpTo(UnrotatedCurLoc.X, UnrotatedTargetLoc.X, DeltaTime, LagSpeeds.X),
-		FMath::FInterpTo(UnrotatedCurLoc.Y, UnrotatedTargetLoc.Y, DeltaTime, LagSpeeds.Y),
-		FMath::FInterpTo(UnrotatedCurLoc.Z, UnrotatedTargetLoc.Z, DeltaTime, LagSpeeds.Z));
+	OutInputs.DeltaTime = DeltaTime;
+	OutInputs.CurrentCameraRotation = GetCameraRotation();
+	OutInputs.ControlRotation = GetOwningPlayerController()->GetControlRotation();
+	OutInputs.PivotTarget = ControlledCharacter->GetThirdPersonPivotTarget();
+	OutInputs.FPTarget = ControlledCharacter->GetFirstPersonCameraTarget();
+	OutInputs.DebugViewRotation = DebugViewRotation;
+	OutInputs.DebugViewOffset = DebugViewOffset;
 
-	return CameraRotation.RotateVector(ResultVector);
+	bool bRightShoulder = false;
+	ControlledCharacter->GetCameraParameters(OutInputs.TPFOV, OutInputs.FPFOV, bRightShoulder);
+
+	// Each curve is read exactly once per frame
+	FTCCameraParams& Params = OutInputs.Params;
+	Params.RotationLagSpeed = GetCameraBehaviorParam(FName(TEXT("RotationLagSpeed")));
+	Params.PivotLagSpeed = FVector(GetCameraBehaviorParam(FName(TEXT("PivotLagSpeed_X"))),
+	                               GetCameraBehaviorParam(FName(TEXT("PivotLagSpeed_Y"))),
+	                               GetCameraBehaviorParam(FName(TEXT("PivotLagSpeed_Z"))));
+	Params.PivotOffset = FVector(GetCameraBehaviorParam(FName(TEXT("PivotOffset_X"))),
+	                             GetCameraBehaviorParam(FName(TEXT("PivotOffset_Y"))),
+	                             GetCameraBehaviorParam(FName(TEXT("PivotOffset_Z"))));
+	Params.CameraOffset = FVector(GetCameraBehaviorParam(FName(TEXT("CameraOffset_X"))),
+	                              GetCameraBehaviorParam(FName(TEXT("CameraOffset_Y"))),
+	                              GetCameraBehaviorParam(FName(TEXT("CameraOffset_Z"))));
+	Params.Override_Debug = GetCameraBehaviorParam(FName(TEXT("Override_Debug")));
+	Params.Weight_FirstPerson = GetCameraBehaviorParam(FName(TEXT("Weight_FirstPerson")));
 }
 
 bool ATCPlayerCameraManager::CustomCameraBehavior(float DeltaTime, FVector& Location, FRotator& Rotation, float& FOV)
 {
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_CameraBehavior);
+
 	if (!ControlledCharacter)
 	{
 		return false;
 	}
-	
+
 	// Step 1: Get Camera Parameters from CharacterBP via the Camera Interface
-	const FTransform& PivotTarget = ControlledCharacter->GetThirdPersonPivotTarget();
-	const FVector& FPTarget = ControlledCharacter->GetFirstPersonCameraTarget();
-	float TPFOV = 90.0f;
-	float FPFOV = 90.0f;
-	bool bRightShoulder = false;
-	ControlledCharacter->GetCameraParameters(TPFOV, FPFOV, bRightShoulder);
-
-	// Step 2: Calculate Target Camera Rotation. Use the Control Rotation and interpolate for smooth camera rotation.
-	const FRotator& InterpResult = FMath::RInterpTo(GetCameraRotation(),
-	                                                GetOwningPlayerController()->GetControlRotation(), DeltaTime,
-	                                                GetCameraBehaviorParam(FName(TEXT("RotationLagSpeed"))));
-
-	TargetCameraRotation = UKismetMathLibrary::RLerp(InterpResult, DebugViewRotation,
-	                                                 GetCameraBehaviorParam(TEXT("Override_Debug")), true);
-
-	// Step 3: Calculate the Smoothed Pivot Target (Orange Sphere).
-	// Get the 3P Pivot Target (Green Sphere) and interpolate using axis independent lag for maximum control.
-	const FVector LagSpd(GetCameraBehaviorParam(FName(TEXT("PivotLagSpeed_X"))),
-	                     GetCameraBehaviorParam(FName(TEXT("PivotLagSpeed_Y"))),
-	                     GetCameraBehaviorParam(FName(TEXT("PivotLagSpeed_Z"))));
-
-	const FVector& AxisIndpLag = CalculateAxisIndependentLag(SmoothedPivotTarget.GetLocation(),
-	                                                         PivotTarget.GetLocation(), TargetCameraRotation, LagSpd, DeltaTime);
-
-	SmoothedPivotTarget.SetRotation(PivotTarget.GetRotation());
-	SmoothedPivotTarget.SetLocation(AxisIndpLag);
-	SmoothedPivotTarget.SetScale3D(FVector::OneVector);
-
-	// Step 4: Calculate Pivot Location (BlueSphere). Get the Smoothed
-	// Pivot Target and apply local offsets for further camera control.
-	PivotLocation =
-		SmoothedPivotTarget.GetLocation() +
-		UKismetMathLibrary::GetForwardVector(SmoothedPivotTarget.Rotator()) * GetCameraBehaviorParam(FName(TEXT("PivotOffset_X"))) +
-		UKismetMathLibrary::GetRightVector(SmoothedPivotTarget.Rotator()) * GetCameraBehaviorParam(FName(TEXT("PivotOffset_Y"))) +
-		UKismetMathLibrary::GetUpVector(SmoothedPivotTarget.Rotator()) * GetCameraBehaviorParam(FName(TEXT("PivotOffset_Z")));
-
-	// Step 5: Calculate Target Camera Location. Get the Pivot location and apply camera relative offsets.
-	TargetCameraLocation = UKismetMathLibrary::VLerp(
-		PivotLocation +
-		UKismetMathLibrary::GetForwardVector(TargetCameraRotation) * GetCameraBehaviorParam(FName(TEXT("CameraOffset_X"))) +
-		UKismetMathLibrary::GetRightVector(TargetCameraRotation) * GetCameraBehaviorParam(FName(TEXT("CameraOffset_Y"))) +
-		UKismetMathLibrary::GetUpVector(TargetCameraRotation) * GetCameraBehaviorParam(FName(TEXT("CameraOffset_Z"))),
-		PivotTarget.GetLocation() + DebugViewOffset,
-		GetCameraBehaviorParam(FName(TEXT("Override_Debug"))));
+	FTCCameraInputs Inputs;
+	GatherCameraInputs(DeltaTime, Inputs);
+
+	// The mirrored properties are the state carried between frames, so anything that moved them (a subclass,
+	// a snap on possess) is respected by the stages below
+	CameraState.TargetCameraRotation = TargetCameraRotation;
+	CameraState.SmoothedPivotTarget = SmoothedPivotTarget;
+	CameraState.PivotLocation = PivotLocation;
+	CameraState.TargetCameraLocation = TargetCameraLocation;
+
+	// Steps 2-5: Target rotation, smoothed pivot, pivot location and target camera location
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TC_CameraStages);
+		FTCCameraPipeline::EvaluatePreTrace(Inputs, CameraState);
+	}
 
 	// Step 6: Trace for an object between the camera and character to apply a corrective offset.
 	// Trace origins are set within the Character BP via the Camera Interface.
@@ -138,38 +154,188 @@ bool ATCPlayerCameraManager::CustomCameraBehavior(float DeltaTime, FVector& Loca
 	float TraceRadius = 0.0f;
 	ECollisionChannel TraceChannel = ControlledCharacter->GetThirdPersonTraceParams(TraceOrigin, TraceRadius);
 
+	CameraState.TargetCameraLocation = ResolveCameraCollision(TraceOrigin, CameraState.TargetCameraLocation,
+	                                                          TraceRadius, TraceChannel, DeltaTime);
+
+	TargetCameraRotation = CameraState.TargetCameraRotation;
+	SmoothedPivotTarget = CameraState.SmoothedPivotTarget;
+	PivotLocation = CameraState.PivotLocation;
+	TargetCameraLocation = CameraState.TargetCameraLocation;
+
+	// Step 7: Draw Debug Shapes.
+	DrawDebugTargets(Inputs.PivotTarget.GetLocation());
+
+	// Step 8: Lerp First Person Override and return target camera parameters.
+	FTCCameraPipeline::BlendFinal(Inputs, CameraState);
+
+	Location = CameraState.FinalLocation;
+	Rotation = CameraState.FinalRotation;
+	FOV = CameraState.FinalFOV;
+
+	FTCLatencyTracker::Get().MarkViewUpdated();
+
+	return true;
+}
+
+FVector ATCPlayerCameraManager::ResolveCameraCollision(const FVector& TraceOrigin, const FVector& TraceTarget,
+                                                       float TraceRadius, ECollisionChannel TraceChannel, float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_CameraCollision);
+
+	const FVector TraceDelta = TraceTarget - TraceOrigin;
+
+	if (!bUseAsyncCameraTrace)
+	{
+		LastTraceFraction = SmoothedTraceFraction = SweepCameraCollision(TraceOrigin, TraceTarget, TraceRadius, TraceChannel);
+		return TraceOrigin + TraceDelta * SmoothedTraceFraction;
+	}
+
+	UWorld* World = GetWorld();
+	check(World);
+
+	// Pick up the sweep issued on the previous frame, if it has completed.
+	bool bHasFreshResult = false;
+	FTraceDatum TraceData;
+	if (PendingCameraTrace.IsValid() && World->QueryTraceData(PendingCameraTrace, TraceData))
+	{
+		LastTraceFraction = 1.0f;
+		for (const FHitResult& Hit : TraceData.OutHits)
+		{
+			if (Hit.bBlockingHit && !Hit.bStartPenetrating)
+			{
+				LastTraceFraction = Hit.Time;
+				break;
+			}
+		}
+
+		LastTraceOrigin = PendingTraceOrigin;
+		LastTraceTarget = PendingTraceTarget;
+		bHasCameraTraceResult = true;
+		bHasFreshResult = true;
+	}
+
+	// The async result is a frame old. Sweep synchronously instead if there is nothing to go on yet, if the trace
+	// segment has since moved too far for the old fraction to be trusted, or if a large obstruction just appeared
+	// and reusing the stale fraction would let the camera clip through it for a frame.
+	const float MaxDriftSq = FMath::Square(AsyncTraceMaxDrift);
+	const bool bDrifted = FVector::DistSquared(TraceOrigin, LastTraceOrigin) > MaxDriftSq ||
+		FVector::DistSquared(TraceTarget, LastTraceTarget) > MaxDriftSq;
+	const bool bSuddenOcclusion = bHasFreshResult && SmoothedTraceFraction - LastTraceFraction > AsyncTraceOcclusionThreshold;
+
+	const bool bSweepSync = !bHasCameraTraceResult || bDrifted || bSuddenOcclusion;
+	if (bSweepSync)
+	{
+		LastTraceFraction = SweepCameraCollision(TraceOrigin, TraceTarget, TraceRadius, TraceChannel);
+		LastTraceOrigin = TraceOrigin;
+		LastTraceTarget = TraceTarget;
+		bHasCameraTraceResult = true;
+	}
+
+	// Snap in immediately so the camera never clips, but ease back out to hide the one frame of latency.
+	if (LastTraceFraction < SmoothedTraceFraction)
+	{
+		SmoothedTraceFraction = LastTraceFraction;
+	}
+	else
+	{
+		SmoothedTraceFraction = FMath::FInterpTo(SmoothedTraceFraction, LastTraceFraction, DeltaTime, AsyncTraceRecoverySpeed);
+	}
+
+	// Queue the sweep for the current segment; its result is consumed next frame. A frame that just swept
+	// synchronously already has this segment's result, so it skips the async sweep rather than paying twice.
+	if (bSweepSync)
+	{
+		PendingCameraTrace.Invalidate();
+	}
+	else
+	{
+		FCollisionQueryParams Params;
+		Params.AddIgnoredActor(this);
+
+		UTCPhysicsQuerySubsystem* Queries = World->GetSubsystem<UTCPhysicsQuerySubsystem>();
+		check(Queries);
+
+		FTCQueryRequest Request(ETCQuerySource::Camera, this, Params);
+		Request.Start = TraceOrigin;
+		Request.End = TraceTarget;
+		Request.Shape = FCollisionShape::MakeSphere(TraceRadius);
+		Request.Channel = TraceChannel;
+
+		PendingCameraTrace = Queries->QueryAsync(Request);
+		PendingTraceOrigin = TraceOrigin;
+		PendingTraceTarget = TraceTarget;
+	}
+
+	// Re-apply the fraction to the current segment rather than the one it was traced along, which predicts
+	// the correction for this frame's camera movement.
+	const FVector ResolvedLocation = TraceOrigin + TraceDelta * SmoothedTraceFraction;
+
+#if !UE_BUILD_SHIPPING
+	if (CVarCameraAsyncTraceCompare.GetValueOnGameThread() != 0)
+	{
+		const float SyncFraction = SweepCameraCollision(TraceOrigin, TraceTarget, TraceRadius, TraceChannel);
+		RecordCameraTraceJitter(ResolvedLocation, TraceOrigin + TraceDelta * SyncFraction);
+	}
+#endif
+
+	return ResolvedLocation;
+}
+
+float ATCPlayerCameraManager::SweepCameraCollision(const FVector& TraceOrigin, const FVector& TraceTarget,
+                                                   float TraceRadius, ECollisionChannel TraceChannel) const
+{
 	UWorld* World = GetWorld();
 	check(World);
 
+	UTCPhysicsQuerySubsystem* Queries = World->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
+
 	FCollisionQueryParams Params;
 	Params.AddIgnoredActor(this);
 
+	FTCQueryRequest Request(ETCQuerySource::Camera, this, Params);
+	Request.Start = TraceOrigin;
+	Request.End = TraceTarget;
+	Request.Shape = FCollisionShape::MakeSphere(TraceRadius);
+	Request.Channel = TraceChannel;
+
 	FHitResult HitResult;
-	World->SweepSingleByChannel(HitResult, TraceOrigin, TargetCameraLocation, FQuat::Identity,
-	                            TraceChannel, FCollisionShape::MakeSphere(TraceRadius), Params);
+	Queries->Query(Request, HitResult);
 
-	if (HitResult.IsValidBlockingHit())
-	{
-		TargetCameraLocation += (HitResult.Location - HitResult.TraceEnd);
-	}
+	return HitResult.IsValidBlockingHit() ? HitResult.Time : 1.0f;
+}
 
-	// Step 7: Draw Debug Shapes.
-	DrawDebugTargets(PivotTarget.GetLocation());
+#if !UE_BUILD_SHIPPING
+void ATCPlayerCameraManager::RecordCameraTraceJitter(const FVector& AsyncLocation, const FVector& SyncLocation)
+{
+	FCameraTraceJitterStats& Stats = JitterStats;
 
-	// Step 8: Lerp First Person Override and return target camera parameters.
-	FTransform TargetCameraTransform(TargetCameraRotation, TargetCameraLocation, FVector::OneVector);
-	FTransform FPTargetCameraTransform(TargetCameraRotation, FPTarget, FVector::OneVector);
+	// Jitter is the second difference of the camera position, i.e. how much its velocity changed this frame.
+	if (Stats.NumSamples >= 2)
+	{
+		Stats.AsyncJitterSum += (AsyncLocation - 2.0f * Stats.AsyncHistory[1] + Stats.AsyncHistory[0]).Size();
+		Stats.SyncJitterSum += (SyncLocation - 2.0f * Stats.SyncHistory[1] + Stats.SyncHistory[0]).Size();
+	}
 
-	const FTransform& MixedTransform = UKismetMathLibrary::TLerp(TargetCameraTransform, FPTargetCameraTransform,
-	                                                             GetCameraBehaviorParam(FName(TEXT("Weight_FirstPerson"))));
+	const float Deviation = FVector::Dist(AsyncLocation, SyncLocation);
+	Stats.DeviationSum += Deviation;
+	Stats.MaxDeviation = FMath::Max(Stats.MaxDeviation, Deviation);
 
-	const FTransform& TargetTransform = UKismetMathLibrary::TLerp(MixedTransform,
-	                                                              FTransform(DebugViewRotation, TargetCameraLocation, FVector::OneVector),
-	                                                              GetCameraBehaviorParam(FName(TEXT("Override_Debug"))));
+	Stats.AsyncHistory[0] = Stats.AsyncHistory[1];
+	Stats.AsyncHistory[1] = AsyncLocation;
+	Stats.SyncHistory[0] = Stats.SyncHistory[1];
+	Stats.SyncHistory[1] = SyncLocation;
+	++Stats.NumSamples;
 
-	Location = TargetTransform.GetLocation();
-	Rotation = TargetTransform.Rotator();
-	FOV = FMath::Lerp(TPFOV, FPFOV, GetCameraBehaviorParam(FName(TEXT("Weight_FirstPerson"))));
+	if (Stats.NumSamples >= CameraJitterReportInterval)
+	{
+		const double JitterSamples = Stats.NumSamples - 2;
+		UE_LOG(LogHorizonsTC, Log,
+		       TEXT("Camera trace over %d frames: async jitter %.3f, sync jitter %.3f, mean deviation %.3f, max deviation %.3f"),
+		       Stats.NumSamples, Stats.AsyncJitterSum / JitterSamples, Stats.SyncJitterSum / JitterSamples,
+		       Stats.DeviationSum / Stats.NumSamples, Stats.MaxDeviation);
 
-	return true;
+		Stats = FCameraTraceJitterStats();
+	}
 }
+#endif
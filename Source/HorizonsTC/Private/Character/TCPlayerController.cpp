@@ -3,9 +3,11 @@
 
 #include "Character/TCPlayerController.h"
 #include "Character/TCCharacter.h"
+#include "Character/TCCheatManager.h"
 #include "Character/TCPlayerCameraManager.h"
 #include "Actors/Quests/QuestManager.h"
 #include "TCStatics.h"
+#include "TCMemory.h"
 
 #include "UI/HUDWidget.h"
 #include "UI/PauseStackWidget.h"
@@ -17,6 +19,26 @@
 #include "Actors/Components/ObjectiveComponent.h"
 #include "Actors/Weapons/BaseFirearm.h"
 #include "Character/Components/WeaponComponent.h"
+#include "Game/TCPhysicsQuerySubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Net/UnrealNetwork.h"
+#include "TCStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Player Aim Trace"), STAT_TC_PlayerAimTrace, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Player Aim Reuses"), STAT_TC_PlayerAimReuses, STATGROUP_HorizonsTC_Weapons);
+
+static TAutoConsoleVariable<int32> CVarSharedAimTrace(
+	TEXT("tc.Aim.SharedTrace"),
+	1,
+	TEXT("Share one camera aim trace per frame between the weapon, crosshair and interactions. 0 traces on every request."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAimTraceDistance(
+	TEXT("tc.Aim.TraceDistance"),
+	10000.0f,
+	TEXT("Length of the player's camera aim trace."),
+	ECVF_Default);
 
 ATCPlayerController::ATCPlayerController()
 {
@@ -27,25 +49,63 @@ ATCPlayerController::ATCPlayerController()
 
 	// Create objective component to communicate with quest manager
 	ObjectiveComp = CreateDefaultSubobject<UObjectiveComponent>(TEXT("Objective"));
+
+	CheatClass = UTCCheatManager::StaticClass();
 }
 
 void ATCPlayerController::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// Spawn Quest Manager
-	QuestManagerRef = GetWorld()->SpawnActor<AQuestManager>(QuestManagerClass);
+	// Spawn Quest Manager. Quest state is server authoritative, clients receive their manager through replication.
+	if (HasAuthority())
+	{
+		TC_LLM_SCOPE(Quests);
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		QuestManagerRef = GetWorld()->SpawnActor<AQuestManager>(QuestManagerClass, SpawnParams);
+	}
 
 	// Spawn HUD
-	HUDRef = CreateWidget<UUserWidget>(GetWorld(), HUDUIClass);
+	{
+		TC_LLM_SCOPE(UI);
+		HUDRef = CreateWidget<UUserWidget>(GetWorld(), HUDUIClass);
 
-	if (HUDRef)
+		if (HUDRef)
+		{
+			HUDRef->AddToViewport();
+			bHUDOpen = true;
+		}
+	}
+
+	// Traces started from the command line cover the level from its first frame
+	if (IsLocalPlayerController())
 	{
-		HUDRef->AddToViewport();
-		bHUDOpen = true;
+		FString TraceName;
+		if (FParse::Value(FCommandLine::Get(), TEXT("TCReplayInput="), TraceName))
+		{
+			StartInputReplay(TraceName, true);
+		}
+		else if (FParse::Value(FCommandLine::Get(), TEXT("TCRecordInput="), TraceName))
+		{
+			StartInputRecording(TraceName);
+		}
 	}
 }
 
+void ATCPlayerController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Ending the level ends a command line recording, so write it out
+	if (InputReplay)
+	{
+		StopInputRecording();
+		InputReplay.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void ATCPlayerController::SetupInputComponent()
 {
 	Super::SetupInputComponent();
@@ -59,6 +119,104 @@ void ATCPlayerController::SetupInputComponent()
 	PauseAction.bConsumeInput = true;
 }
 
+bool ATCPlayerController::StartInputRecording(const FString& Name)
+{
+	if (!IsLocalPlayerController())
+	{
+		return false;
+	}
+
+	if (!InputReplay)
+	{
+		InputReplay = MakeUnique<FTCInputReplay>(this);
+	}
+
+	return InputReplay->StartRecording(Name);
+}
+
+bool ATCPlayerController::StopInputRecording()
+{
+	return InputReplay && InputReplay->StopRecording();
+}
+
+bool ATCPlayerController::StartInputReplay(const FString& Name, bool bQuitWhenFinished)
+{
+	if (!IsLocalPlayerController())
+	{
+		return false;
+	}
+
+	if (!InputReplay)
+	{
+		InputReplay = MakeUnique<FTCInputReplay>(this);
+	}
+
+	return InputReplay->StartPlayback(Name, bQuitWhenFinished);
+}
+
+bool ATCPlayerController::InputKey(FKey Key, EInputEvent EventType, float AmountDepressed, bool bGamepad)
+{
+	if (InputReplay)
+	{
+		// The trace is the only input while it plays
+		if (InputReplay->IsPlaying())
+		{
+			return true;
+		}
+
+		FTCInputEvent Event;
+		Event.Key = Key;
+		Event.Value = AmountDepressed;
+		Event.Event = EventType;
+		Event.bGamepad = bGamepad;
+		InputReplay->RecordEvent(Event);
+	}
+
+	return Super::InputKey(Key, EventType, AmountDepressed, bGamepad);
+}
+
+bool ATCPlayerController::InputAxis(FKey Key, float Delta, float DeltaTime, int32 NumSamples, bool bGamepad)
+{
+	if (InputReplay)
+	{
+		if (InputReplay->IsPlaying())
+		{
+			return true;
+		}
+
+		FTCInputEvent Event;
+		Event.Key = Key;
+		Event.Value = Delta;
+		Event.NumSamples = (uint8)FMath::Clamp(NumSamples, 0, (int32)MAX_uint8);
+		Event.bAxis = true;
+		Event.bGamepad = bGamepad;
+		InputReplay->RecordEvent(Event);
+	}
+
+	return Super::InputAxis(Key, Delta, DeltaTime, NumSamples, bGamepad);
+}
+
+void ATCPlayerController::PlayerTick(float DeltaTime)
+{
+	// Input has to reach the player input before Super processes it this frame
+	if (InputReplay)
+	{
+		InputReplay->Tick(DeltaTime, [this, DeltaTime](const FTCInputEvent& Event)
+		{
+			if (Event.bAxis)
+			{
+				Super::InputAxis(Event.Key, Event.Value, DeltaTime, Event.NumSamples, Event.bGamepad);
+			}
+			else
+			{
+				Super::InputKey(Event.Key, Event.Event, Event.Value, Event.bGamepad);
+			}
+		});
+	}
+
+	Super::PlayerTick(DeltaTime);
+}
+
 bool ATCPlayerController::IsHudOpen() const
 {
 	return bHUDOpen;
@@ -69,6 +227,13 @@ bool ATCPlayerController::IsPauseStackOpen() const
 	return bUsingPauseMenus;
 }
 
+void ATCPlayerController::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(ATCPlayerController, QuestManagerRef, COND_OwnerOnly);
+}
+
 AQuestManager* ATCPlayerController::GetQuestManager() const
 {
 	return QuestManagerRef;
@@ -163,7 +328,8 @@ void ATCPlayerController::ToggleQuestMenu()
 		// Case 1: From Gameplay
 		if (PauseStackClass)
 		{
-			// Create the master widget and add it to the viewport
+			// Create the master widget and add it to the viewport. Its child menus are built inside CreateWidget.
+			TC_LLM_SCOPE(UI);
 			PauseStackRef = CreateWidget<UUserWidget>(GetWorld(), PauseStackClass);
 
 			if (PauseStackRef)
@@ -216,7 +382,8 @@ void ATCPlayerController::TogglePauseMenu()
 		// Case 1: From Gameplay
 		if (PauseStackClass)
 		{
-			// Create the master widget and add it to the viewport
+			// Create the master widget and add it to the viewport. Its child menus are built inside CreateWidget.
+			TC_LLM_SCOPE(UI);
 			PauseStackRef = CreateWidget<UUserWidget>(GetWorld(), PauseStackClass);
 
 			if (PauseStackRef)
@@ -335,3 +502,89 @@ bool ATCPlayerController::IsInLimitedInputMode() const
 {
 	return bLimitedInputMode;
 }
+
+const FTCPlayerAim& ATCPlayerController::GetPlayerAim(bool bRequireFresh)
+{
+	FVector CameraLocation;
+	FRotator CameraRotation;
+	GetPlayerViewPoint(CameraLocation, CameraRotation);
+
+	const FVector AimDirection = CameraRotation.Vector();
+
+	// Reuse this frame's trace as long as the camera hasn't moved since it was made
+	const bool bCanReuse = !bRequireFresh && CVarSharedAimTrace.GetValueOnGameThread() != 0
+		&& PlayerAim.Frame == GFrameCounter
+		&& PlayerAim.Origin.Equals(CameraLocation) && PlayerAim.Direction.Equals(AimDirection);
+
+	if (bCanReuse)
+	{
+		INC_DWORD_STAT(STAT_TC_PlayerAimReuses);
+	}
+	else
+	{
+		UpdatePlayerAim(CameraLocation, AimDirection, bRequireFresh);
+	}
+
+	return PlayerAim;
+}
+
+const FTCPlayerAim& ATCPlayerController::GetShotAim()
+{
+	// A second shot in the same frame traces again so it sees the world after the first
+	const bool bShotThisFrame = LastShotAimFrame == GFrameCounter;
+	LastShotAimFrame = GFrameCounter;
+
+	return GetPlayerAim(bShotThisFrame);
+}
+
+bool ATCPlayerController::GetAimHit(FHitResult& OutHit, FVector& OutAimPoint)
+{
+	const FTCPlayerAim& Aim = GetPlayerAim();
+
+	OutHit = Aim.Hit;
+	OutAimPoint = Aim.GetAimPoint();
+
+	return Aim.bHit;
+}
+
+void ATCPlayerController::UpdatePlayerAim(const FVector& CameraLocation, const FVector& AimDirection, bool bRequireFresh)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_PlayerAimTrace);
+
+	APawn* MyPawn = GetPawn();
+
+	// Start level with the pawn so nothing between the camera and the character can block the trace
+	const float PawnDistance = MyPawn
+		? FMath::Max(0.0f, FVector::DotProduct(MyPawn->GetActorLocation() - CameraLocation, AimDirection)) : 0.0f;
+
+	PlayerAim.Origin = CameraLocation;
+	PlayerAim.Direction = AimDirection;
+	PlayerAim.Start = CameraLocation + AimDirection * PawnDistance;
+	PlayerAim.End = CameraLocation + AimDirection * CVarAimTraceDistance.GetValueOnGameThread();
+	PlayerAim.Frame = GFrameCounter;
+
+	FCollisionQueryParams TraceParams(TEXT("WeaponTrace"), true, MyPawn);
+	TraceParams.bReturnPhysicalMaterial = true;
+
+	// Ignore ourselves and everything we carry
+	if (MyPawn)
+	{
+		TArray<AActor*> AttachedActors;
+		MyPawn->GetAttachedActors(AttachedActors);
+
+		TraceParams.AddIgnoredActor(MyPawn);
+		TraceParams.AddIgnoredActors(AttachedActors);
+	}
+
+	FTCQueryRequest Request(ETCQuerySource::WeaponAim, this, TraceParams);
+	Request.Start = PlayerAim.Start;
+	Request.End = PlayerAim.End;
+	Request.Channel = ECollisionChannel::ECC_Visibility;
+	Request.bAllowReuse = !bRequireFresh;
+
+	UTCPhysicsQuerySubsystem* Queries = GetWorld()->GetSubsystem<UTCPhysicsQuerySubsystem>();
+	check(Queries);
+
+	PlayerAim.Hit = FHitResult(ForceInit);
+	PlayerAim.bHit = Queries->Query(Request, PlayerAim.Hit);
+}
@@ -0,0 +1,114 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Game/TCDamageQueueSubsystem.h"
+
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "TCStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Apply Queued Damage"), STAT_TC_ApplyQueuedDamage, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Hits"), STAT_TC_DamageHits, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Events Applied"), STAT_TC_DamageEventsApplied, STATGROUP_HorizonsTC_Weapons);
+
+static TAutoConsoleVariable<int32> CVarDeferredDamage(
+	TEXT("tc.Damage.Deferred"),
+	1,
+	TEXT("Queue damage and apply it once per target after physics. 0 applies each hit as it happens."),
+	ECVF_Default);
+
+void FTCDamageQueueTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+                                             const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target)
+	{
+		Target->FlushDamage();
+	}
+}
+
+FString FTCDamageQueueTickFunction::DiagnosticMessage()
+{
+	return TEXT("UTCDamageQueueSubsystem::FlushDamage");
+}
+
+void UTCDamageQueueSubsystem::QueueDamage(AActor* DamagedActor, float BaseDamage, AController* EventInstigator,
+                                          AActor* DamageCauser)
+{
+	if (!DamagedActor || BaseDamage == 0.0f)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_TC_DamageHits);
+
+	if (CVarDeferredDamage.GetValueOnGameThread() == 0)
+	{
+		INC_DWORD_STAT(STAT_TC_DamageEventsApplied);
+		UGameplayStatics::ApplyDamage(DamagedActor, BaseDamage, EventInstigator, DamageCauser, UDamageType::StaticClass());
+		return;
+	}
+
+	FPendingDamage& Pending = PendingDamage.FindOrAdd(DamagedActor);
+	Pending.Damage += BaseDamage;
+	Pending.NumHits++;
+	Pending.EventInstigator = EventInstigator;
+	Pending.DamageCauser = DamageCauser;
+
+	// The tick function only runs while there's something to apply
+	if (!DamageTickFunction.IsTickFunctionRegistered())
+	{
+		UWorld* World = GetWorld();
+		check(World && World->PersistentLevel);
+
+		DamageTickFunction.Target = this;
+		DamageTickFunction.TickGroup = TG_PostPhysics;
+		DamageTickFunction.bCanEverTick = true;
+		DamageTickFunction.bStartWithTickEnabled = false;
+		DamageTickFunction.RegisterTickFunction(World->PersistentLevel);
+	}
+	DamageTickFunction.SetTickFunctionEnable(true);
+}
+
+void UTCDamageQueueSubsystem::FlushDamage()
+{
+	TC_SCOPE_CYCLE_COUNTER(STAT_TC_ApplyQueuedDamage);
+
+	int32 NumHits = 0;
+
+	// Damage can queue more damage (e.g. explosions on death), which waits for the next flush
+	TMap<TWeakObjectPtr<AActor>, FPendingDamage> ToApply = MoveTemp(PendingDamage);
+
+	for (const auto& Entry : ToApply)
+	{
+		NumHits += Entry.Value.NumHits;
+
+		if (AActor* DamagedActor = Entry.Key.Get())
+		{
+			INC_DWORD_STAT(STAT_TC_DamageEventsApplied);
+			UGameplayStatics::ApplyDamage(DamagedActor, Entry.Value.Damage, Entry.Value.EventInstigator.Get(),
+				Entry.Value.DamageCauser.Get(), UDamageType::StaticClass());
+		}
+	}
+
+	CSV_CUSTOM_STAT(HorizonsTC, DamageHitsPerFrame, NumHits, ECsvCustomStatOp::Set);
+
+	if (PendingDamage.Num() == 0)
+	{
+		DamageTickFunction.SetTickFunctionEnable(false);
+	}
+}
+
+void UTCDamageQueueSubsystem::Deinitialize()
+{
+	if (DamageTickFunction.IsTickFunctionRegistered())
+	{
+		DamageTickFunction.UnRegisterTickFunction();
+	}
+	PendingDamage.Empty();
+
+	Super::Deinitialize();
+}
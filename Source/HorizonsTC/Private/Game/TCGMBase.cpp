@@ -2,4 +2,16 @@
 
 
 #include "Game/TCGMBase.h"
+#include "Game/TCLocomotionBenchmark.h"
 
+#include "Misc/CommandLine.h"
+
+void ATCGMBase::StartPlay()
+{
+	Super::StartPlay();
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("TCLocomotionBenchmark")))
+	{
+		ATCLocomotionBenchmark::StartBenchmark(GetWorld());
+	}
+}
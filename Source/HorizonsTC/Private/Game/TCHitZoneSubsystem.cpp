@@ -0,0 +1,99 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Game/TCHitZoneSubsystem.h"
+
+#include "Actors/Weapons/BaseFirearm.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "TCStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Bake Hit Zones"), STAT_TC_BakeHitZones, STATGROUP_HorizonsTC_Weapons);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Hit Zone Tables"), STAT_TC_HitZoneTables, STATGROUP_HorizonsTC_Weapons);
+
+void UTCHitZoneSubsystem::RegisterMesh(const USkeletalMeshComponent* Mesh)
+{
+	if (Mesh && Mesh->GetPhysicsAsset())
+	{
+		FindOrBakeTable(Mesh->GetPhysicsAsset());
+	}
+}
+
+EHitZone UTCHitZoneSubsystem::ResolveHitZone(const FHitResult& Hit)
+{
+	const USkeletalMeshComponent* Mesh = Cast<USkeletalMeshComponent>(Hit.GetComponent());
+	const UPhysicsAsset* PhysicsAsset = Mesh ? Mesh->GetPhysicsAsset() : nullptr;
+	if (!PhysicsAsset)
+	{
+		return EHitZone::Torso;
+	}
+
+	const FTCHitZoneTable& Table = FindOrBakeTable(PhysicsAsset);
+	return Table.BodyZones.IsValidIndex(Hit.Item) ? Table.BodyZones[Hit.Item] : EHitZone::Torso;
+}
+
+EHitZone UTCHitZoneSubsystem::ClassifyBone(FName BoneName)
+{
+	// Checked in order against the mannequin bone names our skeletons share. Everything else is torso.
+	struct FZoneRule
+	{
+		const TCHAR* Pattern;
+		EHitZone Zone;
+	};
+
+	static const FZoneRule Rules[] =
+	{
+		{ TEXT("head"), EHitZone::Head },
+		{ TEXT("upperarm"), EHitZone::Limb },
+		{ TEXT("lowerarm"), EHitZone::Limb },
+		{ TEXT("hand"), EHitZone::Limb },
+		{ TEXT("thigh"), EHitZone::Limb },
+		{ TEXT("calf"), EHitZone::Limb },
+		{ TEXT("foot"), EHitZone::Limb },
+		{ TEXT("ball"), EHitZone::Limb }
+	};
+
+	const FString Name = BoneName.ToString();
+	for (const auto& Rule : Rules)
+	{
+		if (Name.Contains(Rule.Pattern))
+		{
+			return Rule.Zone;
+		}
+	}
+
+	return EHitZone::Torso;
+}
+
+const FTCHitZoneTable& UTCHitZoneSubsystem::FindOrBakeTable(const UPhysicsAsset* PhysicsAsset)
+{
+	check(PhysicsAsset);
+
+	if (const FTCHitZoneTable* Found = Tables.Find(PhysicsAsset))
+	{
+		return *Found;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TC_BakeHitZones);
+	INC_DWORD_STAT(STAT_TC_HitZoneTables);
+
+	// Body setups are in body index order, the same order the mesh's bodies (and so Hit.Item) use
+	FTCHitZoneTable& Table = Tables.Add(PhysicsAsset);
+	Table.BodyZones.Reserve(PhysicsAsset->SkeletalBodySetups.Num());
+
+	for (const USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+	{
+		Table.BodyZones.Add(BodySetup ? ClassifyBone(BodySetup->BoneName) : EHitZone::Torso);
+	}
+
+	return Table;
+}
+
+void UTCHitZoneSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_TC_HitZoneTables, Tables.Num());
+	Tables.Empty();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,294 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Game/TCLagCompensationSubsystem.h"
+
+#include "Character/TCBaseCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TCStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Record Hitbox History"), STAT_TC_LagCompRecord, STATGROUP_HorizonsTC_Character);
+DECLARE_CYCLE_STAT(TEXT("Rewind Trace"), STAT_TC_LagCompRewind, STATGROUP_HorizonsTC_Character);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewind Capsule Tests"), STAT_TC_LagCompCapsuleTests, STATGROUP_HorizonsTC_Character);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewind Mesh Tests"), STAT_TC_LagCompMeshTests, STATGROUP_HorizonsTC_Character);
+DECLARE_MEMORY_STAT(TEXT("Hitbox History"), STAT_TC_HitboxHistoryMemory, STATGROUP_HorizonsTC_Character);
+
+static TAutoConsoleVariable<float> CVarLagCompMaxRewindMs(
+	TEXT("tc.LagComp.MaxRewindMs"),
+	400.0f,
+	TEXT("Longest a shot can be rewound, i.e. the highest latency that is fully compensated. Sizes the hitbox history."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarLagCompSampleRate(
+	TEXT("tc.LagComp.SampleRate"),
+	60.0f,
+	TEXT("Hitbox history samples per second."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarLagCompDebug(
+	TEXT("tc.LagComp.Debug"),
+	0,
+	TEXT("Draw the rewound capsules and the shot segment for every rewind trace."),
+	ECVF_Cheat);
+
+/************************************************************************/
+/* Hitbox History                                                       */
+/************************************************************************/
+
+void FTCHitboxHistory::Init(ATCBaseCharacter* InCharacter, int32 Capacity)
+{
+	Character = InCharacter;
+	CapsuleRadius = InCharacter->GetCapsuleComponent()->GetScaledCapsuleRadius();
+
+	Times.SetNumZeroed(Capacity);
+	Locations.SetNumZeroed(Capacity);
+	Yaws.SetNumZeroed(Capacity);
+	HalfHeights.SetNumZeroed(Capacity);
+
+	Head = 0;
+	NumSamples = 0;
+}
+
+void FTCHitboxHistory::Record(float Time, const FVector& Location, float Yaw, float HalfHeight)
+{
+	Times[Head] = Time;
+	Locations[Head] = Location;
+	Yaws[Head] = Yaw;
+	HalfHeights[Head] = HalfHeight;
+
+	Head = (Head + 1) % Times.Num();
+	NumSamples = FMath::Min(NumSamples + 1, Times.Num());
+}
+
+bool FTCHitboxHistory::Sample(float Time, FTransform& OutTransform, float& OutHalfHeight) const
+{
+	const int32 Capacity = Times.Num();
+
+	// Walk back from the newest sample to the first one at or before Time
+	int32 Newer = INDEX_NONE;
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		const int32 Index = (Head - 1 - i + Capacity) % Capacity;
+		if (Times[Index] > Time)
+		{
+			Newer = Index;
+			continue;
+		}
+
+		// Time is past our newest sample (clock jitter), use the newest
+		if (Newer == INDEX_NONE)
+		{
+			OutTransform = FTransform(FRotator(0.0f, Yaws[Index], 0.0f), Locations[Index]);
+			OutHalfHeight = HalfHeights[Index];
+			return true;
+		}
+
+		const float Alpha = (Time - Times[Index]) / FMath::Max(Times[Newer] - Times[Index], KINDA_SMALL_NUMBER);
+		const float Yaw = Yaws[Index] + Alpha * FRotator::NormalizeAxis(Yaws[Newer] - Yaws[Index]);
+
+		OutTransform = FTransform(FRotator(0.0f, Yaw, 0.0f), FMath::Lerp(Locations[Index], Locations[Newer], Alpha));
+		OutHalfHeight = FMath::Lerp(HalfHeights[Index], HalfHeights[Newer], Alpha);
+		return true;
+	}
+
+	return false;
+}
+
+SIZE_T FTCHitboxHistory::GetAllocatedSize() const
+{
+	return Times.GetAllocatedSize() + Locations.GetAllocatedSize() + Yaws.GetAllocatedSize() + HalfHeights.GetAllocatedSize();
+}
+
+/************************************************************************/
+/* Subsystem                                                            */
+/************************************************************************/
+
+void UTCLagCompensationSubsystem::RegisterCharacter(ATCBaseCharacter* Character)
+{
+	check(Character);
+
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	for (const FTCHitboxHistory& History : Histories)
+	{
+		if (History.Character == Character)
+		{
+			return;
+		}
+	}
+
+	Histories.AddDefaulted_GetRef().Init(Character, GetHistoryCapacity());
+	UpdateMemoryStat();
+}
+
+void UTCLagCompensationSubsystem::UnregisterCharacter(ATCBaseCharacter* Character)
+{
+	Histories.RemoveAllSwap([Character](const FTCHitboxHistory& History) { return History.Character == Character; });
+	UpdateMemoryStat();
+}
+
+bool UTCLagCompensationSubsystem::IsRecording() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->GetNetMode() != NM_Standalone && World->GetNetMode() != NM_Client;
+}
+
+bool UTCLagCompensationSubsystem::RewindTrace(const FVector& Start, const FVector& End, float Time,
+                                              const AActor* IgnoreActor, FHitResult& OutHit)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_LagCompRewind);
+
+	// Never rewind past the history we keep
+	const float Now = GetWorld()->GetTimeSeconds();
+	const float RewindTime = FMath::Max(Time, Now - CVarLagCompMaxRewindMs.GetValueOnGameThread() / 1000.0f);
+	const bool bDebug = CVarLagCompDebug.GetValueOnGameThread() != 0;
+
+	float BestDistSq = TNumericLimits<float>::Max();
+	bool bHit = false;
+
+	for (const FTCHitboxHistory& History : Histories)
+	{
+		ATCBaseCharacter* Character = History.Character.Get();
+		if (!Character || Character == IgnoreActor)
+		{
+			continue;
+		}
+
+		FTransform Rewound;
+		float HalfHeight;
+		if (!History.Sample(RewindTime, Rewound, HalfHeight))
+		{
+			continue;
+		}
+
+		// Step 1: Segment against the rewound capsule.
+		INC_DWORD_STAT(STAT_TC_LagCompCapsuleTests);
+
+		const FVector Center = Rewound.GetLocation();
+		const FVector AxisOffset(0.0f, 0.0f, FMath::Max(0.0f, HalfHeight - History.CapsuleRadius));
+
+		FVector OnShot, OnAxis;
+		FMath::SegmentDistToSegmentSafe(Start, End, Center - AxisOffset, Center + AxisOffset, OnShot, OnAxis);
+
+		if (bDebug)
+		{
+			DrawDebugCapsule(GetWorld(), Center, HalfHeight, History.CapsuleRadius, Rewound.GetRotation(), FColor::Orange, false, 2.0f);
+		}
+
+		const float DistSq = FVector::DistSquared(Start, OnShot);
+		if (FVector::DistSquared(OnShot, OnAxis) > FMath::Square(History.CapsuleRadius) || DistSq >= BestDistSq)
+		{
+			continue;
+		}
+
+		// Step 2: The mesh, with the segment carried from the rewound capsule into the current one.
+		INC_DWORD_STAT(STAT_TC_LagCompMeshTests);
+
+		const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		const FTransform Current(Capsule->GetComponentQuat(), Capsule->GetComponentLocation());
+		const FVector MeshStart = Current.TransformPosition(Rewound.InverseTransformPosition(Start));
+		const FVector MeshEnd = Current.TransformPosition(Rewound.InverseTransformPosition(End));
+
+		FHitResult MeshHit;
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(TCLagCompTrace), true);
+		if (Character->GetMesh()->LineTraceComponent(MeshHit, MeshStart, MeshEnd, Params))
+		{
+			BestDistSq = DistSq;
+			OutHit = MeshHit;
+			bHit = true;
+		}
+	}
+
+	if (bDebug)
+	{
+		DrawDebugLine(GetWorld(), Start, End, bHit ? FColor::Red : FColor::White, false, 2.0f);
+	}
+
+	return bHit;
+}
+
+void UTCLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceSample += DeltaTime;
+	if (TimeSinceSample < 1.0f / FMath::Max(1.0f, CVarLagCompSampleRate.GetValueOnGameThread()))
+	{
+		return;
+	}
+	TimeSinceSample = 0.0f;
+
+	SCOPE_CYCLE_COUNTER(STAT_TC_LagCompRecord);
+
+	Histories.RemoveAllSwap([](const FTCHitboxHistory& History) { return !History.Character.IsValid(); });
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const int32 Capacity = GetHistoryCapacity();
+	bool bResized = false;
+
+	for (FTCHitboxHistory& History : Histories)
+	{
+		ATCBaseCharacter* Character = History.Character.Get();
+
+		// Picks up changes to the rewind window or sample rate
+		if (History.Times.Num() != Capacity)
+		{
+			History.Init(Character, Capacity);
+			bResized = true;
+		}
+
+		const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		History.Record(Now, Capsule->GetComponentLocation(), Capsule->GetComponentRotation().Yaw,
+		               Capsule->GetScaledCapsuleHalfHeight());
+	}
+
+	if (bResized)
+	{
+		UpdateMemoryStat();
+	}
+}
+
+bool UTCLagCompensationSubsystem::IsTickable() const
+{
+	return !IsTemplate() && Histories.Num() > 0;
+}
+
+TStatId UTCLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTCLagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void UTCLagCompensationSubsystem::Deinitialize()
+{
+	Histories.Empty();
+	UpdateMemoryStat();
+
+	Super::Deinitialize();
+}
+
+int32 UTCLagCompensationSubsystem::GetHistoryCapacity()
+{
+	const float MaxRewind = FMath::Max(0.0f, CVarLagCompMaxRewindMs.GetValueOnGameThread()) / 1000.0f;
+	const float SampleRate = FMath::Max(1.0f, CVarLagCompSampleRate.GetValueOnGameThread());
+
+	// One extra sample so a full-length rewind always has a sample on each side
+	return FMath::CeilToInt(MaxRewind * SampleRate) + 2;
+}
+
+void UTCLagCompensationSubsystem::UpdateMemoryStat()
+{
+	SIZE_T Memory = Histories.GetAllocatedSize();
+	for (const FTCHitboxHistory& History : Histories)
+	{
+		Memory += History.GetAllocatedSize();
+	}
+
+	DEC_MEMORY_STAT_BY(STAT_TC_HitboxHistoryMemory, TrackedMemory);
+	INC_MEMORY_STAT_BY(STAT_TC_HitboxHistoryMemory, Memory);
+	TrackedMemory = Memory;
+}
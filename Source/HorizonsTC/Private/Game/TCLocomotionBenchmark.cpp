@@ -0,0 +1,434 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Game/TCLocomotionBenchmark.h"
+
+#include "Character/TCBaseCharacter.h"
+#include "Game/TCRagdollSubsystem.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "TCLog.h"
+
+static FAutoConsoleCommandWithWorldAndArgs CmdLocomotionBenchmark(
+	TEXT("tc.Benchmark.Locomotion"),
+	TEXT("Runs the locomotion benchmark in the current world. Optional argument: number of bots."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumBots = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0;
+		ATCLocomotionBenchmark::StartBenchmark(World, NumBots);
+	}));
+
+ATCLocomotionBenchmark::ATCLocomotionBenchmark()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+ATCLocomotionBenchmark* ATCLocomotionBenchmark::StartBenchmark(UWorld* World, int32 NumBotsOverride)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	// Step 1: Start from the first player start so the test map decides where the bots run
+	FTransform SpawnTransform = FTransform::Identity;
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		SpawnTransform = FTransform(FRotator(0.0f, It->GetActorRotation().Yaw, 0.0f), It->GetActorLocation());
+		break;
+	}
+
+	ATCLocomotionBenchmark* Benchmark = World->SpawnActorDeferred<ATCLocomotionBenchmark>(
+		ATCLocomotionBenchmark::StaticClass(), SpawnTransform);
+	if (!Benchmark)
+	{
+		return nullptr;
+	}
+
+	// Step 2: Apply command line overrides
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("TCBenchBots="), Benchmark->NumBots);
+	FParse::Value(CommandLine, TEXT("TCBenchPhaseTime="), Benchmark->PhaseDuration);
+	Benchmark->bQuitWhenFinished = FParse::Param(CommandLine, TEXT("TCLocomotionBenchmark"));
+
+	if (NumBotsOverride > 0)
+	{
+		Benchmark->NumBots = NumBotsOverride;
+	}
+
+	FString BotClassPath;
+	if (FParse::Value(CommandLine, TEXT("TCBenchBotClass="), BotClassPath))
+	{
+		Benchmark->BotClass = LoadClass<ATCBaseCharacter>(nullptr, *BotClassPath);
+	}
+
+	// Fall back on the game mode's pawn, which has the mesh and anim BP the benchmark needs
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	if (!Benchmark->BotClass && GameMode && GameMode->DefaultPawnClass
+		&& GameMode->DefaultPawnClass->IsChildOf(ATCBaseCharacter::StaticClass()))
+	{
+		Benchmark->BotClass = *GameMode->DefaultPawnClass;
+	}
+
+	Benchmark->FinishSpawning(SpawnTransform);
+	return Benchmark;
+}
+
+void ATCLocomotionBenchmark::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!BotClass)
+	{
+		UE_LOG(LogHorizonsTC, Error, TEXT("Locomotion benchmark: no bot class. Pass -TCBenchBotClass=<path> or set the game mode's default pawn."));
+		Destroy();
+		return;
+	}
+
+	if (Phases.Num() == 0)
+	{
+		BuildDefaultPhases();
+	}
+
+	FTCCharacterPerfCollection::AddRef();
+	bCollectingPerf = true;
+
+	SpawnBots();
+	BeginPhase(0);
+
+	UE_LOG(LogHorizonsTC, Log, TEXT("Locomotion benchmark: %d bots, %d phases of %.1fs"), Bots.Num(), Phases.Num(), PhaseDuration);
+}
+
+void ATCLocomotionBenchmark::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bCollectingPerf)
+	{
+		FTCCharacterPerfCollection::Release();
+		bCollectingPerf = false;
+	}
+
+	if (UTCRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UTCRagdollSubsystem>())
+	{
+		RagdollSubsystem->SetBudgetEnabled(true);
+	}
+
+	for (const TWeakObjectPtr<ATCBaseCharacter>& Bot : Bots)
+	{
+		if (Bot.IsValid())
+		{
+			if (AController* Controller = Bot->GetController())
+			{
+				Controller->Destroy();
+			}
+			Bot->Destroy();
+		}
+	}
+	Bots.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ATCLocomotionBenchmark::BuildDefaultPhases()
+{
+	auto AddPhase = [this](const TCHAR* Name, EGait Gait, EStance Stance, ERotationMode RotationMode, float TurnRate)
+		-> FTCBenchmarkPhase&
+	{
+		FTCBenchmarkPhase& Phase = Phases.AddDefaulted_GetRef();
+		Phase.Name = FName(Name);
+		Phase.Gait = Gait;
+		Phase.Stance = Stance;
+		Phase.RotationMode = RotationMode;
+		Phase.TurnRate = TurnRate;
+		return Phase;
+	};
+
+	AddPhase(TEXT("WalkVelocity"), EGait::Walking, EStance::Standing, ERotationMode::VelocityDirection, 45.0f);
+	AddPhase(TEXT("RunVelocity"), EGait::Running, EStance::Standing, ERotationMode::VelocityDirection, 45.0f);
+	AddPhase(TEXT("RunLooking"), EGait::Running, EStance::Standing, ERotationMode::LookingDirection, 90.0f);
+	AddPhase(TEXT("SprintLooking"), EGait::Sprinting, EStance::Standing, ERotationMode::LookingDirection, 30.0f);
+	AddPhase(TEXT("AimStrafe"), EGait::Running, EStance::Standing, ERotationMode::Aiming, 90.0f);
+	AddPhase(TEXT("CrouchLooking"), EGait::Walking, EStance::Crouching, ERotationMode::LookingDirection, 45.0f);
+	AddPhase(TEXT("CrouchAim"), EGait::Walking, EStance::Crouching, ERotationMode::Aiming, 90.0f);
+	AddPhase(TEXT("Jump"), EGait::Running, EStance::Standing, ERotationMode::LookingDirection, 45.0f).JumpInterval = 1.5f;
+	AddPhase(TEXT("Mantle"), EGait::Running, EStance::Standing, ERotationMode::LookingDirection, 0.0f).MantleInterval = 0.5f;
+	AddPhase(TEXT("Ragdoll"), EGait::Running, EStance::Standing, ERotationMode::LookingDirection, 0.0f).bRagdoll = true;
+}
+
+void ATCLocomotionBenchmark::SpawnBots()
+{
+	UWorld* World = GetWorld();
+	check(World);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	// Lay the bots out in rows across the benchmark's forward axis, so they all have a clear run ahead
+	const int32 Columns = FMath::CeilToInt(FMath::Sqrt((float)NumBots));
+	const FTransform& Origin = GetActorTransform();
+
+	for (int32 i = 0; i < NumBots; ++i)
+	{
+		const FVector Offset(-(i / Columns) * BotSpacing, ((i % Columns) - (Columns - 1) * 0.5f) * BotSpacing, 0.0f);
+		const FTransform BotTransform(Origin.GetRotation(), Origin.TransformPosition(Offset));
+
+		ATCBaseCharacter* Bot = World->SpawnActor<ATCBaseCharacter>(BotClass, BotTransform, SpawnParams);
+		if (!Bot)
+		{
+			continue;
+		}
+
+		if (!Bot->GetController())
+		{
+			Bot->SpawnDefaultController();
+		}
+
+		// Bots are driven with AddMovementInput, which mantle checks only see through the fallback
+		Bot->SetMovementInputFallback(true);
+
+		// Nothing is ever rendered under -nullrhi, so the pose has to tick regardless of visibility
+		Bot->GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+
+		Bots.Add(Bot);
+		BotSpawnTransforms.Add(Bot->GetActorTransform());
+	}
+}
+
+void ATCLocomotionBenchmark::BeginPhase(int32 PhaseIndex)
+{
+	CurrentPhase = PhaseIndex;
+	PhaseTime = 0.0f;
+	ControlYaw = GetActorRotation().Yaw;
+	bMeasuring = false;
+
+	const FTCBenchmarkPhase& Phase = Phases[PhaseIndex];
+
+	// The ragdoll phase measures every bot simulating, so the ragdoll budget must not freeze any of them
+	if (UTCRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UTCRagdollSubsystem>())
+	{
+		RagdollSubsystem->SetBudgetEnabled(!Phase.bRagdoll);
+	}
+
+	for (int32 i = 0; i < Bots.Num(); ++i)
+	{
+		ATCBaseCharacter* Bot = Bots[i].Get();
+		if (!Bot)
+		{
+			continue;
+		}
+
+		Bot->SetActorLocationAndTargetRotation(BotSpawnTransforms[i].GetLocation(), BotSpawnTransforms[i].Rotator());
+
+		Bot->SetDesiredGait(Phase.Gait);
+		Bot->SetDesiredRotationMode(Phase.RotationMode);
+		Bot->SetRotationMode(Phase.RotationMode);
+		Bot->SetDesiredStance(Phase.Stance);
+
+		if (Phase.Stance == EStance::Crouching)
+		{
+			Bot->Crouch();
+		}
+		else
+		{
+			Bot->UnCrouch();
+		}
+
+		if (Phase.bRagdoll)
+		{
+			Bot->RagdollStart();
+		}
+	}
+}
+
+void ATCLocomotionBenchmark::EndPhase()
+{
+	CurrentResult.Name = Phases[CurrentPhase].Name;
+
+	for (const TWeakObjectPtr<ATCBaseCharacter>& Bot : Bots)
+	{
+		if (!Bot.IsValid())
+		{
+			continue;
+		}
+
+		CurrentResult.Totals.Accumulate(Bot->GetPerfCounters());
+
+		if (Bot->GetMovementState() == EMovementState::Ragdoll)
+		{
+			Bot->RagdollEnd();
+		}
+	}
+
+	Results.Add(CurrentResult);
+	CurrentResult = FPhaseResult();
+}
+
+void ATCLocomotionBenchmark::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!Phases.IsValidIndex(CurrentPhase))
+	{
+		return;
+	}
+
+	const FTCBenchmarkPhase& Phase = Phases[CurrentPhase];
+
+	// Step 1: Time the frame that just finished
+	const uint64 NowCycles = FPlatformTime::Cycles64();
+	if (bMeasuring)
+	{
+		CurrentResult.FrameMs += FPlatformTime::ToMilliseconds64(NowCycles - LastFrameCycles);
+		++CurrentResult.NumFrames;
+	}
+	LastFrameCycles = NowCycles;
+
+	// Step 2: Start measuring once the warmup is over, from a clean set of counters
+	PhaseTime += DeltaSeconds;
+	if (!bMeasuring && PhaseTime >= PhaseWarmup)
+	{
+		for (const TWeakObjectPtr<ATCBaseCharacter>& Bot : Bots)
+		{
+			if (Bot.IsValid())
+			{
+				Bot->GetPerfCounters().Reset();
+			}
+		}
+		bMeasuring = true;
+	}
+
+	// Step 3: Move on to the next phase, or finish
+	if (PhaseTime >= PhaseWarmup + PhaseDuration)
+	{
+		EndPhase();
+
+		if (Phases.IsValidIndex(CurrentPhase + 1))
+		{
+			BeginPhase(CurrentPhase + 1);
+		}
+		else
+		{
+			Finish();
+		}
+		return;
+	}
+
+	// Step 4: Feed every bot this frame's input
+	ControlYaw += Phase.TurnRate * DeltaSeconds;
+	for (int32 i = 0; i < Bots.Num(); ++i)
+	{
+		if (ATCBaseCharacter* Bot = Bots[i].Get())
+		{
+			DriveBot(Bot, i, Phase, DeltaSeconds);
+		}
+	}
+}
+
+void ATCLocomotionBenchmark::DriveBot(ATCBaseCharacter* Bot, int32 BotIndex, const FTCBenchmarkPhase& Phase, float DeltaSeconds)
+{
+	if (Phase.bRagdoll || Bot->GetMovementState() == EMovementState::Ragdoll)
+	{
+		return;
+	}
+
+	const FRotator ControlRotation(0.0f, ControlYaw, 0.0f);
+	if (AController* Controller = Bot->GetController())
+	{
+		Controller->SetControlRotation(ControlRotation);
+	}
+
+	Bot->AddMovementInput(ControlRotation.Vector(), 1.0f);
+
+	// Stagger the bots so presses don't all land on the same frame
+	const float BotTime = PhaseTime + BotIndex * 0.05f;
+	auto PressedThisFrame = [BotTime, DeltaSeconds](float Interval)
+	{
+		return Interval > 0.0f && FMath::FloorToInt(BotTime / Interval) != FMath::FloorToInt((BotTime - DeltaSeconds) / Interval);
+	};
+
+	if (Bot->GetMovementState() != EMovementState::Grounded || Bot->GetMovementAction() != EMovementAction::None)
+	{
+		return;
+	}
+
+	if (PressedThisFrame(Phase.MantleInterval))
+	{
+		// Same as the jump action: mantle if there's a ledge, otherwise jump so the falling checks run too
+		if (!Bot->MantleCheckGrounded())
+		{
+			Bot->Jump();
+		}
+	}
+	else if (PressedThisFrame(Phase.JumpInterval))
+	{
+		Bot->Jump();
+	}
+}
+
+void ATCLocomotionBenchmark::Finish()
+{
+	CurrentPhase = INDEX_NONE;
+
+	WriteResults();
+
+	if (bQuitWhenFinished)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+
+	Destroy();
+}
+
+void ATCLocomotionBenchmark::WriteResults() const
+{
+	// Header
+	FString Csv = TEXT("Phase,Bots,Frames,FrameMs,BotTicks");
+	for (int32 i = 0; i < FTCCharacterPerfCounters::NumPhases; ++i)
+	{
+		Csv += FString::Printf(TEXT(",%sMs"), FTCCharacterPerfCounters::GetPhaseName((FTCCharacterPerfCounters::EPhase)i));
+	}
+	for (int32 i = 0; i < FTCCharacterPerfCounters::NumQueries; ++i)
+	{
+		Csv += FString::Printf(TEXT(",%s"), FTCCharacterPerfCounters::GetQueryName((FTCCharacterPerfCounters::EQuery)i));
+	}
+	Csv += LINE_TERMINATOR;
+
+	// One row per phase. Timings and query counts are per frame, summed over all bots.
+	for (const FPhaseResult& Result : Results)
+	{
+		const double Frames = FMath::Max(Result.NumFrames, 1);
+
+		FString Row = FString::Printf(TEXT("%s,%d,%d,%.4f,%u"), *Result.Name.ToString(), Bots.Num(), Result.NumFrames,
+		                              Result.FrameMs / Frames, Result.Totals.NumTicks);
+		for (int32 i = 0; i < FTCCharacterPerfCounters::NumPhases; ++i)
+		{
+			Row += FString::Printf(TEXT(",%.4f"), Result.Totals.GetPhaseMs((FTCCharacterPerfCounters::EPhase)i) / Frames);
+		}
+		for (int32 i = 0; i < FTCCharacterPerfCounters::NumQueries; ++i)
+		{
+			Row += FString::Printf(TEXT(",%.2f"), Result.Totals.Queries[i] / Frames);
+		}
+
+		UE_LOG(LogHorizonsTC, Log, TEXT("Locomotion benchmark: %s"), *Row);
+		Csv += Row + LINE_TERMINATOR;
+	}
+
+	const FString FileName = FPaths::Combine(FPaths::ProfilingDir(), TEXT("TCBenchmark"),
+		FString::Printf(TEXT("Locomotion-%s.csv"), *FDateTime::Now().ToString()));
+
+	if (FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(LogHorizonsTC, Log, TEXT("Locomotion benchmark: wrote %s"), *FileName);
+	}
+	else
+	{
+		UE_LOG(LogHorizonsTC, Error, TEXT("Locomotion benchmark: failed to write %s"), *FileName);
+	}
+}
@@ -0,0 +1,52 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Game/TCMontageCacheSubsystem.h"
+
+#include "Animation/AnimMontage.h"
+#include "Animation/AnimSequenceBase.h"
+#include "TCMemory.h"
+#include "TCStats.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cached Montages"), STAT_TC_CachedMontages, STATGROUP_HorizonsTC_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Montage Cache Misses"), STAT_TC_MontageCacheMisses, STATGROUP_HorizonsTC_Anim);
+
+UAnimMontage* UTCMontageCacheSubsystem::FindOrCreateMontage(UAnimSequenceBase* Asset, FName SlotName, float BlendInTime,
+                                                            float BlendOutTime, int32 LoopCount, float BlendOutTriggerTime)
+{
+	if (!Asset)
+	{
+		return nullptr;
+	}
+
+	const FMontageKey Key{ Asset, SlotName, BlendInTime, BlendOutTime, LoopCount, BlendOutTriggerTime };
+	if (UAnimMontage** Found = MontageLookup.Find(Key))
+	{
+		return *Found;
+	}
+
+	TC_LLM_SCOPE(Animation);
+	INC_DWORD_STAT(STAT_TC_MontageCacheMisses);
+
+	// Play rate and start time only matter when the montage is played, so they're left at their defaults here
+	UAnimMontage* Montage = UAnimMontage::CreateSlotAnimationAsDynamicMontage(Asset, SlotName, BlendInTime, BlendOutTime,
+	                                                                          1.0f, LoopCount, BlendOutTriggerTime);
+	if (Montage)
+	{
+		MontageLookup.Add(Key, Montage);
+		Montages.Add(Montage);
+		INC_DWORD_STAT(STAT_TC_CachedMontages);
+	}
+
+	return Montage;
+}
+
+void UTCMontageCacheSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_TC_CachedMontages, Montages.Num());
+
+	MontageLookup.Empty();
+	Montages.Empty();
+
+	Super::Deinitialize();
+}
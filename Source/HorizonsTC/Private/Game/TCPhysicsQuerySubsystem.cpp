@@ -0,0 +1,322 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Game/TCPhysicsQuerySubsystem.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TCLog.h"
+#include "TCStats.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Queries"), STAT_TC_AsyncQueries, STATGROUP_HorizonsTC_Physics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reused Queries"), STAT_TC_ReusedQueries, STATGROUP_HorizonsTC_Physics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Throttled Queries"), STAT_TC_ThrottledQueries, STATGROUP_HorizonsTC_Physics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Over Budget Queries"), STAT_TC_OverBudgetQueries, STATGROUP_HorizonsTC_Physics);
+
+static TAutoConsoleVariable<int32> CVarQueryMaxLowPerFrame(
+	TEXT("tc.PhysicsQuery.MaxLowPerFrame"),
+	48,
+	TEXT("Low priority queries (foot IK, land prediction) only run while fewer than this many queries have been issued this frame. -1 for no cap."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarQueryMaxHighPerFrame(
+	TEXT("tc.PhysicsQuery.MaxHighPerFrame"),
+	96,
+	TEXT("High priority queries (periodic mantle checks) only run while fewer than this many queries have been issued this frame. -1 for no cap."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarQueryReuseTolerance(
+	TEXT("tc.PhysicsQuery.ReuseTolerance"),
+	1.0f,
+	TEXT("A query whose start and end are within this distance of a query from the same owner earlier in the frame reuses its result."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarQueryStaleReuseTolerance(
+	TEXT("tc.PhysicsQuery.StaleReuseTolerance"),
+	5.0f,
+	TEXT("A throttled query only reuses a result from an earlier frame if its start and end are within this distance of it."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarQueryMaxStaleFrames(
+	TEXT("tc.PhysicsQuery.MaxStaleFrames"),
+	4,
+	TEXT("How many frames old a result may be and still answer a throttled query from a source that allows it."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld CmdDumpQueryCounters(
+	TEXT("tc.PhysicsQuery.Dump"),
+	TEXT("Logs the physics query counters for each source, for the last frame and since the world started."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UTCPhysicsQuerySubsystem* Queries = World ? World->GetSubsystem<UTCPhysicsQuerySubsystem>() : nullptr)
+		{
+			Queries->DumpCounters();
+		}
+	}));
+
+namespace
+{
+	struct FSourcePolicy
+	{
+		ETCQueryPriority Priority;
+
+		// Throttled queries may be answered with a result from a recent frame. Only for sources that tolerate it.
+		bool bAllowStale;
+	};
+
+	// Indexed by ETCQuerySource
+	const FSourcePolicy SourcePolicies[] =
+	{
+		{ ETCQueryPriority::Low, true },       // FootIK
+		{ ETCQueryPriority::Low, true },       // LandPrediction
+		{ ETCQueryPriority::Critical, false }, // Mantle
+		{ ETCQueryPriority::Critical, false }, // Camera
+		{ ETCQueryPriority::Critical, false }, // Ragdoll
+		{ ETCQueryPriority::Critical, false }  // WeaponAim
+	};
+
+	static_assert(UE_ARRAY_COUNT(SourcePolicies) == (int32)ETCQuerySource::Count, "Missing query source policy");
+
+	void IncSourceStat(ETCQuerySource Source)
+	{
+		switch (Source)
+		{
+		case ETCQuerySource::FootIK: INC_DWORD_STAT(STAT_TC_FootIKQueries); break;
+		case ETCQuerySource::LandPrediction: INC_DWORD_STAT(STAT_TC_LandPredictionQueries); break;
+		case ETCQuerySource::Mantle: INC_DWORD_STAT(STAT_TC_MantleQueries); break;
+		case ETCQuerySource::Camera: INC_DWORD_STAT(STAT_TC_CameraQueries); break;
+		case ETCQuerySource::Ragdoll: INC_DWORD_STAT(STAT_TC_RagdollQueries); break;
+		case ETCQuerySource::WeaponAim: INC_DWORD_STAT(STAT_TC_WeaponAimQueries); break;
+		default: break;
+		}
+	}
+}
+
+bool UTCPhysicsQuerySubsystem::Query(const FTCQueryRequest& Request, FHitResult& OutHit)
+{
+	UpdateFrame();
+
+	const int32 SourceIndex = (int32)Request.Source;
+	const FCacheKey Key{ Request.Owner, Request.Slot, Request.Source };
+	FCachedResult* Cached = Cache.Find(Key);
+
+	// Step 1: The same owner already ran this query this frame. Hand back that result.
+	if (Request.bAllowReuse && Cached && Cached->Frame == CurrentFrame)
+	{
+		if (Cached->Matches(Request, CVarQueryReuseTolerance.GetValueOnGameThread()))
+		{
+			++FrameCounters[SourceIndex].Reused;
+			++TotalCounters[SourceIndex].Reused;
+			INC_DWORD_STAT(STAT_TC_ReusedQueries);
+
+			OutHit = Cached->Hit;
+			return Cached->bHit;
+		}
+	}
+
+	// Step 2: Over budget. Fall back on a recent result if the source allows it, otherwise report no hit.
+	if (!HasBudget(ResolvePriority(Request)))
+	{
+		++FrameCounters[SourceIndex].Throttled;
+		++TotalCounters[SourceIndex].Throttled;
+		INC_DWORD_STAT(STAT_TC_ThrottledQueries);
+
+		if (Request.bAllowReuse && Cached && SourcePolicies[SourceIndex].bAllowStale
+			&& CurrentFrame - Cached->Frame <= (uint64)FMath::Max(CVarQueryMaxStaleFrames.GetValueOnGameThread(), 0)
+			&& Cached->Matches(Request, CVarQueryStaleReuseTolerance.GetValueOnGameThread()))
+		{
+			++FrameCounters[SourceIndex].Reused;
+			++TotalCounters[SourceIndex].Reused;
+			INC_DWORD_STAT(STAT_TC_ReusedQueries);
+
+			OutHit = Cached->Hit;
+			return Cached->bHit;
+		}
+
+		OutHit = FHitResult(Request.Start, Request.End);
+		return false;
+	}
+
+	// Step 3: Run the query and remember the result for the rest of this frame and the next few
+	CountIssued(Request);
+
+	const bool bHit = RunQuery(Request, OutHit);
+
+	FCachedResult& Entry = Cached ? *Cached : Cache.Add(Key);
+	Entry.Start = Request.Start;
+	Entry.End = Request.End;
+	Entry.Rotation = Request.Rotation;
+	Entry.Shape = Request.Shape;
+	Entry.ProfileName = Request.ProfileName;
+	Entry.Channel = Request.Channel;
+	Entry.Hit = OutHit;
+	Entry.bHit = bHit;
+	Entry.Frame = CurrentFrame;
+
+	return bHit;
+}
+
+FTraceHandle UTCPhysicsQuerySubsystem::QueryAsync(const FTCQueryRequest& Request)
+{
+	UpdateFrame();
+
+	const int32 SourceIndex = (int32)Request.Source;
+
+	if (!HasBudget(ResolvePriority(Request)))
+	{
+		++FrameCounters[SourceIndex].Throttled;
+		++TotalCounters[SourceIndex].Throttled;
+		INC_DWORD_STAT(STAT_TC_ThrottledQueries);
+		return FTraceHandle();
+	}
+
+	CountIssued(Request);
+	++FrameCounters[SourceIndex].Async;
+	++TotalCounters[SourceIndex].Async;
+	INC_DWORD_STAT(STAT_TC_AsyncQueries);
+
+	UWorld* World = GetWorld();
+	check(World);
+
+	if (Request.Shape.IsLine())
+	{
+		return Request.ProfileName != NAME_None
+			? World->AsyncLineTraceByProfile(EAsyncTraceType::Single, Request.Start, Request.End, Request.ProfileName, Request.Params)
+			: World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Request.Start, Request.End, Request.Channel, Request.Params);
+	}
+
+	return Request.ProfileName != NAME_None
+		? World->AsyncSweepByProfile(EAsyncTraceType::Single, Request.Start, Request.End, Request.Rotation,
+		                             Request.ProfileName, Request.Shape, Request.Params)
+		: World->AsyncSweepByChannel(EAsyncTraceType::Single, Request.Start, Request.End, Request.Rotation,
+		                             Request.Channel, Request.Shape, Request.Params);
+}
+
+bool UTCPhysicsQuerySubsystem::FCachedResult::Matches(const FTCQueryRequest& Request, float Tolerance) const
+{
+	return Shape.ShapeType == Request.Shape.ShapeType && Shape.GetExtent() == Request.Shape.GetExtent() &&
+		ProfileName == Request.ProfileName && (ProfileName != NAME_None || Channel == Request.Channel) &&
+		Rotation.Equals(Request.Rotation) && Start.Equals(Request.Start, Tolerance) && End.Equals(Request.End, Tolerance);
+}
+
+void UTCPhysicsQuerySubsystem::CountIssued(const FTCQueryRequest& Request)
+{
+	const int32 SourceIndex = (int32)Request.Source;
+
+	// Critical queries are never refused, so record how far they push the frame past the highest cap
+	if (ResolvePriority(Request) == ETCQueryPriority::Critical && !HasBudget(ETCQueryPriority::High))
+	{
+		++FrameCounters[SourceIndex].OverBudget;
+		++TotalCounters[SourceIndex].OverBudget;
+		++NumOverBudgetThisFrame;
+		INC_DWORD_STAT(STAT_TC_OverBudgetQueries);
+	}
+
+	++FrameCounters[SourceIndex].Issued;
+	++TotalCounters[SourceIndex].Issued;
+	++NumIssuedThisFrame;
+	IncSourceStat(Request.Source);
+}
+
+void UTCPhysicsQuerySubsystem::UpdateFrame()
+{
+	check(IsInGameThread());
+
+	if (GFrameCounter == CurrentFrame)
+	{
+		return;
+	}
+
+	CSV_CUSTOM_STAT(HorizonsTC, PhysicsQueries, NumIssuedThisFrame, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(HorizonsTC, PhysicsQueriesOverBudget, NumOverBudgetThisFrame, ECsvCustomStatOp::Set);
+
+	for (int32 i = 0; i < (int32)ETCQuerySource::Count; ++i)
+	{
+		LastFrameCounters[i] = FrameCounters[i];
+		FrameCounters[i].Reset();
+	}
+
+	NumIssuedThisFrame = 0;
+	NumOverBudgetThisFrame = 0;
+	CurrentFrame = GFrameCounter;
+
+	// Drop results too old to be reused, so owners that went away don't leave entries behind
+	if (CurrentFrame % 120 == 0)
+	{
+		const uint64 MaxAge = (uint64)FMath::Max(CVarQueryMaxStaleFrames.GetValueOnGameThread(), 0);
+		for (auto It = Cache.CreateIterator(); It; ++It)
+		{
+			if (CurrentFrame - It.Value().Frame > MaxAge)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+}
+
+ETCQueryPriority UTCPhysicsQuerySubsystem::ResolvePriority(const FTCQueryRequest& Request) const
+{
+	return Request.Priority != ETCQueryPriority::Default ? Request.Priority : SourcePolicies[(int32)Request.Source].Priority;
+}
+
+bool UTCPhysicsQuerySubsystem::HasBudget(ETCQueryPriority Priority) const
+{
+	int32 Cap = -1;
+	if (Priority == ETCQueryPriority::Low)
+	{
+		Cap = CVarQueryMaxLowPerFrame.GetValueOnGameThread();
+	}
+	else if (Priority == ETCQueryPriority::High)
+	{
+		Cap = CVarQueryMaxHighPerFrame.GetValueOnGameThread();
+	}
+
+	return Cap < 0 || NumIssuedThisFrame < Cap;
+}
+
+bool UTCPhysicsQuerySubsystem::RunQuery(const FTCQueryRequest& Request, FHitResult& OutHit) const
+{
+	const UWorld* World = GetWorld();
+	check(World);
+
+	if (Request.Shape.IsLine())
+	{
+		return Request.ProfileName != NAME_None
+			? World->LineTraceSingleByProfile(OutHit, Request.Start, Request.End, Request.ProfileName, Request.Params)
+			: World->LineTraceSingleByChannel(OutHit, Request.Start, Request.End, Request.Channel, Request.Params);
+	}
+
+	return Request.ProfileName != NAME_None
+		? World->SweepSingleByProfile(OutHit, Request.Start, Request.End, Request.Rotation, Request.ProfileName,
+		                              Request.Shape, Request.Params)
+		: World->SweepSingleByChannel(OutHit, Request.Start, Request.End, Request.Rotation, Request.Channel,
+		                              Request.Shape, Request.Params);
+}
+
+const TCHAR* UTCPhysicsQuerySubsystem::GetSourceName(ETCQuerySource Source)
+{
+	switch (Source)
+	{
+	case ETCQuerySource::FootIK: return TEXT("FootIK");
+	case ETCQuerySource::LandPrediction: return TEXT("LandPrediction");
+	case ETCQuerySource::Mantle: return TEXT("Mantle");
+	case ETCQuerySource::Camera: return TEXT("Camera");
+	case ETCQuerySource::Ragdoll: return TEXT("Ragdoll");
+	case ETCQuerySource::WeaponAim: return TEXT("WeaponAim");
+	default: return TEXT("Unknown");
+	}
+}
+
+void UTCPhysicsQuerySubsystem::DumpCounters() const
+{
+	UE_LOG(LogHorizonsTC, Log, TEXT("Physics queries (last frame | total): issued, async, reused, throttled, over budget"));
+
+	for (int32 i = 0; i < (int32)ETCQuerySource::Count; ++i)
+	{
+		const FTCQuerySourceCounters& Last = LastFrameCounters[i];
+		const FTCQuerySourceCounters& Total = TotalCounters[i];
+		UE_LOG(LogHorizonsTC, Log, TEXT("  %-16s %4u %4u %4u %4u %4u | %8u %8u %8u %8u %8u"), GetSourceName((ETCQuerySource)i),
+		       Last.Issued, Last.Async, Last.Reused, Last.Throttled, Last.OverBudget,
+		       Total.Issued, Total.Async, Total.Reused, Total.Throttled, Total.OverBudget);
+	}
+}
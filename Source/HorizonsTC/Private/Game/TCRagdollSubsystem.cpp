@@ -0,0 +1,216 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "Game/TCRagdollSubsystem.h"
+
+#include "Character/TCBaseCharacter.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "TCStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ragdoll Budget"), STAT_TC_RagdollBudget, STATGROUP_HorizonsTC_Character);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ragdolls"), STAT_TC_NumRagdolls, STATGROUP_HorizonsTC_Character);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Simulating Ragdolls"), STAT_TC_NumSimulatingRagdolls, STATGROUP_HorizonsTC_Character);
+
+static TAutoConsoleVariable<int32> CVarRagdollMaxSimulating(
+	TEXT("tc.Ragdoll.MaxSimulating"),
+	8,
+	TEXT("Maximum number of ragdolls simulating physics at once. The ragdolls furthest from a player camera are frozen first."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarRagdollFreezeDistance(
+	TEXT("tc.Ragdoll.FreezeDistance"),
+	4000.0f,
+	TEXT("Ragdolls further than this from every player camera are frozen."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarRagdollRestSpeed(
+	TEXT("tc.Ragdoll.RestSpeed"),
+	10.0f,
+	TEXT("Speed below which a ragdoll counts as at rest."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRagdollSettleTime(
+	TEXT("tc.Ragdoll.SettleTime"),
+	2.0f,
+	TEXT("Seconds a ragdoll has to stay at rest before it is frozen for good."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarRagdollSettleEvaluations(
+	TEXT("tc.Ragdoll.SettleEvaluations"),
+	3,
+	TEXT("Consecutive budget evaluations a ragdoll has to be found settled on before it is frozen, so one long frame\n")
+	TEXT("cannot freeze it."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRagdollMinSimulateTime(
+	TEXT("tc.Ragdoll.MinSimulateTime"),
+	1.5f,
+	TEXT("Seconds a new ragdoll always simulates for before it can be frozen for distance, rest or budget."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarRagdollRestTraceInterval(
+	TEXT("tc.Ragdoll.RestTraceInterval"),
+	8,
+	TEXT("Frames between ground traces for a ragdoll at rest."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRagdollBudgetInterval(
+	TEXT("tc.Ragdoll.BudgetInterval"),
+	0.1f,
+	TEXT("Seconds between re-evaluations of the ragdoll budget."),
+	ECVF_Default);
+
+void UTCRagdollSubsystem::RegisterRagdoll(ATCBaseCharacter* Character)
+{
+	check(Character);
+
+	UWorld* World = GetWorld();
+	check(World);
+
+	FRagdollEntry* Entry = Ragdolls.FindByPredicate([Character](const FRagdollEntry& Ragdoll)
+	{
+		return Ragdoll.Character == Character;
+	});
+	if (!Entry)
+	{
+		Entry = &Ragdolls.AddDefaulted_GetRef();
+		Entry->Character = Character;
+	}
+
+	Entry->StartTime = World->GetTimeSeconds();
+	Entry->SettledEvaluations = 0;
+
+	// Re-evaluate straight away so older ragdolls make room for the new one
+	TimeSinceBudgetUpdate = CVarRagdollBudgetInterval.GetValueOnGameThread();
+}
+
+void UTCRagdollSubsystem::UnregisterRagdoll(ATCBaseCharacter* Character)
+{
+	Ragdolls.RemoveAll([Character](const FRagdollEntry& Ragdoll) { return Ragdoll.Character == Character; });
+}
+
+void UTCRagdollSubsystem::SetBudgetEnabled(bool bEnabled)
+{
+	bBudgetEnabled = bEnabled;
+	TimeSinceBudgetUpdate = CVarRagdollBudgetInterval.GetValueOnGameThread();
+}
+
+bool UTCRagdollSubsystem::IsRagdollAtRest(const FVector& Velocity)
+{
+	return Velocity.SizeSquared() < FMath::Square(CVarRagdollRestSpeed.GetValueOnGameThread());
+}
+
+int32 UTCRagdollSubsystem::GetRestTraceInterval()
+{
+	return FMath::Max(1, CVarRagdollRestTraceInterval.GetValueOnGameThread());
+}
+
+void UTCRagdollSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceBudgetUpdate += DeltaTime;
+	if (TimeSinceBudgetUpdate >= CVarRagdollBudgetInterval.GetValueOnGameThread())
+	{
+		TimeSinceBudgetUpdate = 0.0f;
+		UpdateBudget();
+	}
+}
+
+bool UTCRagdollSubsystem::IsTickable() const
+{
+	return !IsTemplate() && Ragdolls.Num() > 0;
+}
+
+TStatId UTCRagdollSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTCRagdollSubsystem, STATGROUP_Tickables);
+}
+
+void UTCRagdollSubsystem::UpdateBudget()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TC_RagdollBudget);
+
+	UWorld* World = GetWorld();
+	check(World);
+
+	Ragdolls.RemoveAll([](const FRagdollEntry& Ragdoll) { return !Ragdoll.Character.IsValid(); });
+
+	// Step 1: Collect the views the ragdolls are judged against.
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+		if (PC && PC->PlayerCameraManager)
+		{
+			ViewLocations.Add(PC->PlayerCameraManager->GetCameraLocation());
+		}
+	}
+
+	// Step 2: Freeze settled and distant ragdolls, and rank the rest by distance to the closest view.
+	// Ragdolls still within their minimum simulation time are left alone and take budget first.
+	const float FreezeDistSq = FMath::Square(CVarRagdollFreezeDistance.GetValueOnGameThread());
+	const float SettleTime = CVarRagdollSettleTime.GetValueOnGameThread();
+	const int32 SettleEvaluations = FMath::Max(1, CVarRagdollSettleEvaluations.GetValueOnGameThread());
+	const float MinSimulateTime = CVarRagdollMinSimulateTime.GetValueOnGameThread();
+	const float Now = World->GetTimeSeconds();
+
+	TArray<TPair<float, ATCBaseCharacter*>> Candidates;
+	Candidates.Reserve(Ragdolls.Num());
+	NumSimulating = 0;
+
+	for (FRagdollEntry& Ragdoll : Ragdolls)
+	{
+		ATCBaseCharacter* Character = Ragdoll.Character.Get();
+
+		if (!bBudgetEnabled || Now - Ragdoll.StartTime < MinSimulateTime)
+		{
+			Character->UnfreezeRagdoll();
+			++NumSimulating;
+			continue;
+		}
+
+		Ragdoll.SettledEvaluations = Character->GetRagdollRestTime() >= SettleTime ? Ragdoll.SettledEvaluations + 1 : 0;
+
+		float ClosestDistSq = ViewLocations.Num() > 0 ? TNumericLimits<float>::Max() : 0.0f;
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			ClosestDistSq = FMath::Min(ClosestDistSq, FVector::DistSquared(ViewLocation, Character->GetActorLocation()));
+		}
+
+		if (Ragdoll.SettledEvaluations >= SettleEvaluations || ClosestDistSq > FreezeDistSq)
+		{
+			Character->FreezeRagdoll();
+		}
+		else
+		{
+			Candidates.Emplace(ClosestDistSq, Character);
+		}
+	}
+
+	// Step 3: Only the closest ragdolls within budget simulate. Ragdolls frozen for budget wake up when room frees up.
+	Candidates.Sort([](const TPair<float, ATCBaseCharacter*>& A, const TPair<float, ATCBaseCharacter*>& B)
+	{
+		return A.Key < B.Key;
+	});
+
+	const int32 MaxSimulating = FMath::Max(0, CVarRagdollMaxSimulating.GetValueOnGameThread());
+
+	for (const TPair<float, ATCBaseCharacter*>& Candidate : Candidates)
+	{
+		if (NumSimulating < MaxSimulating)
+		{
+			Candidate.Value->UnfreezeRagdoll();
+			++NumSimulating;
+		}
+		else
+		{
+			Candidate.Value->FreezeRagdoll();
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TC_NumRagdolls, Ragdolls.Num());
+	SET_DWORD_STAT(STAT_TC_NumSimulatingRagdolls, NumSimulating);
+	CSV_CUSTOM_STAT(HorizonsTC, SimulatingRagdolls, NumSimulating, ECsvCustomStatOp::Set);
+}
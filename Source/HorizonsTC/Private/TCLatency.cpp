@@ -0,0 +1,254 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+
+#include "TCLatency.h"
+
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderingThread.h"
+#include "TCLog.h"
+#include "TCStats.h"
+
+#define TC_DECLARE_LATENCY_STATS(Path, Label) \
+	DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT(Label " p50 (ms)"), STAT_TC_Latency_##Path##_P50, STATGROUP_HorizonsTC_Latency); \
+	DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT(Label " p95 (ms)"), STAT_TC_Latency_##Path##_P95, STATGROUP_HorizonsTC_Latency); \
+	DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT(Label " p99 (ms)"), STAT_TC_Latency_##Path##_P99, STATGROUP_HorizonsTC_Latency);
+
+TC_DECLARE_LATENCY_STATS(FireToShot, "Fire To Shot")
+TC_DECLARE_LATENCY_STATS(ShotToProjectile, "Shot To Projectile")
+TC_DECLARE_LATENCY_STATS(FireToProjectile, "Fire To Projectile")
+TC_DECLARE_LATENCY_STATS(LookToView, "Look To View")
+TC_DECLARE_LATENCY_STATS(LookToRender, "Look To Render")
+
+// Percentile stats and the CSV sample for one path
+#define TC_RECORD_LATENCY(Path, Histogram, Ms) \
+	SET_FLOAT_STAT(STAT_TC_Latency_##Path##_P50, (Histogram).GetPercentileMs(50.0f)); \
+	SET_FLOAT_STAT(STAT_TC_Latency_##Path##_P95, (Histogram).GetPercentileMs(95.0f)); \
+	SET_FLOAT_STAT(STAT_TC_Latency_##Path##_P99, (Histogram).GetPercentileMs(99.0f)); \
+	CSV_CUSTOM_STAT(HorizonsTC, Latency_##Path, (float)(Ms), ECsvCustomStatOp::Max);
+
+static TAutoConsoleVariable<int32> CVarLatencyEnable(
+	TEXT("tc.Latency.Enable"),
+	1,
+	TEXT("Time the local player's fire and look inputs to their results (stat HorizonsTC_Latency, tc.Latency.Dump)."),
+	ECVF_Default);
+
+static FAutoConsoleCommand CmdLatencyDump(
+	TEXT("tc.Latency.Dump"),
+	TEXT("Logs input latency percentiles per path and writes the histograms to Saved/Profiling/TCLatency."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FTCLatencyTracker::Get().Dump();
+		FTCLatencyTracker::Get().WriteCsv();
+	}));
+
+static FAutoConsoleCommand CmdLatencyReset(
+	TEXT("tc.Latency.Reset"),
+	TEXT("Clears the input latency histograms."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FTCLatencyTracker::Get().Reset();
+	}));
+
+double FTCLatencyHistogram::GetBucketUpperMs(int32 Bucket)
+{
+	return 0.05 * FMath::Pow(1.15, (double)Bucket);
+}
+
+void FTCLatencyHistogram::Add(double Ms)
+{
+	Ms = FMath::Max(Ms, 0.0);
+
+	// Invert the bucket edges to find the first bucket that ends at or past this sample
+	const int32 Bucket = Ms <= GetBucketUpperMs(0) ? 0 : FMath::CeilToInt(FMath::Loge(Ms / 0.05) / FMath::Loge(1.15));
+	Buckets[FMath::Min(Bucket, NumBuckets - 1)]++;
+
+	NumSamples++;
+	TotalMs += Ms;
+	MaxMs = FMath::Max(MaxMs, Ms);
+}
+
+double FTCLatencyHistogram::GetPercentileMs(float Percentile) const
+{
+	if (NumSamples == 0)
+	{
+		return 0.0;
+	}
+
+	const uint32 Target = FMath::Max(1u, (uint32)FMath::CeilToInt(NumSamples * Percentile / 100.0f));
+	uint32 Count = 0;
+
+	for (int32 i = 0; i < NumBuckets - 1; ++i)
+	{
+		Count += Buckets[i];
+		if (Count >= Target)
+		{
+			return FMath::Min(GetBucketUpperMs(i), MaxMs);
+		}
+	}
+
+	return MaxMs;
+}
+
+FTCLatencyTracker& FTCLatencyTracker::Get()
+{
+	static FTCLatencyTracker Tracker;
+	return Tracker;
+}
+
+bool FTCLatencyTracker::IsEnabled()
+{
+	return CVarLatencyEnable.GetValueOnGameThread() != 0;
+}
+
+const TCHAR* FTCLatencyTracker::GetPathName(ETCLatencyPath Path)
+{
+	switch (Path)
+	{
+	case ETCLatencyPath::FireToShot:		return TEXT("FireToShot");
+	case ETCLatencyPath::ShotToProjectile:	return TEXT("ShotToProjectile");
+	case ETCLatencyPath::FireToProjectile:	return TEXT("FireToProjectile");
+	case ETCLatencyPath::LookToView:		return TEXT("LookToView");
+	case ETCLatencyPath::LookToRender:		return TEXT("LookToRender");
+	default:								return TEXT("Unknown");
+	}
+}
+
+void FTCLatencyTracker::MarkFireInput()
+{
+	// A press that never produced a shot (e.g. released during a refire delay) is replaced, not measured
+	if (IsEnabled())
+	{
+		PendingFireInput = FPlatformTime::Seconds();
+	}
+}
+
+double FTCLatencyTracker::MarkShotFired(double ShotTime)
+{
+	// Only the first shot answers the press. Automatic fire after it is paced by the weapon, not by input.
+	const double FireInputTime = PendingFireInput;
+	if (FireInputTime > 0.0)
+	{
+		AddSample(ETCLatencyPath::FireToShot, (ShotTime - FireInputTime) * 1000.0);
+		PendingFireInput = 0.0;
+	}
+
+	return FireInputTime;
+}
+
+void FTCLatencyTracker::MarkProjectileMoved(double ShotTime, double FireInputTime)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	AddSample(ETCLatencyPath::ShotToProjectile, (Now - ShotTime) * 1000.0);
+
+	if (FireInputTime > 0.0)
+	{
+		AddSample(ETCLatencyPath::FireToProjectile, (Now - FireInputTime) * 1000.0);
+	}
+}
+
+void FTCLatencyTracker::MarkLookInput()
+{
+	if (IsEnabled() && PendingLookInput == 0.0)
+	{
+		PendingLookInput = FPlatformTime::Seconds();
+	}
+}
+
+void FTCLatencyTracker::MarkViewUpdated()
+{
+	const double LookInputTime = PendingLookInput;
+	if (LookInputTime == 0.0)
+	{
+		return;
+	}
+
+	PendingLookInput = 0.0;
+	AddSample(ETCLatencyPath::LookToView, (FPlatformTime::Seconds() - LookInputTime) * 1000.0);
+
+	// The render thread picks the command up when it starts on the frame holding this view.
+	// Its sample is handed back to the game thread, which owns the histograms.
+	ENQUEUE_RENDER_COMMAND(TCLatencyLookToRender)([LookInputTime](FRHICommandListImmediate& RHICmdList)
+	{
+		const double Ms = (FPlatformTime::Seconds() - LookInputTime) * 1000.0;
+		AsyncTask(ENamedThreads::GameThread, [Ms]()
+		{
+			FTCLatencyTracker::Get().AddSample(ETCLatencyPath::LookToRender, Ms);
+		});
+	});
+}
+
+void FTCLatencyTracker::AddSample(ETCLatencyPath Path, double Ms)
+{
+	FTCLatencyHistogram& Histogram = Histograms[(int32)Path];
+	Histogram.Add(Ms);
+
+	switch (Path)
+	{
+	case ETCLatencyPath::FireToShot:		TC_RECORD_LATENCY(FireToShot, Histogram, Ms); break;
+	case ETCLatencyPath::ShotToProjectile:	TC_RECORD_LATENCY(ShotToProjectile, Histogram, Ms); break;
+	case ETCLatencyPath::FireToProjectile:	TC_RECORD_LATENCY(FireToProjectile, Histogram, Ms); break;
+	case ETCLatencyPath::LookToView:		TC_RECORD_LATENCY(LookToView, Histogram, Ms); break;
+	case ETCLatencyPath::LookToRender:		TC_RECORD_LATENCY(LookToRender, Histogram, Ms); break;
+	default: break;
+	}
+}
+
+void FTCLatencyTracker::Reset()
+{
+	for (FTCLatencyHistogram& Histogram : Histograms)
+	{
+		Histogram.Reset();
+	}
+
+	PendingFireInput = PendingLookInput = 0.0;
+}
+
+void FTCLatencyTracker::Dump() const
+{
+	UE_LOG(LogHorizonsTC, Log, TEXT("Input latency (ms): samples, avg, p50, p95, p99, max"));
+
+	for (int32 i = 0; i < (int32)ETCLatencyPath::Count; ++i)
+	{
+		const FTCLatencyHistogram& Histogram = Histograms[i];
+		UE_LOG(LogHorizonsTC, Log, TEXT("  %-18s %8u %8.2f %8.2f %8.2f %8.2f %8.2f"), GetPathName((ETCLatencyPath)i),
+		       Histogram.NumSamples, Histogram.GetAverageMs(), Histogram.GetPercentileMs(50.0f),
+		       Histogram.GetPercentileMs(95.0f), Histogram.GetPercentileMs(99.0f), Histogram.MaxMs);
+	}
+}
+
+bool FTCLatencyTracker::WriteCsv() const
+{
+	// One row per bucket, one column of sample counts per path
+	FString Csv = TEXT("BucketUpperMs");
+	for (int32 i = 0; i < (int32)ETCLatencyPath::Count; ++i)
+	{
+		Csv += FString::Printf(TEXT(",%s"), GetPathName((ETCLatencyPath)i));
+	}
+	Csv += LINE_TERMINATOR;
+
+	for (int32 Bucket = 0; Bucket < FTCLatencyHistogram::NumBuckets; ++Bucket)
+	{
+		Csv += FString::Printf(TEXT("%.4f"), FTCLatencyHistogram::GetBucketUpperMs(Bucket));
+		for (const FTCLatencyHistogram& Histogram : Histograms)
+		{
+			Csv += FString::Printf(TEXT(",%u"), Histogram.Buckets[Bucket]);
+		}
+		Csv += LINE_TERMINATOR;
+	}
+
+	const FString FileName = FPaths::Combine(FPaths::ProfilingDir(), TEXT("TCLatency"),
+		FString::Printf(TEXT("Latency-%s.csv"), *FDateTime::Now().ToString()));
+
+	if (FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(LogHorizonsTC, Log, TEXT("Input latency: wrote %s"), *FileName);
+		return true;
+	}
+
+	UE_LOG(LogHorizonsTC, Error, TEXT("Input latency: failed to write %s"), *FileName);
+	return false;
+}
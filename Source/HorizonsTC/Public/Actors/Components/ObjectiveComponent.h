@@ -60,6 +60,12 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Quests")
 		int32 GetCurrentQuest() const;
 
+	/**
+	 * Quest changes are made on the server, by server-side gameplay. On clients BeginQuest, ProgressQuest and
+	 * FinishQuest do nothing and return false. ProgressObjective and ProgressOptionalObjective send the progress
+	 * to the server, which checks it against the quest's current objective, and return true once it's sent.
+	 * Local state follows when the quest records replicate.
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Quests")
 		bool BeginQuest(int32 QuestID, bool MakeActive);
 
@@ -84,14 +90,37 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Quests")
 		bool FinishQuest(int32 QuestID, bool Completed);
 
+	/**
+	 * Clients: rebuilds a quest's tracked progress from its replicated record. QuestManager is the manager the
+	 * record belongs to, which the owning controller may not have resolved yet.
+	 */
+	void ApplyQuestRecord(class AQuestManager* QuestManager, int32 QuestID, int32 Progress);
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	/**
+	 * Server: progress the owning client made on an objective. Ignored unless the quest is active for this
+	 * player, ObjectiveID is the objective the server is tracking and the progress doesn't pass its goal.
+	 */
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerProgressObjective(int32 QuestID, int32 ObjectiveID, int32 ProgressIncrease);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerProgressOptionalObjective(int32 QuestID, int32 ObjectiveID, int32 ProgressIncrease);
+
 private:
-	bool UpdateObjectiveProgress(int32 QuestID);
+	/** The owning controller's quest manager. Null on clients until it has replicated. */
+	class AQuestManager* GetQuestManager() const;
+
+	bool UpdateObjectiveProgress(class AQuestManager* QuestManager, int32 QuestID);
+
+	bool UpdateOptionalObjectiveProgress(class AQuestManager* QuestManager, int32 QuestID);
 
-	bool UpdateOptionalObjectiveProgress(int32 QuestID);
+	/** Server: whether a client's progress fits the tracked objective (see ServerProgressObjective) */
+	bool IsValidClientProgress(const TMap<int32, FObjectiveProgress>& Tracked, int32 QuestID, int32 ObjectiveID,
+	                           int32 ProgressIncrease) const;
 
 	int32 tempobj;
 
@@ -0,0 +1,134 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "LedgeAnnotations.generated.h"
+
+class UPrimitiveComponent;
+
+/**
+ * A straight run of mantleable ledge. The endpoints lie on the walkable top surface,
+ * inset from the wall edge by the same distance the runtime downward trace uses.
+ */
+USTRUCT(BlueprintType)
+struct FMantleLedge
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		FVector Start = FVector::ZeroVector;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		FVector End = FVector::ZeroVector;
+
+	// Horizontal wall normal, pointing away from the wall
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		FVector Normal = FVector::ForwardVector;
+
+	// Height of the top surface above the floor in front of the wall
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		float Height = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+};
+
+/**
+ * Per-level store of mantle ledges baked from climbable geometry. Place one in each level and run
+ * Bake Ledges after editing its geometry. The mantle check queries the baked ledges before tracing,
+ * and only skips the traces where an exhaustive annotation covers the character's reach.
+ */
+UCLASS()
+class HORIZONSTC_API ALedgeAnnotations : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ALedgeAnnotations();
+
+	/** Scans the static climbable geometry of this actor's level and rebuilds the ledge list */
+	UFUNCTION(CallInEditor, BlueprintCallable, Category = "Ledges")
+		void BakeLedges();
+
+	/**
+	 * Finds the closest ledge point in front of the character across all annotations in the world.
+	 * @param CapsuleBase	Base of the character's capsule
+	 * @param Direction		Normalized horizontal direction the character wants to mantle in
+	 * @param Reach			Maximum horizontal distance from the capsule base to the ledge point
+	 * @param Radius		Maximum sideways distance of the ledge point from the line along Direction
+	 * @return False if no baked ledge is within reach, or if the world has no baked data at all.
+	 */
+	static bool FindLedge(const UWorld* World, const FVector& CapsuleBase, const FVector& Direction, float Reach,
+	                      float Radius, float MinHeight, float MaxHeight, FMantleLedge& OutLedge, FVector& OutPoint);
+
+	/**
+	 * Whether any annotations with baked data are active in the world.
+	 * @param Location			Where the ledge will be looked for, usually the character's capsule base
+	 * @param Reach				Horizontal distance from Location the ledge may be at
+	 * @param bOutExhaustive	Set if an annotation claiming to cover all climbable geometry of its level has baked
+	 *							bounds containing the whole reach, so there is nothing left for a trace to find
+	 */
+	static bool HasLedgeData(const UWorld* World, const FVector& Location, float Reach, bool& bOutExhaustive);
+
+	/**
+	 * Set when every climbable in this level is static and baked, so the mantle check may skip its traces within
+	 * BakedBounds. Leave unset if the level has movable or spawned climbables, or they will never be mantled.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ledges")
+		bool bBakedDataIsExhaustive = false;
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void PostLoad() override;
+
+	void BuildGrid();
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	/** Samples along the top edge of one vertical face of a component's bounds */
+	void BakeFace(UPrimitiveComponent* Component, const FVector& EdgeStart, const FVector& EdgeEnd, const FVector& FaceNormal);
+
+	bool FindLedgeLocal(const FVector& CapsuleBase, const FVector& Direction, float Reach, float Radius, float MinHeight,
+	                    float MaxHeight, FMantleLedge& OutLedge, FVector& OutPoint, float& InOutBestDist) const;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ledges")
+		TArray<FMantleLedge> Ledges;
+
+	// Bounds of the colliding geometry in this level when it was last baked. Outside them the data is never exhaustive.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ledges")
+		FBox BakedBounds = FBox(ForceInit);
+
+	// Size of the grid cells ledges are bucketed into for lookup
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ledges|Bake")
+		float CellSize = 250.0f;
+
+	// Spacing between samples along an edge
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ledges|Bake")
+		float SampleSpacing = 25.0f;
+
+	// Ledges lower or higher than this above the floor are not baked
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ledges|Bake")
+		float MinBakeHeight = 50.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ledges|Bake")
+		float MaxBakeHeight = 250.0f;
+
+	// Minimum Z of a top surface normal to count as walkable
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ledges|Bake")
+		float WalkableNormalZ = 0.71f;
+
+	// Adjacent samples further apart than this vertically start a new ledge
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ledges|Bake")
+		float MaxStepBetweenSamples = 5.0f;
+
+private:
+	// Ledge indices by grid cell. Rebuilt from Ledges on load rather than serialized.
+	TMap<FIntPoint, TArray<int32>> Grid;
+
+	static TArray<TWeakObjectPtr<ALedgeAnnotations>> ActiveAnnotations;
+};
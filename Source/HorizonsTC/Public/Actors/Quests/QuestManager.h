@@ -5,8 +5,91 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Actors/Quests/MasterQuest.h"
+#include "Engine/NetSerialization.h"
 #include "QuestManager.generated.h"
 
+class AQuestManager;
+class ATCPlayerController;
+struct FTCQuestRecordArray;
+
+UENUM()
+enum class ETCQuestState : uint8
+{
+	Active,
+	Completed,
+	Failed
+};
+
+/**
+ * A quest's state as replicated to its owner. Everything static (titles, goals) comes from the quest class on
+ * the client, so only what changes during play is sent.
+ */
+USTRUCT()
+struct FTCQuestRecord : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		int32 QuestID = UTCStatics::DEFAULT_QUEST_ID;
+
+	UPROPERTY()
+		ETCQuestState State = ETCQuestState::Active;
+
+	/** The current objective, or the one the quest failed on */
+	UPROPERTY()
+		uint8 CurrentObjective = 0;
+
+	/** Progress towards the current objective's ProgressGoal */
+	UPROPERTY()
+		uint16 Progress = 0;
+
+	void PreReplicatedRemove(const FTCQuestRecordArray& InArraySerializer);
+	void PostReplicatedAdd(const FTCQuestRecordArray& InArraySerializer);
+	void PostReplicatedChange(const FTCQuestRecordArray& InArraySerializer);
+};
+
+/** Every quest a player has touched, delta replicated: an update only carries the records that changed */
+USTRUCT()
+struct FTCQuestRecordArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		TArray<FTCQuestRecord> Items;
+
+	/** Receives the client callbacks. Not replicated. */
+	AQuestManager* Owner = nullptr;
+
+	FTCQuestRecord* Find(int32 QuestID);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FTCQuestRecordArray> : public TStructOpsTypeTraitsBase2<FTCQuestRecordArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
+
+/** Running totals for quest replication. "tc.Quests.DumpNetStats" prints them with bytes per update. */
+struct HORIZONSTC_API FTCQuestNetCounters
+{
+	uint64 RecordsDirtied = 0;
+	uint64 UpdatesSent = 0;
+	uint64 BitsSent = 0;
+
+	static FTCQuestNetCounters& Get();
+
+	void Dump() const;
+};
+
+/**
+ * Owns one player's quests. Quest state is changed on the server only and replicated to the owning client
+ * as compact records; the client rebuilds its quest actors and objective progress from them.
+ */
 UCLASS()
 class HORIZONSTC_API AQuestManager : public AActor
 {
@@ -53,4 +136,35 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Quests)
 		bool FailQuest(int32 QuestID);
 
+	/** Server: records progress on a quest's current objective so the owning client can show it */
+	void SetObjectiveProgress(int32 QuestID, int32 Progress);
+
+	/** Clients: applies a replicated record to the local quest containers and objective progress */
+	void OnQuestRecordReplicated(const FTCQuestRecord& Record);
+
+	/**
+	 * Server: drops every trace of a quest, as if it had never begun, and destroys its actor if it's active.
+	 * For debug tools that create and discard quests (see UTCCheatManager), not for gameplay.
+	 */
+	void ForgetQuest(int32 QuestID);
+
+	/** Clients: a forgotten quest's record was removed */
+	void OnQuestRecordRemoved(const FTCQuestRecord& Record);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+private:
+	ATCPlayerController* GetOwningController() const;
+
+	/** Server: rebuilds a quest's record from the quest containers, marking it dirty if it changed */
+	void UpdateQuestRecord(int32 QuestID);
+
+	/** Spawns the actor holding a quest's data and adds it to ActiveQuests */
+	AMasterQuest* SpawnQuest(int32 QuestID);
+
+	/** Removes a quest from the quest containers, destroying its actor if it's active */
+	void RemoveQuest(int32 QuestID);
+
+	UPROPERTY(Replicated)
+		FTCQuestRecordArray QuestRecords;
 };
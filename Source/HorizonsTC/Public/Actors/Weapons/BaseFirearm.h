@@ -8,6 +8,7 @@
 #include "Engine/DataTable.h"
 
 #include "TCStatics.h"
+#include "Actors/Weapons/TCShotEvents.h"
 #include "BaseFirearm.generated.h"
 
 
@@ -49,6 +50,15 @@ enum class EAmmoType : uint8
 	Energy
 };
 
+/** Damage zone of a character body. See UTCHitZoneSubsystem. */
+UENUM(BlueprintType)
+enum class EHitZone : uint8
+{
+	Torso,
+	Head,
+	Limb
+};
+
 USTRUCT(BlueprintType)
 struct FInventoryWeapon
 {
@@ -82,6 +92,15 @@ struct FInventoryWeapon
 	/** The socket the weapon is occupying while unequipped (can be NONE). */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weapon")
 		FName AttachedSocket;
+
+	bool operator==(const FInventoryWeapon& Other) const
+	{
+		return WeaponID == Other.WeaponID && CurrMagAmmo == Other.CurrMagAmmo && CurrReserveAmmo == Other.CurrReserveAmmo
+			&& CurrFireMode == Other.CurrFireMode && CurrWeaponState == Other.CurrWeaponState
+			&& AttachedSocket == Other.AttachedSocket;
+	}
+
+	bool operator!=(const FInventoryWeapon& Other) const { return !(*this == Other); }
 };
 
 USTRUCT(BlueprintType)
@@ -121,11 +140,33 @@ struct FFirearmDamageInfo
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage")
 		float HeadshotDamageMultiplier;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage")
+		float TorsoDamageMultiplier = 1.0f;
+
+	/** Multiplier for hits on arms, hands, legs and feet */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage")
+		float LimbDamageMultiplier = 1.0f;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage")
 		float ProjSpeed;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Damage")
 		bool bCanRicochet;
+
+	float GetZoneMultiplier(EHitZone Zone) const
+	{
+		switch (Zone)
+		{
+		case EHitZone::Head:
+			return HeadshotDamageMultiplier;
+
+		case EHitZone::Limb:
+			return LimbDamageMultiplier;
+
+		default:
+			return TorsoDamageMultiplier;
+		}
+	}
 };
 
 USTRUCT(BlueprintType)
@@ -136,6 +177,7 @@ struct FWeaponData : public FTableRowBase
 	FWeaponData()
 	{
 		WeaponType = EWeaponType::Rifle;
+		HolsterMesh = nullptr;
 		WeaponDamage = FFirearmDamageInfo();
 		RecoilStats = FRecoilInfo();
 	}
@@ -152,6 +194,13 @@ struct FWeaponData : public FTableRowBase
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "WeaponData")
 		USkeletalMesh* WeaponMesh;
 
+	/** 
+	 * Static stand-in shown in the holster socket while the weapon isn't equipped.
+	 * Only used when the owning weapon component spawns weapons lazily.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "WeaponData")
+		class UStaticMesh* HolsterMesh;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "WeaponData")
 		TSubclassOf<class ABaseProjectile> ProjectileClass;
 
@@ -366,6 +415,7 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
 		void SetStoredWeapon(const FInventoryWeapon& NewStored);
 
+	/** Returns the weapon's inventory entry, updated with its current ammo and fire mode. */
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Weapon")
 		FInventoryWeapon GetStoredWeapon() const;
 
@@ -390,11 +440,15 @@ private:
 
 	void OnBurstFinished();
 
-	FTransform CalculateMainProjectileDirection(FName& BoneName);
+	/** Traces where the shot is aimed and which zone it's aimed at */
+	FVector CalculateAimPoint(EHitZone& HitZone);
+
+	FTransform CalculateFinalProjectileDirection(const FTransform& MainDir, const float Spread, FRandomStream& Stream);
 
-	FTransform CalculateFinalProjectileDirection(const FTransform& MainDir, const float Spread);
+	/** Rolls the shot's damage for the zone it's aimed at. Returns true on a critical (head) hit. */
+	bool CalculateDamage(EHitZone HitZone, float& DamageOut, FRandomStream& Stream);
 
-	bool CalculateDamage(const FName& BoneName, float& DamageOut);
+	FVector GetProjectileSpawnLocation() const;
 
 	/** Contains PREDETERMINED information/statistics about the weapon. */
 	FWeaponData WeaponData;
@@ -424,6 +478,73 @@ private:
 
 	ABaseProjectile* ProjectileRef;
 
+	/************************************************************************/
+	/* Networking                                                           */
+	/************************************************************************/
+
+public:
+	/**
+	 * Plays a shot that was fired on another machine. Authoritative shots (the server firing a client's validated
+	 * shot) use ammo and deal damage. Cosmetic ones (other clients) only show the muzzle FX and a harmless projectile.
+	 * ShotTime is the server time the shot was fired at on the shooter's machine.
+	 */
+	void ReplayShot(const FTCShotEvent& Shot, float ShotTime, bool bAuthoritative);
+
+	/** Minimum time between two shots at the weapon's rate of fire */
+	float GetTimeBetweenShots() const { return TimeBetweenShots; }
+
+	/** Seed of the stream this weapon's spread, damage and recoil are rolled from */
+	int32 GetStreamSeed() const { return StreamSeed; }
+
+	/**
+	 * Restarts the weapon's random stream from NewSeed, e.g. so a replay or benchmark fires identical shots.
+	 * FirstShotIndex continues an existing stream instead, e.g. one the server picked for the weapon's slot.
+	 */
+	void SetStreamSeed(int32 NewSeed, uint16 FirstShotIndex = 0);
+
+	/** Restarts the weapon's random stream from a seed picked by tc.Weapons.RandomSeed */
+	void ResetStreamSeed();
+
+	/** A seed for a weapon's stream as tc.Weapons.RandomSeed picks it */
+	static int32 PickStreamSeed(FName WeaponID);
+
+	/**
+	 * Index the next shot fired from this weapon takes. On the server, the index the owning client's next shot
+	 * must carry (see UWeaponComponent::ServerFireShots).
+	 */
+	uint16 GetNextShotIndex() const { return NextShotIndex; }
+
+	/**
+	 * Server side: moves reserve ammo into an empty clip without playing the reload.
+	 * Reloads aren't replicated, so this stands in for the one the client played. Returns true if the clip has ammo.
+	 */
+	bool RefillClip();
+
+private:
+	/** Rolls the shot's spread from ShotStream, which starts at the shot's seed. Returns the projectile's spawn transform. */
+	FTransform CalculateShotDirection(const FTCShotEvent& Shot, FRandomStream& ShotStream);
+
+	/** Spawns the projectile for a shot along FinalDir. Damage is rolled from ShotStream, after the spread. */
+	void SpawnShotProjectile(const FTCShotEvent& Shot, const FTransform& FinalDir, EHitZone HitZone, bool bAuthoritative, FRandomStream& ShotStream);
+
+	/**
+	 * Server side: finds the zone a client's shot hits by tracing from our muzzle along the shot's direction.
+	 * In networked games characters are tested where they were at ShotTime (see UTCLagCompensationSubsystem):
+	 * bOutRewound is set and OutRewoundHit holds the rewound hit, with no actor if the shot missed every character.
+	 */
+	EHitZone TraceShotHitZone(const FTransform& ShotDir, const FVector& AimPoint, float ShotTime, bool& bOutRewound, FHitResult& OutRewoundHit);
+
+	FTimerHandle TimerHandle_StopReplayFX;
+
+	/**
+	 * Picked once per weapon (see tc.Weapons.RandomSeed), or by the server per inventory slot in networked games
+	 * (see UWeaponComponent). Shot N's rolls come from (StreamSeed, N).
+	 */
+	int32 StreamSeed = 0;
+
+	/** Index the next locally fired shot takes in the stream. Wraps after 65536 shots. */
+	uint16 NextShotIndex = 0;
+
 	/************************************************************************/
 	/* Simulation & FX                                                      */
 	/************************************************************************/
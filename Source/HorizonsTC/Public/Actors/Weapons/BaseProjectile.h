@@ -21,6 +21,17 @@ public:
 	// Only to be called after SpawnActorDeferred()
 	void InitializeProjectileStats(float fDamage, bool bCritHit, float fSpeed, bool bRicochet);
 
+	// Cosmetic projectiles (client predictions, other players' shots) show impacts but never deal damage
+	void SetCosmeticOnly(bool bCosmetic);
+
+	// Server, lag compensated shots: the rewound trace decides which character the shot hits. Target (null if the
+	// rewind missed everyone) takes the damage once the projectile has flown Distance without hitting the world;
+	// characters the projectile itself touches never do.
+	void SetRewoundHit(AActor* Target, float Distance);
+
+	// Reports the projectile's first move to FTCLatencyTracker. Times are FPlatformTime::Seconds(), 0 if unknown.
+	void TrackFirstMove(double InShotTime, double InFireInputTime);
+
 	UFUNCTION()
 		void OnProjHit(class UPrimitiveComponent* HitComponent, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
@@ -40,6 +51,9 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Projectile|Stats")
 		bool Ricochet;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Projectile|Stats")
+		bool bCosmeticOnly = false;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Projectile")
 		UParticleSystem* CharacterImpactEffect;
 
@@ -55,4 +69,21 @@ private:
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Projectile", meta = (AllowPrivateAccess = "true"))
 		class UProjectileMovementComponent* Projectile;
+
+	void OnFirstMove(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	// Queues the damage for the rewound target, at most once
+	void ApplyRewoundHit();
+
+	bool bLagCompensated = false;
+
+	TWeakObjectPtr<AActor> RewoundTarget;
+
+	FTimerHandle TimerHandle_RewoundHit;
+
+	FDelegateHandle FirstMoveHandle;
+
+	double ShotTime = 0.0;
+
+	double FireInputTime = 0.0;
 };
@@ -0,0 +1,101 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "TCShotEvents.generated.h"
+
+/**
+ * One shot as sent over the network. Everything else (spread direction, damage, recoil) is rolled from the firing
+ * weapon's stream seed and the shot's index in it, so any machine can rebuild the shot exactly.
+ */
+USTRUCT()
+struct FTCShotEvent
+{
+	GENERATED_BODY()
+
+	/** Where the shooter's aim trace ended, quantized to 1cm */
+	UPROPERTY()
+		FVector_NetQuantize AimPoint = FVector::ZeroVector;
+
+	/** Milliseconds after the batch's base time */
+	UPROPERTY()
+		uint16 TimeOffsetMs = 0;
+
+	/** Position of the shot in the weapon's random stream */
+	UPROPERTY()
+		uint16 ShotIndex = 0;
+
+	/**
+	 * Firing spread the shooter had built up, in 255ths of the weapon's FiringSpreadMax. Every machine spreads the
+	 * shot by this rather than by its own CurrentFiringSpread, and it can't exceed the weapon's range.
+	 */
+	UPROPERTY()
+		uint8 FiringSpread = 0;
+
+	/** Seed of the firing weapon's stream. Sent once per batch, not per shot. */
+	int32 StreamSeed = 0;
+
+	/** Seed for this shot's rolls */
+	int32 GetSeed() const { return (int32)HashCombine((uint32)StreamSeed, (uint32)ShotIndex); }
+
+	void SetFiringSpread(float Spread, float MaxSpread)
+	{
+		FiringSpread = MaxSpread > 0.0f ? (uint8)FMath::Clamp(FMath::RoundToInt(Spread / MaxSpread * 255.0f), 0, 255) : 0;
+	}
+
+	float GetFiringSpread(float MaxSpread) const { return FiringSpread / 255.0f * MaxSpread; }
+};
+
+/** Shots fired by one weapon component during a frame, sent in a single RPC */
+USTRUCT()
+struct FTCShotBatch
+{
+	GENERATED_BODY()
+
+	/** Shots past this are sent in the next batch */
+	static constexpr int32 MaxShots = 16;
+
+	/** Server world time (as estimated by the shooter) of the first shot */
+	UPROPERTY()
+		float BaseTime = 0.0f;
+
+	UPROPERTY()
+		TArray<FTCShotEvent> Shots;
+
+	/** Stream seed shared by every shot in the batch */
+	int32 StreamSeed = 0;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FTCShotBatch> : public TStructOpsTypeTraitsBase2<FTCShotBatch>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/** Running totals for the networked shot path. "tc.Net.DumpShotStats" prints them with bytes per shot. */
+struct HORIZONSTC_API FTCShotNetCounters
+{
+	uint64 BatchesSent = 0;
+	uint64 ShotsSent = 0;
+	uint64 BitsSent = 0;
+
+	uint64 BatchesMulticast = 0;
+	uint64 ShotsMulticast = 0;
+	uint64 BitsMulticast = 0;
+
+	uint64 ShotsRejected = 0;
+
+	static FTCShotNetCounters& Get();
+
+	/** Measures the batch's serialized size and adds it to the client -> server or server -> clients totals */
+	void RecordBatch(FTCShotBatch& Batch, bool bMulticast);
+
+	void Dump() const;
+};
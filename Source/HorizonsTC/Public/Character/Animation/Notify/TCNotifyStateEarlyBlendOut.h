@@ -8,18 +8,35 @@
 
 #include "TCNotifyStateEarlyBlendOut.generated.h"
 
+class ATCBaseCharacter;
+
 /**
- * Character early blend out anim state
+ * Character early blend out anim state. Listens for the owning character's state changes while active
+ * instead of polling them every tick.
  */
 UCLASS()
 class HORIZONSTC_API UTCNotifyStateEarlyBlendOut : public UAnimNotifyState
 {
 	GENERATED_BODY()
 
-	void NotifyTick(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float FrameDeltaTime) override;
+	void NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float TotalDuration) override;
+
+	void NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation) override;
 
 	FString GetNotifyName_Implementation() const override;
 
+	bool ShouldBlendOut(ATCBaseCharacter* Character) const;
+
+	/** Whether the montage instance is playing inside this notify's window */
+	bool IsInWindow(const struct FAnimMontageInstance& Instance) const;
+
+	/**
+	 * Listens for one montage instance. The notify is owned by the montage asset and shared by every mesh (and
+	 * PIE world) playing it, so the listener is keyed by instance and kept on the character, never on the notify.
+	 */
+	void OnCharacterStateChanged(ATCBaseCharacter* Character, TWeakObjectPtr<USkeletalMeshComponent> MeshComp,
+	                             int32 MontageInstanceID);
+
 public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AnimNotify)
 	UAnimMontage* ThisMontage = nullptr;
@@ -186,6 +186,10 @@ private:
 
 	void TurnInPlace(FRotator TargetRotation, float PlayRateScale, float StartTime, bool OverrideCurrent);
 
+	/** Same as PlaySlotAnimationAsDynamicMontage, but plays a montage shared through the world's montage cache */
+	void PlaySlotAnimationCached(UAnimSequenceBase* Asset, FName SlotName, float BlendInTime, float BlendOutTime,
+	                             float PlayRate, float StartTime);
+
 	/** Movement */
 
 	FVector CalculateRelativeAccelerationAmount();
@@ -0,0 +1,113 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Library/TCCharacterEnumLibrary.h"
+#include "TCCharacterMovementComponent.generated.h"
+
+class ATCBaseCharacter;
+
+/**
+ * Character movement with ATCBaseCharacter's locomotion states folded into network prediction. The gait the
+ * character is allowed to move at, its rotation mode (which picks the movement settings) and jump jet presses
+ * travel with every move, so the server simulates the same speeds and launches the client predicted.
+ *
+ * Compressed flags: the rotation mode and allowed gait packed into FLAG_Custom_0-2 (aiming never sprints, which
+ * leaves exactly eight combinations), jump jets in FLAG_Custom_3.
+ */
+UCLASS()
+class HORIZONSTC_API UTCCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+	friend class FSavedMove_TC;
+
+public:
+	UTCCharacterMovementComponent(const FObjectInitializer& ObjectInitializer);
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	virtual void OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp,
+	                                        FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase,
+	                                        FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition,
+	                                        uint8 ServerMovementMode) override;
+
+	/** Fires the jump jets on the next move, if they're enabled and off cooldown by then */
+	void RequestJumpJets() { bWantsJumpJets = true; }
+
+	EGait GetPredictedGait() const { return PredictedGait; }
+
+	ERotationMode GetPredictedRotationMode() const { return PredictedRotationMode; }
+
+	/** Whether this is the server's copy of a character a client moves, so its locomotion state comes from moves */
+	bool IsDrivenByRemoteMoves() const;
+
+	/** Client corrections received since the world started */
+	int32 GetNumCorrections() const { return NumCorrections; }
+
+	static uint8 PackLocomotionFlags(ERotationMode RotationMode, EGait Gait);
+
+	static void UnpackLocomotionFlags(uint8 Flags, ERotationMode& OutRotationMode, EGait& OutGait);
+
+protected:
+	virtual void OnRegister() override;
+
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+
+	virtual bool ClientUpdatePositionAfterServerUpdate() override;
+
+private:
+	UPROPERTY(Transient)
+		ATCBaseCharacter* TCCharacterOwner;
+
+	EGait PredictedGait = EGait::Running;
+
+	ERotationMode PredictedRotationMode = ERotationMode::LookingDirection;
+
+	bool bWantsJumpJets = false;
+
+	int32 NumCorrections = 0;
+};
+
+/** One client move with the locomotion state it was made under */
+class HORIZONSTC_API FSavedMove_TC : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override;
+
+	virtual uint8 GetCompressedFlags() const override;
+
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel,
+	                        FNetworkPredictionData_Client_Character& ClientData) override;
+
+	virtual void PrepMoveFor(ACharacter* C) override;
+
+	EGait SavedGait = EGait::Running;
+
+	ERotationMode SavedRotationMode = ERotationMode::LookingDirection;
+
+	bool bSavedWantsJumpJets = false;
+
+	// Not sent. Restored when the move is replayed after a correction, so a replayed press fires the jets again.
+	bool bSavedJumpJetsOnCooldown = false;
+};
+
+class HORIZONSTC_API FNetworkPredictionData_Client_TC : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_TC(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {}
+
+	virtual FSavedMovePtr AllocateNewMove() override { return FSavedMovePtr(new FSavedMove_TC()); }
+};
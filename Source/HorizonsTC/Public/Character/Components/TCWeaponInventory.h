@@ -0,0 +1,65 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "Actors/Weapons/BaseFirearm.h"
+#include "TCWeaponInventory.generated.h"
+
+class UWeaponComponent;
+struct FTCWeaponInventory;
+
+/** One inventory slot as replicated: the weapon's saved state and whether it's in the character's hands */
+USTRUCT()
+struct FTCInventoryEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	/** Index into UWeaponComponent::WeaponInventory */
+	UPROPERTY()
+		uint8 Slot = 0;
+
+	UPROPERTY()
+		bool bEquipped = false;
+
+	/** Ammo, fire mode and holster socket. The weapon state is left Idle, it's driven by shots. */
+	UPROPERTY()
+		FInventoryWeapon Weapon;
+
+	void PreReplicatedRemove(const FTCWeaponInventory& InArraySerializer);
+	void PostReplicatedAdd(const FTCWeaponInventory& InArraySerializer);
+	void PostReplicatedChange(const FTCWeaponInventory& InArraySerializer);
+};
+
+/**
+ * A weapon component's inventory, delta replicated: only entries marked dirty since the last update are sent,
+ * so bandwidth follows what changed (a shot's ammo, an equip) rather than how many weapons are carried.
+ */
+USTRUCT()
+struct FTCWeaponInventory : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		TArray<FTCInventoryEntry> Items;
+
+	/** Receives the client callbacks. Not replicated. */
+	UWeaponComponent* Owner = nullptr;
+
+	FTCInventoryEntry* FindSlot(int32 Slot);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FTCInventoryEntry, FTCWeaponInventory>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FTCWeaponInventory> : public TStructOpsTypeTraitsBase2<FTCWeaponInventory>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "Actors/Weapons/BaseFirearm.h"
+#include "Character/Components/TCWeaponInventory.h"
 #include "WeaponComponent.generated.h"
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
@@ -108,9 +109,22 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "WeaponComp|Getters")
 		int32 GetCurrentWeaponIndex() const;
 
+	/**
+	 * Queues a shot fired on this machine. Clients send their shots to the server for validation and the server
+	 * sends the shots it fires to the other clients as cosmetic events, in one batch per frame.
+	 */
+	void RecordShot(const FTCShotEvent& Shot);
+
+	/** Clients: applies a replicated inventory entry. Other players' characters draw and holster to match. */
+	void OnInventoryEntryReplicated(const FTCInventoryEntry& Entry);
+
+	void OnInventoryEntryRemoved(const FTCInventoryEntry& Entry);
+
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
@@ -124,6 +138,54 @@ protected:
 	 */
 	void SwitchWeapon(int32 WeaponIndex, bool Equip = true);
 
+	/** Looks up a weapon's row in WeaponsData */
+	FWeaponData* FindWeaponData(FName WeaponID) const;
+
+	/** Spawns the firearm actor for an inventory entry. The weapon is left unattached. */
+	ABaseFirearm* SpawnFirearm(const FInventoryWeapon& Stored, const FWeaponData& Data);
+
+	/** Creates the static stand-in for a lazily holstered weapon (null if the weapon has no HolsterMesh) */
+	class UStaticMeshComponent* CreateHolsterMesh(FName Socket, const FWeaponData& Data);
+
+	/** Spawns the firearm for a lazily holstered weapon from its stored state and hides its holster mesh */
+	ABaseFirearm* MaterializeWeapon(int32 WeaponIndex);
+
+	/** Saves a lazily spawned weapon's state, destroys its actor and optionally shows its holster mesh again */
+	void ReleaseWeapon(int32 WeaponIndex, bool ReturnToHolster);
+
+	void SetHolsterMeshVisible(int32 WeaponIndex, bool bVisible);
+
+	/** Server: validates a client's shots and fires the ones that pass */
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerFireShots(const FTCShotBatch& Batch);
+
+	/** Other clients: plays shots the server fired */
+	UFUNCTION(NetMulticast, Unreliable)
+		void MulticastShotsFired(const FTCShotBatch& Batch);
+
+	/** Sends the shots recorded this frame */
+	void FlushShots();
+
+	/** Weapon that shots arriving over the network are fired from. Firing implies the weapon is out. */
+	ABaseFirearm* GetShotWeapon();
+
+	/** Server world time shots are stamped with */
+	float GetShotTime() const;
+
+	/** Server: copies a slot's current state into the replicated inventory, marking it dirty if it changed */
+	void UpdateReplicatedSlot(int32 WeaponIndex);
+
+	/** Sent by the owning client when it draws or holsters a weapon, so the server and other clients follow */
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerSetEquippedWeapon(int32 WeaponIndex, bool bEquipped, bool bReturnToHolster);
+
+	/** Owning client: the server's shot stream seeds arrived, so our firearms roll what the server will */
+	UFUNCTION()
+		void OnRep_ShotStreamSeeds();
+
+	/** Networked games: gives a firearm its slot's server-picked stream, continuing from the slot's next shot index */
+	void RestoreShotStream(int32 WeaponIndex);
+
 public:
 	/** Weapons the character starts with. */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = WeaponComp)
@@ -133,9 +195,14 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = WeaponComp)
 		int32 MaxWeapons;
 
+	/** Spawned firearms. Holstered entries are null when weapons are spawned lazily. */
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = WeaponComp)
 		TArray<ABaseFirearm*> WeaponInventory;
 
+	/** Saved state of every weapon, indexed like WeaponInventory. Authoritative while a weapon has no actor. */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = WeaponComp)
+		TArray<FInventoryWeapon> StoredInventory;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "WeaponComp|Combat")
 		float AccuracyMultiplier;
 
@@ -153,6 +220,14 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = WeaponComp)
 		bool bSpawnWeapons;
 
+	/**
+	 * Only spawn a firearm actor for the equipped weapon. Holstered weapons are shown with their HolsterMesh
+	 * and keep their ammo and fire mode in StoredInventory until drawn. Cuts actor count and skeletal mesh
+	 * ticking for characters carrying several weapons.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = WeaponComp)
+		bool bLazyHolsteredWeapons;
+
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = WeaponComp)
 		class UDataTable* WeaponsData = nullptr;
 
@@ -169,5 +244,29 @@ private:
 	UPROPERTY(BlueprintReadOnly, Category = WeaponComp, meta = (AllowPrivateAccess = "true"))
 		ABaseFirearm* CurrentWeapon;
 
+	/** Holster stand-ins, indexed like WeaponInventory (null where the weapon has none) */
+	UPROPERTY(Transient)
+		TArray<class UStaticMeshComponent*> HolsterMeshes;
+
+	/** Server's view of every slot, delta replicated to clients */
+	UPROPERTY(Replicated)
+		FTCWeaponInventory ReplicatedInventory;
+
 	class ATCCharacter* OwningCharacter;
+
+	/** Shots recorded this frame, not sent yet */
+	FTCShotBatch PendingShots;
+
+	/** Server: time of the last client shot that passed validation */
+	float LastValidatedShotTime;
+
+	/**
+	 * Seed of each slot's shot stream, indexed like StoredInventory. Picked by the server, which ignores any seed
+	 * a client sends, and replicated to the owner only.
+	 */
+	UPROPERTY(ReplicatedUsing = OnRep_ShotStreamSeeds)
+		TArray<int32> ShotStreamSeeds;
+
+	/** Each slot's next shot index while a lazily holstered weapon has no actor */
+	TArray<uint16> NextShotIndices;
 };
@@ -9,6 +9,9 @@
 #include "Engine/DataTable.h"
 #include "GameFramework/Character.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Misc/Optional.h"
+#include "WorldCollision.h"
+#include "Character/TCCharacterPerf.h"
 
 #include "Character/TCPlayerController.h"
 
@@ -18,7 +21,12 @@ class UTimelineComponent;
 class UAnimInstance;
 class UAnimMontage;
 class UTCCharacterAnimInstance;
+class UTCCharacterMovementComponent;
 class USoundCue;
+class ATCBaseCharacter;
+
+/** Native-only, so listeners pay nothing per frame and nothing when the character has no listeners */
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCharacterStateChanged, ATCBaseCharacter*);
 
 /*
  * Base character class featuring advanced locomotion.
@@ -28,13 +36,19 @@ class HORIZONSTC_API ATCBaseCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	// Drive and replay the predicted locomotion state
+	friend class UTCCharacterMovementComponent;
+	friend class FSavedMove_TC;
+
 public:
-	ATCBaseCharacter();
+	ATCBaseCharacter(const FObjectInitializer& ObjectInitializer);
 
 	virtual void Tick(float DeltaTime) override;
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void PreInitializeComponents() override;
 
 	virtual void Restart() override;
@@ -59,7 +73,21 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Ragdoll System")
 		void RagdollOnDeath(bool Retrigger = true);
 
+	/** Stops simulating the ragdoll and holds its current pose. Driven by the ragdoll budget. */
+	void FreezeRagdoll();
+
+	/** Resumes simulating a frozen ragdoll from the pose it was frozen in */
+	void UnfreezeRagdoll();
+
+	bool IsRagdollFrozen() const { return bRagdollFrozen; }
+
+	/** Seconds the ragdoll has been continuously at rest */
+	float GetRagdollRestTime() const { return RagdollRestTime; }
+
 private:
+	/** OnCharacterStateChanged listeners by montage instance (see AddMontageStateListener) */
+	TMap<int32, FDelegateHandle> MontageStateListeners;
+
 	void DisablePhysicsSim();
 
 	bool bSprintDisabled = false;
@@ -70,6 +98,19 @@ private:
 	/************************************************************************/
 
 public:
+	/** Fires after the movement state, stance, rotation mode or whether there is movement input changes */
+	FOnCharacterStateChanged OnCharacterStateChanged;
+
+	/**
+	 * Keeps an OnCharacterStateChanged listener for one montage instance (e.g. an early blend out window),
+	 * replacing any the instance already had. Notifies are shared by every mesh playing their montage, so
+	 * listeners live here rather than on the notify.
+	 */
+	void AddMontageStateListener(int32 MontageInstanceID, FDelegateHandle Handle);
+
+	/** Removes the listener a montage instance added, if it has one */
+	void RemoveMontageStateListener(int32 MontageInstanceID);
+
 	UFUNCTION(BlueprintCallable, Category = "Character States")
 		void SetMovementState(EMovementState NewState);
 
@@ -156,9 +197,14 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Input")
 		FVector GetPlayerMovementInput();
 
+	/** Lets GetPlayerMovementInput fall back to AI movement input or velocity. Set on locomotion benchmark bots. */
+	void SetMovementInputFallback(bool bEnable) { bMovementInputFallback = bEnable; }
+
 	UFUNCTION(BlueprintImplementableEvent, BlueprintCallable, Category = "Input")
 		void JumpJets();
 
+	bool CanJumpJet() const { return bJumpJetsEnabled && !bJumpJetsOnCooldown; }
+
 
 	/************************************************************************/
 	/* Rotation System														*/
@@ -208,6 +254,8 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Movement System")
 		bool CanPlayerJump();
 
+	UTCCharacterMovementComponent* GetTCCharacterMovement() const;
+
 	/** BP implementable function that called when Breakfall starts */
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "Movement System")
 		void OnBreakfall();
@@ -247,6 +295,9 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Utility")
 		ATCPlayerController* GetPlayerController() const;
 
+	/** Locomotion timings and query counts for this character, collected while tc.Perf.CharacterCounters is set */
+	FTCCharacterPerfCounters& GetPerfCounters() { return PerfCounters; }
+
 
 	/************************************************************************/
 	/* Camera																*/
@@ -395,7 +446,9 @@ protected:
 
 	void UpdateCharacterMovement();
 
-	void UpdateDynamicMovementSettings(EGait AllowedGait);
+	void UpdateDynamicMovementSettings(EGait AllowedGait, ERotationMode ForRotationMode);
+
+	FMovementSettings GetMovementSettings(ERotationMode ForRotationMode) const;
 
 	void UpdateGroundedRotation(float DeltaTime);
 
@@ -408,6 +461,22 @@ protected:
 	virtual bool MantleCheck(const FMantleTraceSettings& TraceSettings,
 	                         EDrawDebugTrace::Type DebugType = EDrawDebugTrace::Type::ForOneFrame);
 
+	/** Steps 2-5 of the mantle check, continuing from the result of the forward trace */
+	bool MantleCheckFromWallHit(const FMantleTraceSettings& TraceSettings, const FHitResult& WallHit,
+	                            const FVector& CapsuleBaseLocation, EDrawDebugTrace::Type DebugType);
+
+	/** Steps 3-5 of the mantle check: room check, mantle type and start, given a point on the ledge's top surface */
+	bool MantleFromLedge(const FVector& DownTraceLocation, const FVector& InitialTraceNormal,
+	                     UPrimitiveComponent* HitComponent, EDrawDebugTrace::Type DebugType);
+
+	/** Builds the forward capsule sweep used by step 1 of the mantle check */
+	FCollisionShape GetMantleForwardTrace(const FMantleTraceSettings& TraceSettings, FVector& OutStart, FVector& OutEnd);
+
+	/** Mantle check performed every tick while falling. Consults the mantle query cache before tracing. */
+	void UpdateFallingMantleCheck();
+
+	void ResetMantleQueryCache();
+
 	UFUNCTION()
 	virtual void MantleUpdate(float BlendIn);
 	
@@ -530,6 +599,9 @@ protected:
 	UPROPERTY(Category = "Input", BlueprintReadWrite)
 		bool bJumpJetsOnCooldown = false;
 
+	// See SetMovementInputFallback
+	bool bMovementInputFallback = false;
+
 
 	/** Camera System */
 
@@ -569,6 +641,22 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mantle System")
 	UCurveFloat* MantleTimelineCurve;
 
+	// Distance the character must cover before a failed falling mantle check is retried
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mantle System")
+	float MantleRetestDistance = 15.0f;
+
+	// A failed falling mantle check is also retried once the input direction turns further than this (dot product)
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mantle System", meta = (ClampMin = "-1.0", ClampMax = "1.0"))
+	float MantleRetestInputDot = 0.97f;
+
+	// Falling mantle checks run once every N frames, staggered between characters. 1 checks every frame.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mantle System", meta = (ClampMin = "1"))
+	int32 FallingMantleCheckInterval = 1;
+
+	// Issue the falling forward trace asynchronously and finish the check on the frame its result arrives
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mantle System")
+	bool bAsyncFallingMantleTrace = false;
+
 	/** Components */
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Components")
@@ -667,6 +755,12 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Category = "Ragdoll System")
 	FVector LastRagdollVelocity;
 
+	UPROPERTY(BlueprintReadOnly, Category = "Ragdoll System")
+	bool bRagdollFrozen = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Ragdoll System")
+	float RagdollRestTime = 0.0f;
+
 	/** Cached Variables */
 
 	FVector PreviousVelocity;
@@ -683,4 +777,19 @@ protected:
 
 	/* Timer to manage reset of braking friction factor after on landed event */
 	FTimerHandle OnLandedFrictionResetTimer;
+
+	/** Mantle query cache. Where and in which direction the last falling mantle check failed. */
+	FVector LastFailedMantleLocation = FVector::ZeroVector;
+
+	FVector LastFailedMantleInput = FVector::ZeroVector;
+
+	bool bHasFailedMantleCheck = false;
+
+	/** Forward trace issued by the falling mantle check when bAsyncFallingMantleTrace is set */
+	FTraceHandle PendingMantleTrace;
+
+	/** Result of PendingMantleTrace, consumed by the next MantleCheck in place of its own forward trace */
+	TOptional<FHitResult> PrefetchedMantleWallHit;
+
+	FTCCharacterPerfCounters PerfCounters;
 };
@@ -0,0 +1,78 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Curve driven camera parameters, sampled from the camera behavior anim instance once per frame
+ */
+struct FTCCameraParams
+{
+	float RotationLagSpeed = 0.0f;
+	FVector PivotLagSpeed = FVector::ZeroVector;
+	FVector PivotOffset = FVector::ZeroVector;
+	FVector CameraOffset = FVector::ZeroVector;
+	float Override_Debug = 0.0f;
+	float Weight_FirstPerson = 0.0f;
+};
+
+/**
+ * Everything the camera stages read for a frame. Gathered on the game thread before evaluation.
+ */
+struct FTCCameraInputs
+{
+	float DeltaTime = 0.0f;
+	FRotator CurrentCameraRotation = FRotator::ZeroRotator;
+	FRotator ControlRotation = FRotator::ZeroRotator;
+	FTransform PivotTarget = FTransform::Identity;
+	FVector FPTarget = FVector::ZeroVector;
+	float TPFOV = 90.0f;
+	float FPFOV = 90.0f;
+	FRotator DebugViewRotation = FRotator::ZeroRotator;
+	FVector DebugViewOffset = FVector::ZeroVector;
+	FTCCameraParams Params;
+};
+
+/**
+ * Camera state carried between frames and written by the stages
+ */
+struct FTCCameraState
+{
+	FTransform SmoothedPivotTarget = FTransform::Identity;
+	FVector PivotLocation = FVector::ZeroVector;
+	FVector TargetCameraLocation = FVector::ZeroVector;
+	FRotator TargetCameraRotation = FRotator::ZeroRotator;
+
+	FVector FinalLocation = FVector::ZeroVector;
+	FRotator FinalRotation = FRotator::ZeroRotator;
+	float FinalFOV = 90.0f;
+};
+
+/**
+ * The camera behavior as a sequence of pure stages over FTCCameraState. None of the stages touch UObjects,
+ * so everything before the collision trace may be evaluated off the game thread.
+ */
+struct HORIZONSTC_API FTCCameraPipeline
+{
+	/** Step 2: Interpolate toward the control rotation and apply the debug override */
+	static void UpdateTargetRotation(const FTCCameraInputs& Inputs, FTCCameraState& State);
+
+	/** Step 3: Lag the pivot target independently on each camera-relative axis */
+	static void UpdateSmoothedPivot(const FTCCameraInputs& Inputs, FTCCameraState& State);
+
+	/** Step 4: Apply the local pivot offsets to the smoothed pivot */
+	static void UpdatePivotLocation(const FTCCameraInputs& Inputs, FTCCameraState& State);
+
+	/** Step 5: Apply camera relative offsets to the pivot to find the un-collided camera location */
+	static void UpdateTargetLocation(const FTCCameraInputs& Inputs, FTCCameraState& State);
+
+	/** Runs steps 2 to 5. The result still needs the collision correction before BlendFinal. */
+	static void EvaluatePreTrace(const FTCCameraInputs& Inputs, FTCCameraState& State);
+
+	/** Step 8: Blend toward the first person target and the debug view to produce the final POV */
+	static void BlendFinal(const FTCCameraInputs& Inputs, FTCCameraState& State);
+
+	static FVector CalculateAxisIndependentLag(const FVector& CurrentLocation, const FVector& TargetLocation,
+	                                           FRotator CameraRotation, const FVector& LagSpeeds, float DeltaTime);
+};
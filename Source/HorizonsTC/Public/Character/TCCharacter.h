@@ -14,7 +14,7 @@ class HORIZONSTC_API ATCCharacter : public ATCBaseCharacter
 {
 	GENERATED_BODY()
 
-	ATCCharacter();
+	ATCCharacter(const FObjectInitializer& ObjectInitializer);
 
 public:
 	virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
@@ -0,0 +1,28 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Character/TCCharacterPerf.h"
+
+class ATCBaseCharacter;
+
+/**
+ * Text report of a character's locomotion state and cost: movement state, gait, stance and rotation mode,
+ * per-frame time and queries for foot IK, mantling and land prediction, anim update time, tick rates and active
+ * montages. Shared by the "TCLocomotion" Gameplay Debugger category and tc.Character.DebugLog, which logs the same
+ * lines in sessions without a viewport (-nullrhi).
+ *
+ * Per-frame figures average the ticks since this report last described the same character. Timings need
+ * tc.Perf.CharacterCounters or a collection request: the debugger category keeps collection on while it's open
+ * and tc.Character.DebugLog for a minute after each call (see FTCCharacterPerfCollection).
+ */
+struct HORIZONSTC_API FTCCharacterDebugReport
+{
+	void Describe(ATCBaseCharacter& Character, TArray<FString>& OutLines);
+
+private:
+	TWeakObjectPtr<ATCBaseCharacter> LastCharacter;
+
+	FTCCharacterPerfCounters LastCounters;
+};
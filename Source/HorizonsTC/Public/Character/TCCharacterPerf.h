@@ -0,0 +1,116 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Set while tc.Perf.CharacterCounters is on or a tool has asked for the counters (see FTCCharacterPerfCollection).
+// Nothing is timed or counted per character unless this is set. Don't write it directly.
+extern HORIZONSTC_API bool GTCCollectCharacterPerf;
+
+/**
+ * Lets tools turn per-character collection on without owning GTCCollectCharacterPerf. Collection stays on while
+ * tc.Perf.CharacterCounters is set, any reference is held or a keep alive hasn't run out, so one tool finishing
+ * never turns it off under another.
+ */
+struct HORIZONSTC_API FTCCharacterPerfCollection
+{
+	/** Keeps collection on until the matching Release, e.g. for a benchmark's lifetime */
+	static void AddRef();
+
+	static void Release();
+
+	/**
+	 * Keeps collection on for the next Seconds of real time, extending any earlier keep alive. For tools that
+	 * only know they're still in use while they keep being called, like the TCLocomotion debugger category.
+	 */
+	static void KeepAlive(float Seconds);
+
+	/** Recomputes GTCCollectCharacterPerf */
+	static void Update();
+
+private:
+	static bool TickKeepAlive(float DeltaTime);
+};
+
+/**
+ * Per-character timings and physics query counts for the locomotion stack. Unlike the stat system these are
+ * readable from code in any non-shipping build (including -nullrhi runs), so tools can attribute cost to one
+ * character and compare builds. Collection is off by default.
+ */
+struct HORIZONSTC_API FTCCharacterPerfCounters
+{
+	enum EPhase
+	{
+		SetEssentialValues,
+		UpdateCharacterMovement,
+		UpdateGroundedRotation,
+		UpdateInAirRotation,
+		MantleCheck,
+		RagdollUpdate,
+		AnimUpdate,
+		FootIK, // Part of AnimUpdate
+		LandPrediction, // Part of AnimUpdate
+
+		NumPhases
+	};
+
+	enum EQuery
+	{
+		MantleQuery,
+		FootIKQuery,
+		LandPredictionQuery,
+		RagdollQuery,
+
+		NumQueries
+	};
+
+	uint64 PhaseCycles[NumPhases];
+	uint32 Queries[NumQueries];
+	uint32 NumTicks;
+
+	FTCCharacterPerfCounters() { Reset(); }
+
+	void Reset();
+
+	/** Adds another character's counters to these, for totals across a group of characters */
+	void Accumulate(const FTCCharacterPerfCounters& Other);
+
+	double GetPhaseMs(EPhase Phase) const;
+
+	static const TCHAR* GetPhaseName(EPhase Phase);
+
+	static const TCHAR* GetQueryName(EQuery Query);
+};
+
+/** Adds the cycles spent in its scope to one phase of a character's counters */
+struct FTCCharacterPerfScope
+{
+	FTCCharacterPerfScope(FTCCharacterPerfCounters& InCounters, FTCCharacterPerfCounters::EPhase InPhase)
+		: Counters(GTCCollectCharacterPerf ? &InCounters : nullptr)
+		, Phase(InPhase)
+		, StartCycles(Counters ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FTCCharacterPerfScope()
+	{
+		if (Counters)
+		{
+			Counters->PhaseCycles[Phase] += FPlatformTime::Cycles64() - StartCycles;
+		}
+	}
+
+private:
+	FTCCharacterPerfCounters* Counters;
+	FTCCharacterPerfCounters::EPhase Phase;
+	uint64 StartCycles;
+};
+
+#if !UE_BUILD_SHIPPING
+#define TC_PERF_PHASE(Counters, Phase) FTCCharacterPerfScope ANONYMOUS_VARIABLE(TCPerfScope_)(Counters, FTCCharacterPerfCounters::Phase)
+#define TC_PERF_QUERY(Counters, Query) do { if (GTCCollectCharacterPerf) { ++(Counters).Queries[FTCCharacterPerfCounters::Query]; } } while (0)
+#else
+#define TC_PERF_PHASE(Counters, Phase)
+#define TC_PERF_QUERY(Counters, Query) do { } while (0)
+#endif
@@ -0,0 +1,57 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CheatManager.h"
+#include "TCCheatManager.generated.h"
+
+class ATCCharacter;
+
+/**
+ * Stress commands that push the gameplay subsystems to their scaling limits in development builds.
+ * Every command logs its elapsed time and how many UObjects and how much memory it left behind, so runs can be
+ * compared before and after a change. Pair with "stat HorizonsTC_*" or a CSV capture for the per-frame cost.
+ */
+UCLASS()
+class HORIZONSTC_API UTCCheatManager : public UCheatManager
+{
+	GENERATED_BODY()
+
+public:
+	/** Spawns Count armed bots of the player's pawn class in rings around the player, with their first weapon drawn */
+	UFUNCTION(Exec)
+		void TCStressSpawnBots(int32 Count = 16);
+
+	/** Destroys every bot spawned by TCStressSpawnBots */
+	UFUNCTION(Exec)
+		void TCStressClearBots();
+
+	/** Makes the stress bots fire continuously on full auto with endless ammo, or stop */
+	UFUNCTION(Exec)
+		void TCStressFire(bool bEnable = true);
+
+	/**
+	 * Begins Count synthetic quests (copies of the first quest class the quest manager knows), advances each
+	 * up to Advances objectives, then forgets them all again
+	 */
+	UFUNCTION(Exec)
+		void TCStressQuests(int32 Count = 1000, int32 Advances = 4);
+
+	/** Starts ragdoll on every character in the world, or ends it on those already ragdolling */
+	UFUNCTION(Exec)
+		void TCStressRagdoll();
+
+	/** Opens and closes the pause stack menus Loops times */
+	UFUNCTION(Exec)
+		void TCStressPauseMenus(int32 Loops = 100);
+
+private:
+	/** Keeps firing bots firing: refills their ammo and presses the trigger again for weapons that stopped */
+	void UpdateStressFire();
+
+	UPROPERTY(Transient)
+		TArray<ATCCharacter*> StressBots;
+
+	FTimerHandle TimerHandle_StressFire;
+};
@@ -0,0 +1,29 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_GAMEPLAY_DEBUGGER
+
+#include "GameplayDebuggerCategory.h"
+#include "Character/TCCharacterDebug.h"
+
+/**
+ * "TCLocomotion" Gameplay Debugger category: FTCCharacterDebugReport for the selected ATCBaseCharacter.
+ * Registered by the module. Open the debugger with the apostrophe key and select a character.
+ */
+class FTCGameplayDebuggerCategory : public FGameplayDebuggerCategory
+{
+public:
+	FTCGameplayDebuggerCategory();
+
+	virtual void CollectData(APlayerController* OwnerPC, AActor* DebugActor) override;
+
+	static TSharedRef<FGameplayDebuggerCategory> MakeInstance();
+
+private:
+	FTCCharacterDebugReport Report;
+};
+
+#endif // WITH_GAMEPLAY_DEBUGGER
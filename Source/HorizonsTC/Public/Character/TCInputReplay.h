@@ -0,0 +1,132 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InputCoreTypes.h"
+#include "Engine/EngineBaseTypes.h"
+
+class APlayerController;
+
+/** One raw key or axis event as the viewport delivered it to the player controller */
+struct FTCInputEvent
+{
+	FKey Key;
+
+	// Amount depressed for key events, delta for axis events
+	float Value = 0.0f;
+
+	TEnumAsByte<EInputEvent> Event = IE_Pressed;
+
+	uint8 NumSamples = 0;
+
+	bool bAxis = false;
+
+	bool bGamepad = false;
+};
+
+/**
+ * Records a local player's raw input frame by frame to a compact binary trace and plays it back.
+ *
+ * Input is captured where the viewport hands it to the controller, before the player input mappings, so the
+ * bindings made in ATCPlayerController::SetupInputComponent and ATCBaseCharacter::SetupPlayerInputComponent
+ * see exactly what they saw while recording. Every frame's delta time is stored too: playback switches the
+ * engine to a fixed timestep that follows the recorded one, so a trace replays the same simulation at any
+ * frame rate, headless included. The trace also stores the weapon random seed (tc.Weapons.RandomSeed), so
+ * spread, damage and recoil come out the same.
+ *
+ * Traces live in Saved/Profiling/TCInput. Record with tc.Input.Record <Name> / tc.Input.StopRecord or
+ * -TCRecordInput=<Name>, replay with tc.Input.Replay <Name> or, for regression runs,
+ *   HorizonsTC <Map> -game -nullrhi -unattended -TCReplayInput=<Name>
+ * which quits once the trace ends. Traces only reproduce from the state they were recorded in, so record
+ * regression traces from the command line, which starts recording as the level begins.
+ */
+class HORIZONSTC_API FTCInputReplay
+{
+public:
+	enum class EMode : uint8
+	{
+		None,
+		Recording,
+		Playing
+	};
+
+	explicit FTCInputReplay(APlayerController* InController);
+
+	~FTCInputReplay();
+
+	EMode GetMode() const { return Mode; }
+
+	bool IsPlaying() const { return Mode == EMode::Playing; }
+
+	bool StartRecording(const FString& Name);
+
+	/** Writes the trace to disk. Returns false if nothing was being recorded or the file couldn't be written. */
+	bool StopRecording();
+
+	bool StartPlayback(const FString& Name, bool bInQuitWhenFinished = false);
+
+	void StopPlayback();
+
+	/** Adds a live event to the frame being recorded */
+	void RecordEvent(const FTCInputEvent& Event);
+
+	/**
+	 * Called at the start of the controller's PlayerTick, before it processes input. Closes the recorded frame,
+	 * or feeds this frame's events to Inject during playback.
+	 */
+	void Tick(float DeltaSeconds, TFunctionRef<void(const FTCInputEvent&)> Inject);
+
+	static FString GetTracePath(const FString& Name);
+
+private:
+	struct FFrame
+	{
+		float DeltaSeconds = 0.0f;
+		int32 FirstEvent = 0;
+		int32 NumEvents = 0;
+	};
+
+	/**
+	 * Points every weapon at the trace's random seed, remembering the seed the session used before.
+	 * Returns false, with an error logged, if tc.Weapons.RandomSeed didn't take the seed.
+	 */
+	bool ApplyRandomSeed(int32 Seed);
+
+	void RestoreRandomSeed();
+
+	void RestoreTimestep();
+
+	bool Save(const FString& Path) const;
+
+	bool Load(const FString& Path);
+
+	TWeakObjectPtr<APlayerController> Controller;
+
+	EMode Mode = EMode::None;
+
+	FString TraceName;
+
+	int32 RandomSeed = 0;
+
+	TArray<FFrame> Frames;
+
+	TArray<FTCInputEvent> Events;
+
+	/** Events received since the last recorded frame closed */
+	TArray<FTCInputEvent> PendingEvents;
+
+	int32 PlaybackFrame = 0;
+
+	bool bQuitWhenFinished = false;
+
+	bool bStartedCsvCapture = false;
+
+	uint64 PlaybackStartCycles = 0;
+
+	int32 PreviousRandomSeed = 0;
+
+	bool bPreviousFixedTimestep = false;
+
+	double PreviousFixedDeltaTime = 0.0;
+};
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "Camera/PlayerCameraManager.h"
+#include "WorldCollision.h"
+#include "Character/TCCameraPipeline.h"
 #include "TCPlayerCameraManager.generated.h"
 
 class ATCBaseCharacter;
@@ -39,6 +41,26 @@ protected:
 	UFUNCTION(BlueprintCallable)
 	bool CustomCameraBehavior(float DeltaTime, FVector& Location, FRotator& Rotation, float& FOV);
 
+	/** Step 1: Sample the character and camera behavior curves into the inputs for the camera stages */
+	void GatherCameraInputs(float DeltaTime, FTCCameraInputs& OutInputs);
+
+	/**
+	 * Resolves the camera collision for this frame and returns the corrected camera location.
+	 * When async tracing is enabled the hit fraction from the previous frame's sweep is re-applied to the
+	 * current trace segment, and a blocking sweep is only issued when that result is missing or too stale.
+	 */
+	FVector ResolveCameraCollision(const FVector& TraceOrigin, const FVector& TraceTarget, float TraceRadius,
+	                               ECollisionChannel TraceChannel, float DeltaTime);
+
+	/** Blocking sweep from origin to target. Returns the fraction of the segment that is free (1 = no hit). */
+	float SweepCameraCollision(const FVector& TraceOrigin, const FVector& TraceTarget, float TraceRadius,
+	                           ECollisionChannel TraceChannel) const;
+
+#if !UE_BUILD_SHIPPING
+	/** Feeds the async and blocking results into the jitter comparison enabled by tc.Camera.AsyncTraceCompare */
+	void RecordCameraTraceJitter(const FVector& AsyncLocation, const FVector& SyncLocation);
+#endif
+
 public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	ATCBaseCharacter* ControlledCharacter = nullptr;
@@ -70,4 +92,60 @@ protected:
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
 	FVector DebugViewOffset;
+
+	/************************************************************************/
+	/* Camera Collision                                                     */
+	/************************************************************************/
+
+	// Run the camera collision sweep asynchronously and consume its result on the following frame
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Camera Collision")
+	bool bUseAsyncCameraTrace = true;
+
+	// Speed at which the camera eases back out once an obstruction clears. Moving in is never smoothed.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Camera Collision", meta = (EditCondition = "bUseAsyncCameraTrace"))
+	float AsyncTraceRecoverySpeed = 10.0f;
+
+	// If the async result pulls the camera in by more than this fraction of the boom in one step, re-sweep synchronously
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Camera Collision", meta = (EditCondition = "bUseAsyncCameraTrace", ClampMin = "0.0", ClampMax = "1.0"))
+	float AsyncTraceOcclusionThreshold = 0.35f;
+
+	// If the trace segment moved further than this since the async sweep was issued, re-sweep synchronously
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Camera Collision", meta = (EditCondition = "bUseAsyncCameraTrace"))
+	float AsyncTraceMaxDrift = 50.0f;
+
+private:
+	// Camera state for the pipeline stages. Loaded from SmoothedPivotTarget, PivotLocation and the targets above at
+	// the start of each frame and written back to them after the collision trace, so those stay the carried state.
+	FTCCameraState CameraState;
+
+	FTraceHandle PendingCameraTrace;
+
+	// Segment the pending async sweep was issued for
+	FVector PendingTraceOrigin = FVector::ZeroVector;
+	FVector PendingTraceTarget = FVector::ZeroVector;
+
+	// Segment the latest consumed sweep result was traced along
+	FVector LastTraceOrigin = FVector::ZeroVector;
+	FVector LastTraceTarget = FVector::ZeroVector;
+
+	// Latest free fraction reported by a sweep, and the smoothed value actually applied to the camera
+	float LastTraceFraction = 1.0f;
+	float SmoothedTraceFraction = 1.0f;
+
+	bool bHasCameraTraceResult = false;
+
+#if !UE_BUILD_SHIPPING
+	struct FCameraTraceJitterStats
+	{
+		FVector AsyncHistory[2];
+		FVector SyncHistory[2];
+		int32 NumSamples = 0;
+		double AsyncJitterSum = 0.0;
+		double SyncJitterSum = 0.0;
+		double DeviationSum = 0.0;
+		float MaxDeviation = 0.0f;
+	};
+
+	FCameraTraceJitterStats JitterStats;
+#endif
 };
@@ -4,12 +4,32 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
+#include "Character/TCInputReplay.h"
 
 #include "TCPlayerController.generated.h"
 
 class ATCBaseCharacter;
 class AQuestManager;
 
+/** The player's camera aim, traced at most once per frame and shared by everything that needs it */
+struct FTCPlayerAim
+{
+	/** Camera location and forward vector the trace was made from */
+	FVector Origin = FVector::ZeroVector;
+	FVector Direction = FVector::ForwardVector;
+
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+
+	/** Blocking hit with physical material and bone, valid when bHit is set */
+	FHitResult Hit;
+	bool bHit = false;
+
+	uint64 Frame = 0;
+
+	FVector GetAimPoint() const { return bHit ? Hit.ImpactPoint : End; }
+};
+
 /**
 * Player controller class
 */
@@ -21,6 +41,8 @@ class HORIZONSTC_API ATCPlayerController : public APlayerController
 public:
 	ATCPlayerController();
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 	/************************************************************************/
 	/* Quests																*/
 	/************************************************************************/
@@ -39,7 +61,8 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Quests)
 		TSubclassOf<AQuestManager> QuestManagerClass;
 
-	UPROPERTY(BlueprintReadOnly, Category = Quests)
+	/** Spawned by the server and replicated to this controller's client only */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = Quests)
 		class AQuestManager* QuestManagerRef;
 
 	int32 CurrentQuestID;
@@ -129,9 +152,52 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = Utility)
 		bool IsInLimitedInputMode() const;
 
+
+	/************************************************************************/
+	/* Aim																	*/
+	/************************************************************************/
+
+	/**
+	 * Returns where the camera is aiming. The trace runs once per frame and is reused by every caller
+	 * (weapon, crosshair, interactions) unless the camera has moved since or a fresh trace is required.
+	 * @param bRequireFresh - Trace again, bypassing every cached result.
+	 */
+	const FTCPlayerAim& GetPlayerAim(bool bRequireFresh = false);
+
+	/**
+	 * The aim a shot fires along: this frame's shared aim, traced again only if the camera moved since or
+	 * another shot already fired along it this frame.
+	 */
+	const FTCPlayerAim& GetShotAim();
+
+	/** Blueprint access to the shared aim for crosshair and interaction widgets. Returns true on a blocking hit. */
+	UFUNCTION(BlueprintCallable, Category = Aim)
+		bool GetAimHit(FHitResult& OutHit, FVector& OutAimPoint);
+
+
+	/************************************************************************/
+	/* Input Replay															*/
+	/************************************************************************/
+
+	/** Records this player's input to a trace named Name (see FTCInputReplay). An empty name uses the date. */
+	bool StartInputRecording(const FString& Name);
+
+	bool StopInputRecording();
+
+	/** Plays back a recorded trace. Live input is ignored until it ends. */
+	bool StartInputReplay(const FString& Name, bool bQuitWhenFinished = false);
+
+	virtual bool InputKey(FKey Key, EInputEvent EventType, float AmountDepressed, bool bGamepad) override;
+
+	virtual bool InputAxis(FKey Key, float Delta, float DeltaTime, int32 NumSamples, bool bGamepad) override;
+
+	virtual void PlayerTick(float DeltaTime) override;
+
 protected:
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void SetupInputComponent() override;
 
 private:
@@ -143,4 +209,15 @@ private:
 		class UObjectiveComponent* ObjectiveComp;
 
 	bool bLimitedInputMode = false;
+
+	/** Traces from the camera and stores the result in PlayerAim. A fresh trace skips the query subsystem's cache. */
+	void UpdatePlayerAim(const FVector& CameraLocation, const FVector& AimDirection, bool bRequireFresh);
+
+	FTCPlayerAim PlayerAim;
+
+	/** Frame the last shot took its aim in (see GetShotAim) */
+	uint64 LastShotAimFrame = 0;
+
+	/** Created on first use, local players only */
+	TUniquePtr<FTCInputReplay> InputReplay;
 };
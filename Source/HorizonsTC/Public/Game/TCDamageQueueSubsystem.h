@@ -0,0 +1,57 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TCDamageQueueSubsystem.generated.h"
+
+class UTCDamageQueueSubsystem;
+
+/** Applies the queued damage once per frame in TG_PostPhysics */
+struct FTCDamageQueueTickFunction : public FTickFunction
+{
+	UTCDamageQueueSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+	                         const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+/**
+ * Collects damage dealt during the frame (projectile hits land inside physics callbacks) and applies it after
+ * physics in a single pass, with all hits on the same actor summed into one TakeDamage call. Death, hit
+ * reactions and ragdolls then run once per target at a known point in the frame instead of once per pellet.
+ */
+UCLASS()
+class HORIZONSTC_API UTCDamageQueueSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Queues damage for the target. Applied immediately instead when tc.Damage.Deferred is 0. */
+	void QueueDamage(AActor* DamagedActor, float BaseDamage, AController* EventInstigator, AActor* DamageCauser);
+
+	/** Applies and clears everything queued so far */
+	void FlushDamage();
+
+	int32 GetNumPendingTargets() const { return PendingDamage.Num(); }
+
+	virtual void Deinitialize() override;
+
+private:
+	struct FPendingDamage
+	{
+		float Damage = 0.0f;
+		int32 NumHits = 0;
+
+		// The most recent hit's instigator and causer are the ones credited
+		TWeakObjectPtr<AController> EventInstigator;
+		TWeakObjectPtr<AActor> DamageCauser;
+	};
+
+	TMap<TWeakObjectPtr<AActor>, FPendingDamage> PendingDamage;
+
+	FTCDamageQueueTickFunction DamageTickFunction;
+};
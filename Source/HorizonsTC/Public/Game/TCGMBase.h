@@ -13,5 +13,8 @@ UCLASS()
 class HORIZONSTC_API ATCGMBase : public AGameMode
 {
 	GENERATED_BODY()
-	
+
+public:
+	/** Also starts the locomotion benchmark when launched with -TCLocomotionBenchmark */
+	virtual void StartPlay() override;
 };
@@ -0,0 +1,47 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TCHitZoneSubsystem.generated.h"
+
+enum class EHitZone : uint8;
+class UPhysicsAsset;
+class USkeletalMeshComponent;
+struct FHitResult;
+
+/** Hit zone of every body in one physics asset, indexed by body index (FHitResult::Item on skeletal mesh hits) */
+struct FTCHitZoneTable
+{
+	TArray<EHitZone> BodyZones;
+};
+
+/**
+ * Resolves weapon hits to damage zones. A physics asset's bodies are classified by bone name once, when the
+ * first mesh using it is registered (or hit), so resolving a hit afterwards is an array lookup by body index.
+ */
+UCLASS()
+class HORIZONSTC_API UTCHitZoneSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Bakes the table for the mesh's physics asset ahead of its first hit */
+	void RegisterMesh(const USkeletalMeshComponent* Mesh);
+
+	/** Zone of the body that was hit. Anything that isn't a physics asset body counts as torso. */
+	EHitZone ResolveHitZone(const FHitResult& Hit);
+
+	/** Zone a bone belongs to. Only used while baking. */
+	static EHitZone ClassifyBone(FName BoneName);
+
+	int32 GetNumTables() const { return Tables.Num(); }
+
+	virtual void Deinitialize() override;
+
+private:
+	const FTCHitZoneTable& FindOrBakeTable(const UPhysicsAsset* PhysicsAsset);
+
+	TMap<TWeakObjectPtr<const UPhysicsAsset>, FTCHitZoneTable> Tables;
+};
@@ -0,0 +1,87 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "TCLagCompensationSubsystem.generated.h"
+
+class ATCBaseCharacter;
+
+/**
+ * Recent capsule poses of one character, stored as a ring buffer of parallel arrays (structure of arrays) so a
+ * rewind only touches the times it scans and the two samples it blends.
+ */
+struct FTCHitboxHistory
+{
+	TWeakObjectPtr<ATCBaseCharacter> Character;
+
+	float CapsuleRadius = 0.0f;
+
+	TArray<float> Times;
+	TArray<FVector> Locations;
+	TArray<float> Yaws;
+	TArray<float> HalfHeights;
+
+	/** Index the next sample is written to */
+	int32 Head = 0;
+
+	int32 NumSamples = 0;
+
+	void Init(ATCBaseCharacter* InCharacter, int32 Capacity);
+
+	void Record(float Time, const FVector& Location, float Yaw, float HalfHeight);
+
+	/** Capsule pose at Time, blended between the samples around it. False if Time is outside the history. */
+	bool Sample(float Time, FTransform& OutTransform, float& OutHalfHeight) const;
+
+	SIZE_T GetAllocatedSize() const;
+};
+
+/**
+ * Server-side lag compensation. Keeps a short history of every character's capsule and tests shots against
+ * where the characters were at the shooter's fire time rather than where they are when the shot arrives.
+ * History length comes from tc.LagComp.MaxRewindMs. Only records in networked games, on the server.
+ */
+UCLASS()
+class HORIZONSTC_API UTCLagCompensationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterCharacter(ATCBaseCharacter* Character);
+
+	void UnregisterCharacter(ATCBaseCharacter* Character);
+
+	/** Whether this world keeps hitbox history (server of a networked game) */
+	bool IsRecording() const;
+
+	/**
+	 * Traces a segment against every character as they were at Time. Capsules are tested first, then the mesh of
+	 * the closest character the segment passes through, with the segment carried from the rewound pose to the
+	 * character's current one. OutHit is the mesh hit (body index, bone) in the character's current space.
+	 * @return true if a character was hit
+	 */
+	bool RewindTrace(const FVector& Start, const FVector& End, float Time, const AActor* IgnoreActor, FHitResult& OutHit);
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+	virtual void Deinitialize() override;
+
+private:
+	/** Samples kept per character for the current rewind window and sample rate */
+	static int32 GetHistoryCapacity();
+
+	void UpdateMemoryStat();
+
+	TArray<FTCHitboxHistory> Histories;
+
+	float TimeSinceSample = 0.0f;
+
+	SIZE_T TrackedMemory = 0;
+};
@@ -0,0 +1,143 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Character/TCCharacterPerf.h"
+#include "Library/TCCharacterEnumLibrary.h"
+#include "TCLocomotionBenchmark.generated.h"
+
+class ATCBaseCharacter;
+
+/** One step of the scripted input every bot follows during the benchmark */
+USTRUCT(BlueprintType)
+struct FTCBenchmarkPhase
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EGait Gait = EGait::Running;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EStance Stance = EStance::Standing;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	ERotationMode RotationMode = ERotationMode::LookingDirection;
+
+	// Degrees per second the bots' control yaw turns, so rotation code sees a moving target
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float TurnRate = 0.0f;
+
+	// Seconds between jump presses. 0 never jumps.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float JumpInterval = 0.0f;
+
+	// Seconds between grounded mantle checks. 0 never checks.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MantleInterval = 0.0f;
+
+	// Ragdoll for the whole phase
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bRagdoll = false;
+};
+
+/**
+ * Headless locomotion benchmark. Spawns a grid of bots, drives them through a script covering every gait,
+ * stance, rotation mode, jumping, mantling and ragdoll, and writes per-phase timings and physics query counts
+ * from FTCCharacterPerfCounters to Saved/Profiling/TCBenchmark as CSV.
+ *
+ * Started by ATCGMBase when the game is launched with -TCLocomotionBenchmark, e.g.
+ *   HorizonsTC <TestMap> -game -nullrhi -unattended -TCLocomotionBenchmark -TCBenchBots=32 -TCBenchPhaseTime=5
+ * or from the console with tc.Benchmark.Locomotion [NumBots]. Bots run along the benchmark's forward axis,
+ * so test maps should put climbable geometry in front of the player start for the mantle phase.
+ */
+UCLASS()
+class HORIZONSTC_API ATCLocomotionBenchmark : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ATCLocomotionBenchmark();
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Spawns a benchmark at the world's player start, configured from the command line */
+	static ATCLocomotionBenchmark* StartBenchmark(UWorld* World, int32 NumBotsOverride = 0);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Benchmark")
+	TSubclassOf<ATCBaseCharacter> BotClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Benchmark", meta = (ClampMin = "1"))
+	int32 NumBots = 16;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Benchmark")
+	float BotSpacing = 300.0f;
+
+	// Seconds each phase is measured for
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Benchmark")
+	float PhaseDuration = 5.0f;
+
+	// Seconds at the start of each phase that are not measured, so state transitions settle first
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Benchmark")
+	float PhaseWarmup = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Benchmark")
+	bool bQuitWhenFinished = false;
+
+	// Empty uses the default script covering every gait, stance and rotation mode
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Benchmark")
+	TArray<FTCBenchmarkPhase> Phases;
+
+private:
+	struct FPhaseResult
+	{
+		FName Name;
+		int32 NumFrames = 0;
+		double FrameMs = 0.0;
+		FTCCharacterPerfCounters Totals;
+	};
+
+	void BuildDefaultPhases();
+
+	void SpawnBots();
+
+	void BeginPhase(int32 PhaseIndex);
+
+	void EndPhase();
+
+	void DriveBot(ATCBaseCharacter* Bot, int32 BotIndex, const FTCBenchmarkPhase& Phase, float DeltaSeconds);
+
+	void Finish();
+
+	void WriteResults() const;
+
+	TArray<TWeakObjectPtr<ATCBaseCharacter>> Bots;
+
+	// Every phase starts the bots from where they were spawned
+	TArray<FTransform> BotSpawnTransforms;
+
+	TArray<FPhaseResult> Results;
+
+	int32 CurrentPhase = INDEX_NONE;
+
+	float PhaseTime = 0.0f;
+
+	float ControlYaw = 0.0f;
+
+	bool bMeasuring = false;
+
+	/** Holds a reference on per-character collection (see FTCCharacterPerfCollection) */
+	bool bCollectingPerf = false;
+
+	FPhaseResult CurrentResult;
+
+	uint64 LastFrameCycles = 0;
+};
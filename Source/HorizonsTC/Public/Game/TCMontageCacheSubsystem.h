@@ -0,0 +1,63 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TCMontageCacheSubsystem.generated.h"
+
+class UAnimMontage;
+class UAnimSequenceBase;
+
+/**
+ * Shares the single-slot montages that wrap transitions and turn-in-place animations. Playing a sequence as a
+ * dynamic montage builds a new UAnimMontage every time; montages are read-only once built, so one per
+ * (sequence, slot, blend settings) can be reused by every anim instance in the world.
+ */
+UCLASS()
+class HORIZONSTC_API UTCMontageCacheSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the cached montage for these settings, building it on first use. Play rate and start time are per play. */
+	UAnimMontage* FindOrCreateMontage(UAnimSequenceBase* Asset, FName SlotName, float BlendInTime, float BlendOutTime,
+	                                  int32 LoopCount = 1, float BlendOutTriggerTime = -1.0f);
+
+	int32 GetNumCachedMontages() const { return Montages.Num(); }
+
+	virtual void Deinitialize() override;
+
+private:
+	struct FMontageKey
+	{
+		const UAnimSequenceBase* Asset;
+		FName SlotName;
+		float BlendInTime;
+		float BlendOutTime;
+		int32 LoopCount;
+		float BlendOutTriggerTime;
+
+		bool operator==(const FMontageKey& Other) const
+		{
+			return Asset == Other.Asset && SlotName == Other.SlotName && BlendInTime == Other.BlendInTime
+				&& BlendOutTime == Other.BlendOutTime && LoopCount == Other.LoopCount
+				&& BlendOutTriggerTime == Other.BlendOutTriggerTime;
+		}
+
+		friend uint32 GetTypeHash(const FMontageKey& Key)
+		{
+			uint32 Hash = HashCombine(PointerHash(Key.Asset), GetTypeHash(Key.SlotName));
+			Hash = HashCombine(Hash, GetTypeHash(Key.BlendInTime));
+			Hash = HashCombine(Hash, GetTypeHash(Key.BlendOutTime));
+			Hash = HashCombine(Hash, GetTypeHash(Key.LoopCount));
+			return HashCombine(Hash, GetTypeHash(Key.BlendOutTriggerTime));
+		}
+	};
+
+	TMap<FMontageKey, UAnimMontage*> MontageLookup;
+
+	// Keeps the cached montages (and through them their sequences) alive
+	UPROPERTY(Transient)
+	TArray<UAnimMontage*> Montages;
+};
@@ -0,0 +1,177 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "CollisionShape.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "TCPhysicsQuerySubsystem.generated.h"
+
+/** Gameplay system a physics query is issued for. Each source has its own counters and default policy. */
+enum class ETCQuerySource : uint8
+{
+	FootIK,
+	LandPrediction,
+	Mantle,
+	Camera,
+	Ragdoll,
+	WeaponAim,
+
+	Count
+};
+
+/**
+ * How a query is treated once the frame's budget runs out. Critical queries always run. High and Low queries
+ * only run while the number of queries already issued this frame is under their cap, so cosmetic work gives way
+ * to gameplay work in dense scenes. Critical queries count towards the caps but are never refused, so the caps
+ * are not a hard ceiling: Critical queries issued past the High cap are counted as over budget instead.
+ */
+enum class ETCQueryPriority : uint8
+{
+	Low,
+	High,
+	Critical,
+
+	Default
+};
+
+/** One sweep or line trace. A line trace is a request with the default (line) shape. */
+struct FTCQueryRequest
+{
+	FTCQueryRequest(ETCQuerySource InSource, const UObject* InOwner, const FCollisionQueryParams& InParams)
+		: Source(InSource)
+		, Owner(InOwner)
+		, Params(InParams)
+	{
+	}
+
+	ETCQuerySource Source;
+
+	ETCQueryPriority Priority = ETCQueryPriority::Default;
+
+	// Identifies the requester for result reuse. Never dereferenced.
+	const UObject* Owner;
+
+	// Distinguishes several queries of the same source from one owner, e.g. one per foot
+	int32 Slot = 0;
+
+	// Whether an earlier result may answer this query. Off for queries that must see the world as it is now.
+	bool bAllowReuse = true;
+
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FCollisionShape Shape;
+
+	// Queries by profile when set, by channel otherwise
+	FName ProfileName = NAME_None;
+	ECollisionChannel Channel = ECC_Visibility;
+
+	const FCollisionQueryParams& Params;
+};
+
+struct FTCQuerySourceCounters
+{
+	uint32 Issued = 0;
+	uint32 Async = 0;
+	uint32 Reused = 0;
+	uint32 Throttled = 0;
+
+	// Critical queries run although the frame was already past the High cap
+	uint32 OverBudget = 0;
+
+	void Reset() { *this = FTCQuerySourceCounters(); }
+};
+
+/**
+ * Single entry point for gameplay physics queries. Applies per-frame caps by priority, reuses results for
+ * matching queries within a frame (and recent results for throttled cosmetic queries), dispatches async
+ * sweeps, and keeps per-source counters ("stat HorizonsTC_Physics", tc.PhysicsQuery.Dump). A result is only
+ * reused for a query of the same shape, channel or profile whose start and end lie within tolerance.
+ */
+UCLASS()
+class HORIZONSTC_API UTCPhysicsQuerySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Runs the query, or answers it from this frame's results or a recent one. Returns true on a blocking hit. */
+	bool Query(const FTCQueryRequest& Request, FHitResult& OutHit);
+
+	/** Issues the query asynchronously. Returns an invalid handle if the query was throttled. */
+	FTraceHandle QueryAsync(const FTCQueryRequest& Request);
+
+	/** Counters for the last complete frame */
+	const FTCQuerySourceCounters& GetLastFrameCounters(ETCQuerySource Source) const { return LastFrameCounters[(int32)Source]; }
+
+	/** Counters since the world started */
+	const FTCQuerySourceCounters& GetTotalCounters(ETCQuerySource Source) const { return TotalCounters[(int32)Source]; }
+
+	static const TCHAR* GetSourceName(ETCQuerySource Source);
+
+	void DumpCounters() const;
+
+private:
+	struct FCacheKey
+	{
+		const void* Owner;
+		int32 Slot;
+		ETCQuerySource Source;
+
+		bool operator==(const FCacheKey& Other) const
+		{
+			return Owner == Other.Owner && Slot == Other.Slot && Source == Other.Source;
+		}
+
+		friend uint32 GetTypeHash(const FCacheKey& Key)
+		{
+			return HashCombine(HashCombine(PointerHash(Key.Owner), GetTypeHash(Key.Slot)), (uint32)Key.Source);
+		}
+	};
+
+	struct FCachedResult
+	{
+		FVector Start;
+		FVector End;
+		FQuat Rotation;
+		FCollisionShape Shape;
+		FName ProfileName;
+		ECollisionChannel Channel = ECC_Visibility;
+		FHitResult Hit;
+		bool bHit = false;
+		uint64 Frame = 0;
+
+		/** Whether this result answers the request: same query type, start and end within Tolerance */
+		bool Matches(const FTCQueryRequest& Request, float Tolerance) const;
+	};
+
+	/** Rolls the per-frame counters over when the first query of a new frame comes in */
+	void UpdateFrame();
+
+	ETCQueryPriority ResolvePriority(const FTCQueryRequest& Request) const;
+
+	/** Whether the frame's budget still allows a query of this priority */
+	bool HasBudget(ETCQueryPriority Priority) const;
+
+	/** Counts a query that is about to be issued, including Critical queries that overran the caps */
+	void CountIssued(const FTCQueryRequest& Request);
+
+	bool RunQuery(const FTCQueryRequest& Request, FHitResult& OutHit) const;
+
+	TMap<FCacheKey, FCachedResult> Cache;
+
+	FTCQuerySourceCounters FrameCounters[(int32)ETCQuerySource::Count];
+	FTCQuerySourceCounters LastFrameCounters[(int32)ETCQuerySource::Count];
+	FTCQuerySourceCounters TotalCounters[(int32)ETCQuerySource::Count];
+
+	// Sync and async queries actually issued this frame, across all sources
+	int32 NumIssuedThisFrame = 0;
+
+	// Critical queries issued this frame after the High cap was reached
+	int32 NumOverBudgetThisFrame = 0;
+
+	uint64 CurrentFrame = 0;
+};
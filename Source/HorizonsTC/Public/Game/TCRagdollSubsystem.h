@@ -0,0 +1,68 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "TCRagdollSubsystem.generated.h"
+
+class ATCBaseCharacter;
+
+/**
+ * Ragdoll budget. Caps the number of simulating ragdolls in a world and freezes ragdolls that are
+ * settled, far from every player camera or over budget. Frozen ragdolls hold their last pose.
+ * New ragdolls always simulate for tc.Ragdoll.MinSimulateTime first, so none is frozen standing or mid-air.
+ */
+UCLASS()
+class HORIZONSTC_API UTCRagdollSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterRagdoll(ATCBaseCharacter* Character);
+
+	void UnregisterRagdoll(ATCBaseCharacter* Character);
+
+	int32 GetNumRagdolls() const { return Ragdolls.Num(); }
+
+	int32 GetNumSimulatingRagdolls() const { return NumSimulating; }
+
+	/** While disabled every ragdoll simulates, e.g. for benchmarks that measure ragdoll cost */
+	void SetBudgetEnabled(bool bEnabled);
+
+	/** Whether a ragdoll moving this fast counts as at rest */
+	static bool IsRagdollAtRest(const FVector& Velocity);
+
+	/** How many frames apart a ragdoll at rest traces for the ground */
+	static int32 GetRestTraceInterval();
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+	/** Decides which ragdolls keep simulating and freezes or wakes the rest */
+	void UpdateBudget();
+
+	struct FRagdollEntry
+	{
+		TWeakObjectPtr<ATCBaseCharacter> Character;
+
+		// World time the ragdoll was registered at
+		float StartTime = 0.0f;
+
+		// Consecutive budget evaluations that found the ragdoll settled
+		int32 SettledEvaluations = 0;
+	};
+
+	TArray<FRagdollEntry> Ragdolls;
+
+	int32 NumSimulating = 0;
+
+	float TimeSinceBudgetUpdate = 0.0f;
+
+	bool bBudgetEnabled = true;
+};
@@ -0,0 +1,90 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Input-to-result spans the local player's latency is measured over */
+enum class ETCLatencyPath : uint8
+{
+	// Fire pressed (ATCCharacter::OnStartFire) to the first shot leaving the weapon (ABaseFirearm::FireWeapon)
+	FireToShot,
+	// Shot fired to its projectile's first move
+	ShotToProjectile,
+	// Fire pressed to the first shot's projectile moving
+	FireToProjectile,
+	// Look input to the camera producing a view from it (ATCPlayerCameraManager::CustomCameraBehavior)
+	LookToView,
+	// Look input to that view reaching the render thread. The closest to input-to-photon the game can see.
+	LookToRender,
+
+	Count
+};
+
+/** Latency samples in exponentially wider buckets, so percentiles cost a fixed amount of memory at any sample count */
+struct HORIZONSTC_API FTCLatencyHistogram
+{
+	static constexpr int32 NumBuckets = 64;
+
+	// Bucket 0 ends at 0.05ms, every following one is 15% wider, so the last one ends at ~335ms
+	static double GetBucketUpperMs(int32 Bucket);
+
+	void Add(double Ms);
+
+	/** Upper edge of the bucket holding the given percentile (0-100). Samples past the last bucket report the max. */
+	double GetPercentileMs(float Percentile) const;
+
+	double GetAverageMs() const { return NumSamples > 0 ? TotalMs / NumSamples : 0.0; }
+
+	void Reset() { *this = FTCLatencyHistogram(); }
+
+	uint32 Buckets[NumBuckets] = {};
+	uint32 NumSamples = 0;
+	double TotalMs = 0.0;
+	double MaxMs = 0.0;
+};
+
+/**
+ * Timestamps taken along the fire and look paths of the locally controlled player, turned into per-path histograms.
+ * Percentiles show up under "stat HorizonsTC_Latency" and every sample goes to the CSV profiler. tc.Latency.Dump
+ * logs p50/p95/p99 per path and writes the histograms to Saved/Profiling/TCLatency, tc.Latency.Reset clears them.
+ * Game thread only.
+ */
+class HORIZONSTC_API FTCLatencyTracker
+{
+public:
+	static FTCLatencyTracker& Get();
+
+	/** tc.Latency.Enable */
+	static bool IsEnabled();
+
+	void MarkFireInput();
+
+	/** Closes the fire input span if a press is waiting on this shot. Returns that press's time, or 0. */
+	double MarkShotFired(double ShotTime);
+
+	void MarkProjectileMoved(double ShotTime, double FireInputTime);
+
+	void MarkLookInput();
+
+	void MarkViewUpdated();
+
+	void AddSample(ETCLatencyPath Path, double Ms);
+
+	const FTCLatencyHistogram& GetHistogram(ETCLatencyPath Path) const { return Histograms[(int32)Path]; }
+
+	static const TCHAR* GetPathName(ETCLatencyPath Path);
+
+	void Reset();
+
+	void Dump() const;
+
+	bool WriteCsv() const;
+
+private:
+	FTCLatencyHistogram Histograms[(int32)ETCLatencyPath::Count];
+
+	// Earliest input that hasn't produced its result yet. 0 when nothing is waiting.
+	double PendingFireInput = 0.0;
+	double PendingLookInput = 0.0;
+};
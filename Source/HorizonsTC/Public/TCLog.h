@@ -0,0 +1,7 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+HORIZONSTC_API DECLARE_LOG_CATEGORY_EXTERN(LogHorizonsTC, Log, All);
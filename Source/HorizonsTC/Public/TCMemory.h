@@ -0,0 +1,33 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+/************************************************************************/
+/* Low-Level Memory Tracker Tags                                        */
+/************************************************************************/
+
+// Project LLM tags, registered by the module on startup. Run with -llm (and -llmcsv) to see the breakdown.
+enum class ETCLLMTag : int32
+{
+	Weapons = (int32)ELLMTag::ProjectTagStart,
+	Projectiles,
+	Quests,
+	Animation,
+	UI,
+
+	Count
+};
+
+static_assert((int32)ETCLLMTag::Count <= (int32)ELLMTag::ProjectTagEnd, "HorizonsTC LLM tags overflow the project tag range");
+
+// Attribute every allocation in the current scope to one of the tags above
+#define TC_LLM_SCOPE(Tag) LLM_SCOPE((ELLMTag)ETCLLMTag::Tag)
+
+namespace TCMemory
+{
+	/** Registers the project tags and their memory stats with the tracker. Called once from StartupModule. */
+	void RegisterLLMTags();
+}
@@ -0,0 +1,55 @@
+// Copyright 2020 Jack Vento. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/************************************************************************/
+/* Stat Groups                                                          */
+/************************************************************************/
+
+// "stat HorizonsTC" for module totals, or one of the per-subsystem groups below
+DECLARE_STATS_GROUP(TEXT("HorizonsTC"), STATGROUP_HorizonsTC, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HorizonsTC Character"), STATGROUP_HorizonsTC_Character, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HorizonsTC Animation"), STATGROUP_HorizonsTC_Anim, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HorizonsTC Camera"), STATGROUP_HorizonsTC_Camera, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HorizonsTC Physics Queries"), STATGROUP_HorizonsTC_Physics, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HorizonsTC Weapons"), STATGROUP_HorizonsTC_Weapons, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HorizonsTC Quests"), STATGROUP_HorizonsTC_Quests, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("HorizonsTC Latency"), STATGROUP_HorizonsTC_Latency, STATCAT_Advanced);
+
+/************************************************************************/
+/* Physics Query Counters                                               */
+/************************************************************************/
+
+// One counter per query site, so spikes can be traced back to the system issuing them
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Foot IK Queries"), STAT_TC_FootIKQueries, STATGROUP_HorizonsTC_Physics, HORIZONSTC_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mantle Queries"), STAT_TC_MantleQueries, STATGROUP_HorizonsTC_Physics, HORIZONSTC_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Camera Queries"), STAT_TC_CameraQueries, STATGROUP_HorizonsTC_Physics, HORIZONSTC_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Land Prediction Queries"), STAT_TC_LandPredictionQueries, STATGROUP_HorizonsTC_Physics, HORIZONSTC_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ragdoll Queries"), STAT_TC_RagdollQueries, STATGROUP_HorizonsTC_Physics, HORIZONSTC_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Weapon Aim Queries"), STAT_TC_WeaponAimQueries, STATGROUP_HorizonsTC_Physics, HORIZONSTC_API);
+
+/************************************************************************/
+/* CSV Profiler + Insights                                              */
+/************************************************************************/
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(HORIZONSTC_API, HorizonsTC);
+
+#if CPUPROFILERTRACE_ENABLED
+UE_TRACE_CHANNEL_EXTERN(HorizonsTCChannel, HORIZONSTC_API);
+
+// CPU event on the HorizonsTC Insights channel ("-trace=cpu,HorizonsTC")
+#define TC_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR(#Name, HorizonsTCChannel)
+#else
+#define TC_TRACE_SCOPE(Name)
+#endif
+
+// Top level scope: stat cycle counter, CSV timing stat and Insights event under one name
+#define TC_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	CSV_SCOPED_TIMING_STAT(HorizonsTC, Stat); \
+	TC_TRACE_SCOPE(Stat)